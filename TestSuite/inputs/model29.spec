@@ -0,0 +1,9 @@
+
+
+n
+n
+Hubbard
+
+y
+
+
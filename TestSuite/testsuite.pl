@@ -950,7 +950,7 @@ sub moveFiles
 sub removeFiles
 {
 	#Additional files can be added to @files to be removed
-	my @files = ("input.*", "raw$testNum.txt", "gmon.out", "data$testNum.txt", "tst$testNum.txt", "SystemStackdata$testNum.txt", "EnvironStackdata$testNum.txt", "timeEvolution$testNum.txt");
+	my @files = ("input.*", "raw$testNum.txt", "rawStream$testNum.txt", "gmon.out", "data$testNum.txt", "tst$testNum.txt", "SystemStackdata$testNum.txt", "EnvironStackdata$testNum.txt", "timeEvolution$testNum.txt", "dataCheckpoint$testNum.txt", "SystemStackdataCheckpoint$testNum.txt", "EnvironStackdataCheckpoint$testNum.txt", "Resume*data$testNum.txt", "Resume*dataCheckpoint$testNum.txt");
 
 	my $err = chdir($srcDir);
 	die "Changing directory to $srcDir: $!" if(!$err);
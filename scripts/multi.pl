@@ -7,12 +7,17 @@ my ($vx,$vy);
 my ($tx,$ty);
 my $FileTst;
 my $FileData;
+my $FileCheckpoint;
 my $BatchName;
 my $InputFile;
 my @ignoreVars=("PBS_O_WORKDIR");
 	
 my $tstSites=" 6 4 ";
 my $templateInput="inputDollar.inp";
+# If set, each run but the first starts from the checkpoint of the previous one:
+# this template must have the options checkpoint and warmStart, and
+# CheckpointFilename=$FileCheckpoint, and jobs are submitted to run one after the other
+my $templateInputWarm="";
 my $templateBatch="batchDollar.pbs";
 my $rootDataFile="data";
 my $rootTstFile="tst";
@@ -53,6 +58,12 @@ sub createRun
 	
 	
 	my $fout = "$rootInput$counter.inp";
+	if ($templateInputWarm ne "" && $counter>0) {
+		my $previous = $counter - 1;
+		$FileCheckpoint="$rootDataFile$previous.txt";
+		unDollarize($templateInputWarm,$fout);
+		return;
+	}
 	unDollarize($templateInput,$fout);
 }
 
@@ -150,9 +161,17 @@ sub askToSubmit
 sub submitAll
 {
 	my ($total)=@_;
+	my $previousJob="";
 	for (my $i=0;$i<$total;$i++) {
 		my $batchFile="$rootBatchFile$i.pbs";
-		system("qsub $batchFile");
+		if ($templateInputWarm eq "") {
+			system("qsub $batchFile");
+			next;
+		}
+		my $depend = ($previousJob eq "") ? "" : "-W depend=afterok:$previousJob";
+		$previousJob=`qsub $depend $batchFile`;
+		chomp($previousJob);
+		die "submitAll: qsub failed for $batchFile\n" if ($previousJob eq "");
 	}
 }
 
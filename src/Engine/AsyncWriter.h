@@ -0,0 +1,299 @@
+// BEGIN LICENSE BLOCK
+/*
+Copyright (c) 2009, UT-Battelle, LLC
+All rights reserved
+
+[DMRG++, Version 2.0.0]
+[by G.A., Oak Ridge National Laboratory]
+
+UT Battelle Open Source Software License 11242008
+
+OPEN SOURCE LICENSE
+
+Subject to the conditions of this License, each
+contributor to this software hereby grants, free of
+charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"), a
+perpetual, worldwide, non-exclusive, no-charge,
+royalty-free, irrevocable copyright license to use, copy,
+modify, merge, publish, distribute, and/or sublicense
+copies of the Software.
+
+1. Redistributions of Software must retain the above
+copyright and license notices, this list of conditions,
+and the following disclaimer.  Changes or modifications
+to, or derivative works of, the Software should be noted
+with comments and the contributor and organization's
+name.
+
+2. Neither the names of UT-Battelle, LLC or the
+Department of Energy nor the names of the Software
+contributors may be used to endorse or promote products
+derived from this software without specific prior written
+permission of UT-Battelle.
+
+3. The software and the end-user documentation included
+with the redistribution, with or without modification,
+must include the following acknowledgment:
+
+"This product includes software produced by UT-Battelle,
+LLC under Contract No. DE-AC05-00OR22725  with the
+Department of Energy."
+ 
+*********************************************************
+DISCLAIMER
+
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT OWNER, CONTRIBUTORS, UNITED STATES GOVERNMENT,
+OR THE UNITED STATES DEPARTMENT OF ENERGY BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+
+NEITHER THE UNITED STATES GOVERNMENT, NOR THE UNITED
+STATES DEPARTMENT OF ENERGY, NOR THE COPYRIGHT OWNER, NOR
+ANY OF THEIR EMPLOYEES, REPRESENTS THAT THE USE OF ANY
+INFORMATION, DATA, APPARATUS, PRODUCT, OR PROCESS
+DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
+
+*********************************************************
+
+
+*/
+// END LICENSE BLOCK
+/** \ingroup DMRG */
+/*@{*/
+
+/*! \file AsyncWriter.h
+ *
+ *  Writes to the data file in its own thread (option asyncDataFile).
+ *  What is to be written is a Job, kept in a queue of at most
+ *  CAPACITY jobs; push waits while the queue is full, so a slow disk
+ *  slows down the computation instead of using more and more memory.
+ *  A job owns or shares (see CopyOnWrite) data that the computation
+ *  no longer changes, so it can be formatted and written while the
+ *  computation goes on, and jobs are written in the order they were
+ *  pushed. Without the option, or without USE_PTHREADS,
+ *  each job is written when pushed.
+ */
+#ifndef ASYNC_WRITER_H
+#define ASYNC_WRITER_H
+
+#include <deque>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+#include <pthread.h>
+
+namespace Dmrg {
+
+	//! Writes what an IoOutType on a std::ostream formatted;
+	//! IoBinary has its own, see IoBinary.h
+	template<typename IoOutType>
+	void printFormatted(IoOutType& io,const std::string& text)
+	{
+		io<<text;
+	}
+
+	template<typename IoOutType>
+	class AsyncWriter {
+
+		enum {CAPACITY = 2};
+
+	public:
+
+		class Job {
+		public:
+			virtual ~Job() {}
+
+			virtual void write(IoOutType& io) = 0;
+		}; // class Job
+
+		AsyncWriter(IoOutType& io,bool async)
+		: io_(io),async_(false),busy_(false),shutdown_(false)
+		{
+#ifdef USE_PTHREADS
+			if (!async) return;
+			pthread_mutex_init(&mutex_,0);
+			pthread_cond_init(&changed_,0);
+			if (pthread_create(&thread_,0,runner,this)!=0) {
+				pthread_cond_destroy(&changed_);
+				pthread_mutex_destroy(&mutex_);
+				return; // write when pushed then
+			}
+			async_ = true;
+#endif
+		}
+
+		~AsyncWriter()
+		{
+			if (!async_) return;
+			pthread_mutex_lock(&mutex_);
+			shutdown_ = true;
+			pthread_cond_broadcast(&changed_);
+			pthread_mutex_unlock(&mutex_);
+			pthread_join(thread_,0);
+			pthread_cond_destroy(&changed_);
+			pthread_mutex_destroy(&mutex_);
+			if (error_!="") std::cerr<<"AsyncWriter: "<<error_;
+		}
+
+		//! Takes ownership of job
+		void push(Job* job)
+		{
+			if (!async_) {
+				writeAndDelete(job);
+				return;
+			}
+			pthread_mutex_lock(&mutex_);
+			while (queue_.size()>=CAPACITY && error_=="") pthread_cond_wait(&changed_,&mutex_);
+			if (error_!="") {
+				pthread_mutex_unlock(&mutex_);
+				delete job;
+				throw std::runtime_error("AsyncWriter::push(...): " + error_);
+			}
+			queue_.push_back(job);
+			pthread_cond_broadcast(&changed_);
+			pthread_mutex_unlock(&mutex_);
+		}
+
+		//! Waits until everything pushed is written; after this
+		//! io can be used directly until the next push
+		void flush()
+		{
+			if (!async_) return;
+			pthread_mutex_lock(&mutex_);
+			while ((queue_.size()>0 || busy_) && error_=="") pthread_cond_wait(&changed_,&mutex_);
+			std::string e = error_;
+			pthread_mutex_unlock(&mutex_);
+			if (e!="") throw std::runtime_error("AsyncWriter::flush(): " + e);
+		}
+
+		bool async() const { return async_; }
+
+		void printline(const std::string& s)
+		{
+			if (!async_) io_.printline(s);
+			else push(new LineJob(s));
+		}
+
+		void printline(std::ostringstream& s)
+		{
+			if (!async_) io_.printline(s);
+			else push(new LineJob(s.str()));
+		}
+
+		//! x is formatted now, in the calling thread
+		template<typename T>
+		void print(const T& x)
+		{
+			if (!async_) {
+				io_.print(x);
+				return;
+			}
+			std::ostringstream os;
+			IoOutType io(os);
+			io.print(x);
+			push(new TextJob(os.str()));
+		}
+
+		//! text is written as is
+		void write(const std::string& text)
+		{
+			push(new TextJob(text));
+		}
+
+	private:
+
+		class LineJob : public Job {
+		public:
+			LineJob(const std::string& s) : s_(s) {}
+
+			void write(IoOutType& io) { io.printline(s_); }
+
+		private:
+			std::string s_;
+		}; // class LineJob
+
+		class TextJob : public Job {
+		public:
+			TextJob(const std::string& s) : s_(s) {}
+
+			void write(IoOutType& io) { printFormatted(io,s_); }
+
+		private:
+			std::string s_;
+		}; // class TextJob
+
+		AsyncWriter(const AsyncWriter&);
+
+		AsyncWriter& operator=(const AsyncWriter&);
+
+		void writeAndDelete(Job* job)
+		{
+			try {
+				job->write(io_);
+			} catch (...) {
+				delete job;
+				throw;
+			}
+			delete job;
+		}
+
+		static void* runner(void* arg)
+		{
+			AsyncWriter* w = static_cast<AsyncWriter*>(arg);
+			pthread_mutex_lock(&w->mutex_);
+			while (true) {
+				while (w->queue_.size()==0 && !w->shutdown_) pthread_cond_wait(&w->changed_,&w->mutex_);
+				if (w->queue_.size()==0) break; // shutdown, and all written
+				Job* job = w->queue_.front();
+				w->queue_.pop_front();
+				w->busy_ = true;
+				pthread_cond_broadcast(&w->changed_);
+				pthread_mutex_unlock(&w->mutex_);
+				std::string e;
+				try {
+					w->writeAndDelete(job);
+				} catch (std::exception& ex) {
+					e = ex.what();
+				}
+				pthread_mutex_lock(&w->mutex_);
+				w->busy_ = false;
+				if (e!="") {
+					w->error_ = e;
+					// nothing else is written after an error
+					for (size_t i=0;i<w->queue_.size();i++) delete w->queue_[i];
+					w->queue_.clear();
+				}
+				pthread_cond_broadcast(&w->changed_);
+			}
+			pthread_mutex_unlock(&w->mutex_);
+			return 0;
+		}
+
+		IoOutType& io_;
+		bool async_;
+		bool busy_;
+		bool shutdown_;
+		std::deque<Job*> queue_;
+		std::string error_;
+		pthread_t thread_;
+		pthread_mutex_t mutex_;
+		pthread_cond_t changed_;
+	}; // class AsyncWriter
+} // namespace Dmrg
+
+/*@}*/
+#endif // ASYNC_WRITER_H
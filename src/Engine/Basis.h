@@ -218,7 +218,7 @@ namespace Dmrg {
 		//! removes the indices contained in removedIndices and
 		//! transforms this basis by transform 
 		template<typename BlockMatrixType,typename SolverParametersType>
-		RealType changeBasis(typename BlockMatrixType::BuildingBlockType& ftransform,
+		RealType changeBasis(BlockDiagonalMatrix<typename BlockMatrixType::BuildingBlockType>& ftransform,
 		                     BlockMatrixType &transform,
 		                     std::vector<RealType>& eigs,
 		                     size_t kept,
@@ -82,11 +82,13 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 #ifndef BASIS_IMPL_H
 #define BASIS_IMPL_H
 
+#include <algorithm>
 #include "Utils.h"
 #include "Sort.h" // in PsimagLite
 #include "HamiltonianSymmetryLocal.h"
 #include "HamiltonianSymmetrySu2.h"
 #include "ProgressIndicator.h"
+#include "BlockDiagonalMatrix.h"
 
 namespace Dmrg {
 	
@@ -106,7 +108,7 @@ namespace Dmrg {
 		
 		enum {BEFORE_TRANSFORM,AFTER_TRANSFORM};
 		
-		BasisImplementation(const std::string& s) : dmrgTransformed_(false), name_(s), progress_(s,0) 
+		BasisImplementation(const std::string& s) : dmrgTransformed_(false), name_(s), progress_(s,0), qnOffset_(0), qnOffsetOld_(0)
 		{
 			symmLocal_.createDummyFactors(1,1);
 		}
@@ -114,7 +116,7 @@ namespace Dmrg {
 		// use this if you know the name
 		template<typename IoInputter>
 		BasisImplementation(IoInputter& io,const std::string& ss,size_t counter=0,bool bogus = false)
-				: dmrgTransformed_(false), name_(ss), progress_(ss,0) 
+				: dmrgTransformed_(false), name_(ss), progress_(ss,0), qnOffset_(0), qnOffsetOld_(0) 
 		{
 			io.advance("#NAME="+ss,counter);
 			loadInternal(io);
@@ -160,15 +162,27 @@ namespace Dmrg {
 		int partitionFromQn(size_t qn,size_t beforeOrAfterTransform) const 
 		{
 			const std::vector<size_t> *quantumNumbers, *partition;
+			const std::vector<int>* qnTable;
+			size_t qnOffset = 0;
 			
 			if (beforeOrAfterTransform==AFTER_TRANSFORM) {
 				quantumNumbers = &quantumNumbers_;
 				partition = &partition_;
+				qnTable = &qnToPartition_;
+				qnOffset = qnOffset_;
 			} else {
 				quantumNumbers = &quantumNumbersOld_;
 				partition = &partitionOld_;
+				qnTable = &qnToPartitionOld_;
+				qnOffset = qnOffsetOld_;
 			}
 			
+			if (qnTable->size()>0) {
+				if (qn<qnOffset || qn-qnOffset>=qnTable->size()) return -1;
+				return (*qnTable)[qn-qnOffset];
+			}
+
+			// quantum numbers too spread out for a table
 			for (size_t i=0;i<partition->size();i++) {
 				size_t state = (*partition)[i];
 				if ((*quantumNumbers)[state]==qn) return i;
@@ -195,8 +209,12 @@ namespace Dmrg {
 		
 		size_t findPartitionNumber(size_t i) const
 		{
-			for (size_t j=0;j<partition_.size()-1;j++) 
-				if (i>=partition_[j] && i<partition_[j+1]) return j;
+			// partition_ is increasing and ends with size()
+			if (partition_.size()>1 && i>=partition_[0] && i<partition_.back()) {
+				std::vector<size_t>::const_iterator it =
+						std::upper_bound(partition_.begin(),partition_.end(),i);
+				return (it - partition_.begin()) - 1;
+			}
 			throw std::runtime_error("BasisImplementation:: No partition found for this state\n");
 		}
 
@@ -272,7 +290,7 @@ namespace Dmrg {
 		}
 
 		template<typename BlockMatrixType,typename SolverParametersType>
-		RealType changeBasis(typename BlockMatrixType::BuildingBlockType &ftransform,BlockMatrixType& transform,
+		RealType changeBasis(BlockDiagonalMatrix<typename BlockMatrixType::BuildingBlockType> &ftransform,BlockMatrixType& transform,
 				      std::vector<RealType>& eigs,size_t kept,const SolverParametersType& solverParams)
 			{
 			/* if (!isUnitary(transform)) {
@@ -283,9 +301,11 @@ namespace Dmrg {
 			}*/
 			quantumNumbersOld_ = quantumNumbers_;
 			partitionOld_ = partition_;
+			qnToPartitionOld_ = qnToPartition_;
+			qnOffsetOld_ = qnOffset_;
 			dmrgTransformed_=true;
 			
-			blockMatrixToFullMatrix(ftransform,transform);
+			ftransform.set(transform);
 
 			std::vector<size_t> removedIndices;
 			if (useSu2Symmetry_) symmSu2_.calcRemovedIndices(removedIndices,eigs,kept,solverParams);
@@ -297,7 +317,7 @@ namespace Dmrg {
 				sort.sort(removedIndices,perm);
 				std::ostringstream msg;
 				msg<<"Truncating transform...";
-				utils::truncate(ftransform,removedIndices,false);
+				ftransform.truncateColumns(removedIndices);
 				progress_.printline(msg,std::cerr);
 				/*if (!isUnitary(ftransform)) { // only used for debugging
 					//std::cerr<<"------------------------------------\n";
@@ -432,6 +452,10 @@ namespace Dmrg {
 		std::vector<size_t> electronsOld_;
 		std::vector<size_t> partition_;
 		std::vector<size_t> partitionOld_;
+		std::vector<int> qnToPartition_;
+		std::vector<int> qnToPartitionOld_;
+		size_t qnOffset_;
+		size_t qnOffsetOld_;
 		std::vector<size_t> permutationVector_;
 		std::vector<size_t> permInverse_;
 		HamiltonianSymmetryLocalType symmLocal_;
@@ -442,14 +466,19 @@ namespace Dmrg {
 		void loadInternal(IoInputter& io) 
 		{
 			int x=0;
-			useSu2Symmetry_=false;
 			io.readline(x,"#useSu2Symmetry=");
-			if (x>0) useSu2Symmetry_=true;
+			// the model sets useSu2Symmetry_ before anything is loaded;
+			// bases may be loaded in another thread (see SpillingStack),
+			// so only check it here
+			if ((x>0)!=useSu2Symmetry_)
+				throw std::runtime_error("BasisImplementation::load(...): "
+					"#useSu2Symmetry= does not match the model\n");
 			io.read(block_,"#BLOCK");
 			io.read(quantumNumbers_,"#QN");
 			io.read(electrons_,"#ELECTRONS");
 			io.read(electronsOld_,"#0OLDELECTRONS");
 			io.read(partition_,"#PARTITION");
+			findQnToPartition();
 			io.read(permInverse_,"#PERMUTATIONINVERSE");
 			permutationVector_.resize(permInverse_.size());
 			for (size_t i=0;i<permInverse_.size();i++) permutationVector_[permInverse_[i]]=i;
@@ -479,8 +508,11 @@ namespace Dmrg {
 		RealType calcError(std::vector<RealType> const &eigs,std::vector<size_t> const &removedIndices)
 		{
 			RealType sum=static_cast<RealType>(0.0);
+			std::vector<bool> removed(eigs.size(),false);
+			for (size_t i=0;i<removedIndices.size();i++)
+				if (removedIndices[i]<removed.size()) removed[removedIndices[i]]=true;
 			for (size_t i=0;i<eigs.size();i++)
-				if (PsimagLite::isInVector(removedIndices,i)<0) sum+=eigs[i];
+				if (!removed[i]) sum+=eigs[i];
 			return 1.0-sum;
 		}
 
@@ -506,8 +538,7 @@ namespace Dmrg {
 					for (size_t i=0;i<permutationVector_.size();i++) 
 						permutationVector_[i]=i;
 				} else 	{
-					Sort<std::vector<size_t> > sort;
-					sort.sort(quantumNumbers_,permutationVector_);
+					sortQuantumNumbers();
 				}
 			}
 			
@@ -534,6 +565,77 @@ namespace Dmrg {
 				}
 			}
 			partition_.push_back(size());
+			findQnToPartition();
+		}
+
+		//! Stable sort of quantumNumbers_, sets permutationVector_ so that
+		//! new state i is old state permutationVector_[i].
+		//! Quantum numbers are small integers, so this is a counting sort,
+		//! or an LSD radix sort in 16-bit digits when their range is wide
+		void sortQuantumNumbers()
+		{
+			size_t n = quantumNumbers_.size();
+			for (size_t i=0;i<n;i++) permutationVector_[i]=i;
+			if (n<2) return;
+
+			size_t qmin = *std::min_element(quantumNumbers_.begin(),quantumNumbers_.end());
+			size_t qmax = *std::max_element(quantumNumbers_.begin(),quantumNumbers_.end());
+			size_t range = qmax - qmin;
+
+			size_t bits = 1;
+			while (bits<16 && (range>>bits)>0) bits++;
+			size_t radix = (1<<bits);
+
+			std::vector<size_t> count(radix);
+			std::vector<size_t> tmp(n);
+			// shifting by the width of size_t or more is undefined
+			size_t width = sizeof(range)*8;
+			for (size_t shift=0;shift<width && (shift==0 || (range>>shift)>0);shift+=bits) {
+				std::fill(count.begin(),count.end(),0);
+				for (size_t i=0;i<n;i++)
+					count[((quantumNumbers_[i]-qmin)>>shift) & (radix-1)]++;
+				size_t sum = 0;
+				for (size_t d=0;d<radix;d++) {
+					size_t c = count[d];
+					count[d] = sum;
+					sum += c;
+				}
+				for (size_t i=0;i<n;i++) {
+					size_t x = permutationVector_[i];
+					tmp[count[((quantumNumbers_[x]-qmin)>>shift) & (radix-1)]++] = x;
+				}
+				permutationVector_.swap(tmp);
+			}
+
+			for (size_t i=0;i<n;i++) tmp[i] = quantumNumbers_[permutationVector_[i]];
+			quantumNumbers_.swap(tmp);
+		}
+
+		//! Direct-index table from quantum number to the first partition
+		//! with that quantum number; left empty if the quantum numbers are
+		//! too spread out, and then partitionFromQn scans the partitions
+		void findQnToPartition()
+		{
+			qnToPartition_.clear();
+			qnOffset_ = 0;
+			if (partition_.size()<2) return;
+
+			size_t qmin = quantumNumbers_[partition_[0]];
+			size_t qmax = qmin;
+			for (size_t i=1;i+1<partition_.size();i++) {
+				size_t q = quantumNumbers_[partition_[i]];
+				if (q<qmin) qmin = q;
+				if (q>qmax) qmax = q;
+			}
+			size_t maxTableSize = 4*size() + 1024;
+			if (qmax-qmin>=maxTableSize) return;
+
+			qnOffset_ = qmin;
+			qnToPartition_.resize(qmax-qmin+1,-1);
+			for (size_t i=0;i+1<partition_.size();i++) {
+				int& p = qnToPartition_[quantumNumbers_[partition_[i]]-qmin];
+				if (p<0) p = i;
+			}
 		}
 	}; // class BasisImplementation
 
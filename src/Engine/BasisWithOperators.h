@@ -135,52 +135,37 @@ namespace Dmrg {
 			// reorder the basis
 			parent.setToProduct(basis2,basis3);
 
-			std::vector<double> fermionicSigns;
 			size_t x = basis2.numberOfOperators()+basis3.numberOfOperators();
 
 			if (this->useSu2Symmetry()) setMomentumOfOperators(basis2);
 			operators_.setToProduct(basis2,basis3,x,this);
 			ApplyFactors<FactorsType> apply(this->getFactors(),this->useSu2Symmetry());
-			int savedSign = 0;
-			for (size_t i=0;i<this->numberOfOperators();i++) {
-				if (i<basis2.numberOfOperators()) {
-					if (!this->useSu2Symmetry()) {
-						const OperatorType& myOp =  basis2.getOperatorByIndex(i);
-						if (savedSign != myOp.fermionSign) {
-							fillFermionicSigns(fermionicSigns,basis2.electronsVector(),myOp.fermionSign);
-							savedSign = myOp.fermionSign;
-						}
-						operators_.externalProduct(i,myOp,basis3.size(),fermionicSigns,true,apply);
-					} else {
+			size_t n2 = basis2.numberOfOperators();
+			if (!this->useSu2Symmetry()) {
+				// products are kept as factors until needed, see OperatorsImplementation
+				std::vector<const OperatorType*> src(x);
+				for (size_t i=0;i<x;i++)
+					src[i] = (i<n2) ? &basis2.getOperatorByIndex(i) : &basis3.getOperatorByIndex(i-n2);
+				operators_.externalProduct(src,n2,basis2,*this,apply);
+			} else {
+				for (size_t i=0;i<x;i++) {
+					if (i<n2)
 						operators_.externalProductReduced(i,basis2,basis3,true,basis2.getReducedOperatorByIndex(i));
-					}
-				} else {
-					if (!this->useSu2Symmetry()) {
-						const OperatorType& myOp = basis3.getOperatorByIndex(i-basis2.numberOfOperators());
-
-						if (savedSign != myOp.fermionSign) {
-							fillFermionicSigns(fermionicSigns,basis2.electronsVector(),myOp.fermionSign);
-							savedSign = myOp.fermionSign;
-						}
-						operators_.externalProduct(i,myOp,basis2.size(),fermionicSigns,false,apply);
-					} else {
+					else
 						operators_.externalProductReduced(i,basis2,basis3,false,
-						   basis3.getReducedOperatorByIndex(i-basis2.numberOfOperators()));
-					}
+						   basis3.getReducedOperatorByIndex(i-n2));
 				}
 			}
 
-			//! Calc. hamiltonian
-			operators_.outerProductHamiltonian(basis2.hamiltonian(),basis3.hamiltonian(),apply);
+			//! Calc. hamiltonian, also already reordered
+			operators_.outerProductHamiltonian(basis2.hamiltonian(),basis3.hamiltonian(),*this,apply);
 			operators_.outerProductHamiltonianReduced(basis2,basis3,basis2.reducedHamiltonian(),basis3.reducedHamiltonian());
-			//! re-order operators and hamiltonian 
-			operators_.reorder(this->permutationVector());
 		}
 
 		//! transform this basis by transform 
 		//! note: basis change must conserve total number of electrons and all quantum numbers
 		template<typename RealType,typename BlockMatrixType,typename SolverParametersType>
-		RealType changeBasis(typename BlockMatrixType::BuildingBlockType& ftransform,
+		RealType changeBasis(BlockDiagonalMatrix<typename BlockMatrixType::BuildingBlockType>& ftransform,
 		                     BlockMatrixType  &transform,
 		                     std::vector<RealType>& eigs,
 		                     size_t kept,const SolverParametersType& solverParams,
@@ -198,9 +183,9 @@ namespace Dmrg {
 		void setHamiltonian(SparseMatrixType const &h) { operators_.setHamiltonian(h); }
 
 		//! Returns the Hamiltonian as stored in this basis
-		SparseMatrixType hamiltonian() const { return operators_.hamiltonian(); }
+		const SparseMatrixType& hamiltonian() const { return operators_.hamiltonian(); }
 
-		SparseMatrixType reducedHamiltonian() const { return operators_.reducedHamiltonian(); }
+		const SparseMatrixType& reducedHamiltonian() const { return operators_.reducedHamiltonian(); }
 
 		void setVarious(BlockType const &block,SparseMatrixType const &h,BasisDataType const &qm,const std::vector<OperatorType>& ops)
 		{
@@ -242,6 +227,15 @@ namespace Dmrg {
 
 		size_t numberOfOperators() const { return operators_.numberOfOperators(); }
 
+		//! see OperatorsImplementation::materialiseAll
+		void materialiseOperators() const { operators_.materialiseAll(); }
+
+		//! approximate bytes used by this basis, mostly its operators
+		size_t memory() const
+		{
+			return operators_.memory() + 6*this->size()*sizeof(size_t);
+		}
+
 		static size_t numberOfOperatorsPerSite()
 		{
 			return 	OperatorsType::numberOfOperatorsPerSite();
@@ -270,14 +264,6 @@ namespace Dmrg {
 	private:
 		OperatorsType operators_;
 
-		template<typename SomeType>
-		void fillFermionicSigns(std::vector<SomeType>& fermionicSigns,const std::vector<size_t>& electrons,int f)
-		{
-			fermionicSigns.resize(electrons.size());
-			for (size_t i=0;i<fermionicSigns.size();i++)
-				fermionicSigns[i]= (electrons[i]%2==0) ? 1.0 : static_cast<double>(f);
-		}
-
 		void setMomentumOfOperators(const ThisType& basis)
 		{
 			std::vector<size_t> momentum;
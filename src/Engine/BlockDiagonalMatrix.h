@@ -0,0 +1,296 @@
+// BEGIN LICENSE BLOCK
+/*
+Copyright (c) 2009, UT-Battelle, LLC
+All rights reserved
+
+[DMRG++, Version 2.0.0]
+[by G.A., Oak Ridge National Laboratory]
+
+UT Battelle Open Source Software License 11242008
+
+OPEN SOURCE LICENSE
+
+Subject to the conditions of this License, each
+contributor to this software hereby grants, free of
+charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"), a
+perpetual, worldwide, non-exclusive, no-charge,
+royalty-free, irrevocable copyright license to use, copy,
+modify, merge, publish, distribute, and/or sublicense
+copies of the Software.
+
+1. Redistributions of Software must retain the above
+copyright and license notices, this list of conditions,
+and the following disclaimer.  Changes or modifications
+to, or derivative works of, the Software should be noted
+with comments and the contributor and organization's
+name.
+
+2. Neither the names of UT-Battelle, LLC or the
+Department of Energy nor the names of the Software
+contributors may be used to endorse or promote products
+derived from this software without specific prior written
+permission of UT-Battelle.
+
+3. The software and the end-user documentation included
+with the redistribution, with or without modification,
+must include the following acknowledgment:
+
+"This product includes software produced by UT-Battelle,
+LLC under Contract No. DE-AC05-00OR22725  with the
+Department of Energy."
+ 
+*********************************************************
+DISCLAIMER
+
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT OWNER, CONTRIBUTORS, UNITED STATES GOVERNMENT,
+OR THE UNITED STATES DEPARTMENT OF ENERGY BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+
+NEITHER THE UNITED STATES GOVERNMENT, NOR THE UNITED
+STATES DEPARTMENT OF ENERGY, NOR THE COPYRIGHT OWNER, NOR
+ANY OF THEIR EMPLOYEES, REPRESENTS THAT THE USE OF ANY
+INFORMATION, DATA, APPARATUS, PRODUCT, OR PROCESS
+DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
+
+*********************************************************
+
+
+*/
+// END LICENSE BLOCK
+/** \ingroup DMRG */
+/*@{*/
+
+/*! \file BlockDiagonalMatrix.h
+ *
+ *  A block diagonal matrix whose blocks need not be square, as the
+ *  truncated DMRG transformation: block m has the rows of symmetry
+ *  block m of the old basis and the kept columns of that block.
+ *  Only the blocks are stored, so that memory and products go with
+ *  the sizes of the blocks instead of the square of the basis size.
+ *
+ */
+#ifndef BLOCK_DIAGONAL_MATRIX_H
+#define BLOCK_DIAGONAL_MATRIX_H
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include "Matrix.h" // in PsimagLite
+#include "BLAS.h" // in PsimagLite
+#include "TypeToString.h" // in PsimagLite
+
+namespace Dmrg {
+
+	template<typename MatrixType>
+	class BlockDiagonalMatrix {
+
+	public:
+		typedef MatrixType BuildingBlockType;
+		typedef typename MatrixType::value_type FieldType;
+
+		BlockDiagonalMatrix() : rowOffsets_(1,0),colOffsets_(1,0) {}
+
+		//! Takes the (square) blocks of a BlockMatrix
+		template<typename SomeBlockMatrixType>
+		void set(const SomeBlockMatrixType& b)
+		{
+			size_t n = b.blocks();
+			rowOffsets_.resize(n+1);
+			data_.resize(n);
+			for (size_t m=0;m<n;m++) {
+				rowOffsets_[m] = b.offsets(m);
+				data_[m] = b(m);
+			}
+			rowOffsets_[n] = b.rank();
+			colOffsets_ = rowOffsets_;
+		}
+
+		//! Removes the columns in removed, keeping the order of the others,
+		//! as utils::truncate(A,removed,false) does for a dense matrix
+		void truncateColumns(const std::vector<size_t>& removed)
+		{
+			if (removed.size()==0) return;
+			size_t ncol = n_col();
+			if (ncol<=removed.size()) throw std::runtime_error(
+				"BlockDiagonalMatrix::truncateColumns(...): too many removed\n");
+			std::vector<bool> isRemoved(ncol,false);
+			for (size_t i=0;i<removed.size();i++) isRemoved[removed[i]] = true;
+
+			std::vector<size_t> colOffsets(colOffsets_.size(),0);
+			for (size_t m=0;m<data_.size();m++) {
+				size_t nrow = data_[m].n_row();
+				std::vector<size_t> kept;
+				for (size_t j=colOffsets_[m];j<colOffsets_[m+1];j++)
+					if (!isRemoved[j]) kept.push_back(j-colOffsets_[m]);
+				colOffsets[m+1] = colOffsets[m] + kept.size();
+				if (kept.size()==data_[m].n_col()) continue;
+				MatrixType b(nrow,kept.size());
+				for (size_t j=0;j<kept.size();j++)
+					for (size_t i=0;i<nrow;i++) b(i,j) = data_[m](i,kept[j]);
+				data_[m] = b;
+			}
+			colOffsets_ = colOffsets;
+		}
+
+		size_t n_row() const { return rowOffsets_[data_.size()]; }
+
+		size_t n_col() const { return colOffsets_[data_.size()]; }
+
+		size_t blocks() const { return data_.size(); }
+
+		size_t rowOffset(size_t m) const { return rowOffsets_[m]; }
+
+		size_t colOffset(size_t m) const { return colOffsets_[m]; }
+
+		const MatrixType& block(size_t m) const { return data_[m]; }
+
+		//! Element (i,j), zero outside the blocks
+		FieldType operator()(size_t i,size_t j) const
+		{
+			size_t m = blockOfRow(i);
+			if (j<colOffsets_[m] || j>=colOffsets_[m+1]) return 0.0;
+			return data_[m](i-rowOffsets_[m],j-colOffsets_[m]);
+		}
+
+		//! ret = T^\dagger * O * T, where T is this matrix and O is dense
+		void transform(MatrixType& ret,const MatrixType& O) const
+		{
+			int nBig = n_row();
+			int nSmall = n_col();
+			if (ret.n_row()!=size_t(nSmall) || ret.n_col()!=size_t(nSmall))
+				ret.reset(nSmall,nSmall);
+			if (nSmall==0) return;
+			MatrixType fmTmp(nBig,nSmall);
+			FieldType alpha=1.0,beta=0.0;
+			for (size_t m=0;m<data_.size();m++) {
+				int bs = data_[m].n_row();
+				int kept = data_[m].n_col();
+				if (bs==0 || kept==0) continue;
+				psimag::BLAS::GEMM('N','N',nBig,kept,bs,alpha,
+						&(O(0,rowOffsets_[m])),nBig,&(data_[m](0,0)),bs,beta,
+						&(fmTmp(0,colOffsets_[m])),nBig);
+			}
+			multiplyLeft(ret,fmTmp);
+		}
+
+		//! ret = T^\dagger * v * T, where T is this matrix and v is sparse
+		template<typename SparseMatrixType>
+		void transform(MatrixType& ret,const SparseMatrixType& v) const
+		{
+			size_t nBig = n_row();
+			size_t nSmall = n_col();
+			if (ret.n_row()!=nSmall || ret.n_col()!=nSmall)
+				ret.reset(nSmall,nSmall);
+			if (nSmall==0) return;
+			MatrixType fmTmp(nBig,nSmall);
+			for (size_t i=0;i<nBig;i++) {
+				for (int k=v.getRowPtr(i);k<v.getRowPtr(i+1);k++) {
+					size_t j = v.getCol(k);
+					size_t m = blockOfRow(j);
+					size_t jj = j - rowOffsets_[m];
+					for (size_t c=0;c<data_[m].n_col();c++)
+						fmTmp(i,colOffsets_[m]+c) += v.getValue(k)*data_[m](jj,c);
+				}
+			}
+			multiplyLeft(ret,fmTmp);
+		}
+
+		//! The same matrix, in compressed row storage
+		template<typename SparseMatrixType>
+		void toSparse(SparseMatrixType& sparse) const
+		{
+			size_t nrow = n_row();
+			sparse.resize(nrow,n_col());
+			size_t counter = 0;
+			for (size_t m=0;m<data_.size();m++) {
+				for (size_t i=0;i<data_[m].n_row();i++) {
+					sparse.setRow(rowOffsets_[m]+i,counter);
+					for (size_t j=0;j<data_[m].n_col();j++) {
+						if (data_[m](i,j)==static_cast<FieldType>(0.0)) continue;
+						sparse.pushCol(colOffsets_[m]+j);
+						sparse.pushValue(data_[m](i,j));
+						counter++;
+					}
+				}
+			}
+			sparse.setRow(nrow,counter);
+		}
+
+		template<typename IoOutputter>
+		void save(IoOutputter& io,const std::string& label) const
+		{
+			io.printline(label);
+			std::string s="#blocks="+ttos(data_.size());
+			io.printline(s);
+			io.printVector(rowOffsets_,"#rowOffsets");
+			io.printVector(colOffsets_,"#colOffsets");
+			for (size_t m=0;m<data_.size();m++)
+				io.printMatrix(data_[m],"#block");
+		}
+
+		template<typename IoInputter>
+		void load(IoInputter& io,const std::string& label,size_t counter=0)
+		{
+			io.advance(label,counter);
+			int x = 0;
+			io.readline(x,"#blocks=");
+			if (x<0) throw std::runtime_error(
+				"BlockDiagonalMatrix::load(...): blocks<0\n");
+			io.read(rowOffsets_,"#rowOffsets");
+			io.read(colOffsets_,"#colOffsets");
+			if (rowOffsets_.size()!=size_t(x)+1 || colOffsets_.size()!=size_t(x)+1)
+				throw std::runtime_error(
+					"BlockDiagonalMatrix::load(...): wrong offsets\n");
+			data_.resize(x);
+			for (size_t m=0;m<data_.size();m++)
+				io.readMatrix(data_[m],"#block");
+		}
+
+	private:
+
+		size_t blockOfRow(size_t i) const
+		{
+			return std::upper_bound(rowOffsets_.begin(),rowOffsets_.end(),i)
+				- rowOffsets_.begin() - 1;
+		}
+
+		// ret = T^\dagger * fmTmp, where fmTmp has n_row() rows
+		void multiplyLeft(MatrixType& ret,const MatrixType& fmTmp) const
+		{
+			int nBig = n_row();
+			int nSmall = n_col();
+			FieldType alpha=1.0,beta=0.0;
+			for (size_t m=0;m<data_.size();m++) {
+				int bs = data_[m].n_row();
+				int kept = data_[m].n_col();
+				if (kept==0) continue;
+				if (bs==0) throw std::runtime_error(
+					"BlockDiagonalMatrix::multiplyLeft(...): empty block\n");
+				psimag::BLAS::GEMM('C','N',kept,nSmall,bs,alpha,
+						&(data_[m](0,0)),bs,&(fmTmp(rowOffsets_[m],0)),nBig,beta,
+						&(ret(colOffsets_[m],0)),nSmall);
+			}
+		}
+
+		std::vector<size_t> rowOffsets_;
+		std::vector<size_t> colOffsets_;
+		std::vector<MatrixType> data_;
+	}; // class BlockDiagonalMatrix
+} // namespace Dmrg
+
+/*@}*/
+#endif // BLOCK_DIAGONAL_MATRIX_H
@@ -83,7 +83,12 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 #define BLOCKMATRIX_HEADER_H
 #include <vector>
 #include <iostream>
+#include <algorithm>
+#include <functional>
+#include <cmath>
 #include "Matrix.h" // in psimag
+#include "LapackExtra.h"
+#include "Threads.h"
 
 namespace Dmrg {
 
@@ -175,6 +180,9 @@ namespace Dmrg {
 		template<typename S,typename Field,typename ConcurrencyTemplate>
 		friend void diagonalise(BlockMatrix<S,PsimagLite::Matrix<S> >  &C,std::vector<Field> &eigs,char option,ConcurrencyTemplate &concurrency);
 		
+		template<typename S,typename Field,typename ConcurrencyTemplate>
+		friend void diagonalise(BlockMatrix<S,PsimagLite::Matrix<S> >  &C,std::vector<Field> &eigs,char option,size_t kept,ConcurrencyTemplate &concurrency);
+		
 	private:
 		int rank_; //the rank of this matrix
 		std::vector<int> offsets_; //starting of diagonal offsets for each block
@@ -262,11 +270,155 @@ namespace Dmrg {
 	}
 
 
+	//! Calls op(m) for each block m in order, in the thread pool
+	template<typename BlockOperationType>
+	class BlockLoop {
+	public:
+		BlockLoop(BlockOperationType& op,const std::vector<size_t>& order)
+		: op_(op),order_(order)
+		{}
+
+		void thread_function_(size_t threadNum,size_t blockSize,pthread_mutex_t*)
+		{
+			for (size_t p=0;p<blockSize;p++) {
+				size_t i = threadNum*blockSize + p;
+				if (i>=order_.size()) break;
+				op_(order_[i]);
+			}
+		}
+
+	private:
+		BlockOperationType& op_;
+		const std::vector<size_t>& order_;
+	}; // class BlockLoop
+
+	//! Calls op(m) for the blocks m that concurrency gives to this process,
+	//! in the thread pool, largest block first (the work of diagonalising a
+	//! block of size n goes as n^3). If LAPACK is threaded (see
+	//! setLapackThreads) each block with more than a thread's share of the
+	//! work is done before, alone, by all the threads of LAPACK. The
+	//! number of threads of LAPACK is then set back to what it was.
+	template<typename BlockOperationType,typename ConcurrencyTemplate>
+	void loopOverBlocks(BlockOperationType& op,const std::vector<size_t>& sizes,ConcurrencyTemplate& concurrency)
+	{
+		std::vector<std::pair<size_t,size_t> > bySize;
+		size_t m = 0;
+		concurrency.loopCreate(sizes.size(),sizes);
+		while(concurrency.loop(m)) bySize.push_back(std::pair<size_t,size_t>(sizes[m],m));
+		std::sort(bySize.begin(),bySize.end(),std::greater<std::pair<size_t,size_t> >());
+
+		double work = 0;
+		for (size_t i=0;i<bySize.size();i++) work += pow(double(bySize[i].first),3.0);
+
+		size_t nthreads = Threads::threads();
+		size_t previous = lapackThreads();
+		size_t i = 0;
+		if (nthreads>1 && setLapackThreads(nthreads)) {
+			for (;i<bySize.size();i++) {
+				if (pow(double(bySize[i].first),3.0)*nthreads<=work) break;
+				op(bySize[i].second);
+			}
+			setLapackThreads(1);
+		}
+
+		std::vector<size_t> order;
+		for (;i<bySize.size();i++) order.push_back(bySize[i].second);
+		BlockLoop<BlockOperationType> blockLoop(op,order);
+		Threads::loopCreateInOrder(order.size(),blockLoop);
+		if (nthreads>1 && previous>0) setLapackThreads(previous);
+	}
+
+	//! Diagonalises block m, all its eigenpairs
+	template<typename S,typename Field>
+	class DiagonaliseBlock {
+	public:
+		DiagonaliseBlock(std::vector<PsimagLite::Matrix<S> >& data,
+		                 std::vector<std::vector<Field> >& eigs,
+		                 char option)
+		: data_(data),eigs_(eigs),option_(option)
+		{}
+
+		void operator()(size_t m)
+		{
+			std::vector<Field> eigsTmp;
+			PsimagLite::diag(data_[m],eigsTmp,option_);
+			enforcePhase(data_[m]);
+			for (size_t j=0;j<eigs_[m].size();j++) eigs_[m][j] = eigsTmp[j];
+		}
+
+	private:
+		std::vector<PsimagLite::Matrix<S> >& data_;
+		std::vector<std::vector<Field> >& eigs_;
+		char option_;
+	}; // class DiagonaliseBlock
+
+	//! Eigenvalues of block m; the block is reduced to tridiagonal form,
+	//! kept in tridiagonal[m] and in the block itself for BlockEigenvectors
+	template<typename S,typename Field>
+	class BlockEigenvalues {
+	public:
+		BlockEigenvalues(std::vector<PsimagLite::Matrix<S> >& data,
+		                 std::vector<std::vector<Field> >& eigs,
+		                 std::vector<TridiagonalForm<S> >& tridiagonal)
+		: data_(data),eigs_(eigs),tridiagonal_(tridiagonal)
+		{}
+
+		void operator()(size_t m)
+		{
+			tridiagonalise(tridiagonal_[m],data_[m]);
+			eigenvalues(eigs_[m],tridiagonal_[m]);
+		}
+
+	private:
+		std::vector<PsimagLite::Matrix<S> >& data_;
+		std::vector<std::vector<Field> >& eigs_;
+		std::vector<TridiagonalForm<S> >& tridiagonal_;
+	}; // class BlockEigenvalues
+
+	//! Eigenvectors of block m with eigenvalue not smaller than threshold,
+	//! given all the eigenvalues of the block in eigs[m] and its reduction
+	//! by BlockEigenvalues; the other columns are set to zero. eigs[m] is
+	//! not changed: the eigenvalues computed again with the vectors may
+	//! differ by round-off, and then the truncation could choose a column
+	//! that is zero
+	template<typename S,typename Field>
+	class BlockEigenvectors {
+	public:
+		BlockEigenvectors(std::vector<PsimagLite::Matrix<S> >& data,
+		                  std::vector<std::vector<Field> >& eigs,
+		                  const std::vector<TridiagonalForm<S> >& tridiagonal,
+		                  const Field& threshold)
+		: data_(data),eigs_(eigs),tridiagonal_(tridiagonal),threshold_(threshold)
+		{}
+
+		void operator()(size_t m)
+		{
+			int n = eigs_[m].size();
+			// eigenvalues are in increasing order, so the ones to compute are the last
+			int first = n;
+			while (first>0 && eigs_[m][first-1]>=threshold_) first--;
+
+			PsimagLite::Matrix<S> z;
+			std::vector<Field> eigsTmp;
+			eigenvectorsInRange(z,eigsTmp,tridiagonal_[m],data_[m],first+1,n);
+			data_[m].reset(n,n);
+			for (int j=0;j<n;j++)
+				for (int i=0;i<n;i++)
+					data_[m](i,j) = (j<first) ? 0.0 : z(i,j-first);
+			enforcePhase(data_[m]);
+		}
+
+	private:
+		std::vector<PsimagLite::Matrix<S> >& data_;
+		std::vector<std::vector<Field> >& eigs_;
+		const std::vector<TridiagonalForm<S> >& tridiagonal_;
+		Field threshold_;
+	}; // class BlockEigenvectors
+
 	//! Parallel version of the diagonalization of a block diagonal matrix
 	template<typename S,typename Field,typename ConcurrencyTemplate>
 	void diagonalise(BlockMatrix<S,PsimagLite::Matrix<S> >  &C,std::vector<Field> &eigs,char option,ConcurrencyTemplate &concurrency)
 	{
-		std::vector<Field> eigsTmp;
 		std::vector<std::vector<Field> > eigsForGather;
 		std::vector<size_t> weights(C.blocks());
 		
@@ -279,13 +431,8 @@ namespace Dmrg {
 		
 		eigs.resize(C.rank());
 		
-		concurrency.loopCreate(C.blocks(),weights);
-		
-		while(concurrency.loop(m)) {
-			PsimagLite::diag(C.data_[m],eigsTmp,option);
-			enforcePhase(C.data_[m]);
-			for (int j=C.offsets(m);j< C.offsets(m+1);j++) eigsForGather[m][j-C.offsets(m)] = eigsTmp[j-C.offsets(m)];
-		}
+		DiagonaliseBlock<S,Field> diagonaliseBlock(C.data_,eigsForGather,option);
+		loopOverBlocks(diagonaliseBlock,weights,concurrency);
 		
 		concurrency.gather(C.data_);
 		concurrency.gather(eigsForGather);
@@ -298,6 +445,56 @@ namespace Dmrg {
 		concurrency.broadcast(C.data_);
 	}
 
+	//! Same as diagonalise above, but only the eigenvectors that can be kept
+	//! are computed: first all eigenvalues of all blocks, from which the
+	//! kept-th largest eigenvalue is the threshold, and then, in each block,
+	//! the eigenvectors of the eigenvalues not smaller than the threshold.
+	//! Each block is reduced to tridiagonal form only once, for both steps;
+	//! loopOverBlocks gives block m to the same process both times.
+	//! The columns of the other eigenvectors are left zero; they're removed
+	//! by the truncation, since their eigenvalues are the smallest ones.
+	template<typename S,typename Field,typename ConcurrencyTemplate>
+	void diagonalise(BlockMatrix<S,PsimagLite::Matrix<S> >  &C,std::vector<Field> &eigs,char option,size_t kept,ConcurrencyTemplate &concurrency)
+	{
+		if (option!='V' || kept==0 || kept>=size_t(C.rank())) {
+			diagonalise(C,eigs,option,concurrency);
+			return;
+		}
+
+		std::vector<std::vector<Field> > eigsForGather(C.blocks());
+		std::vector<size_t> weights(C.blocks());
+		size_t m;
+		for (m=0;m<C.blocks();m++) {
+			eigsForGather[m].resize(C.offsets(m+1)-C.offsets(m));
+			weights[m] =  C.offsets(m+1)-C.offsets(m);
+		}
+
+		std::vector<TridiagonalForm<S> > tridiagonal(C.blocks());
+		BlockEigenvalues<S,Field> blockEigenvalues(C.data_,eigsForGather,tridiagonal);
+		loopOverBlocks(blockEigenvalues,weights,concurrency);
+		concurrency.gather(eigsForGather);
+
+		eigs.resize(C.rank());
+		for (m=0;m<C.blocks();m++) {
+			for (int j=C.offsets(m);j< C.offsets(m+1);j++) eigs[j]=eigsForGather[m][j-C.offsets(m)];
+		}
+		concurrency.broadcast(eigs);
+		for (m=0;m<C.blocks();m++) {
+			for (int j=C.offsets(m);j< C.offsets(m+1);j++) eigsForGather[m][j-C.offsets(m)]=eigs[j];
+		}
+
+		std::vector<Field> sorted = eigs;
+		std::nth_element(sorted.begin(),sorted.begin()+kept-1,sorted.end(),std::greater<Field>());
+		Field threshold = sorted[kept-1];
+
+		BlockEigenvectors<S,Field> blockEigenvectors(C.data_,eigsForGather,tridiagonal,threshold);
+		loopOverBlocks(blockEigenvectors,weights,concurrency);
+
+		// eigs are those of the first pass, already on all processes
+		concurrency.gather(C.data_);
+		concurrency.broadcast(C.data_);
+	}
+
 	template<class S,class MatrixInBlockTemplate>
 	bool isUnitary(BlockMatrix<S,MatrixInBlockTemplate> const &B)
 	{
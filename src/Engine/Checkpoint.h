@@ -83,8 +83,9 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 #ifndef CHECKPOINT_H
 #define CHECKPOINT_H
 
-#include <stack>
 #include "DiskStack.h"
+#include "SpillingStack.h"
+#include "CheckpointManifest.h"
 #include "ProgressIndicator.h"
 
 namespace Dmrg {
@@ -95,8 +96,9 @@ namespace Dmrg {
 		typedef typename TargettingType::RealType  RealType;
 		typedef typename TargettingType::BasisWithOperatorsType BasisWithOperatorsType;
 		typedef typename TargettingType::IoType IoType;
-		typedef std::stack<BasisWithOperatorsType> MemoryStackType;
-		typedef DiskStack<BasisWithOperatorsType>  DiskStackType;
+		typedef SpillingStack<BasisWithOperatorsType,IoType> MemoryStackType;
+		typedef typename MemoryStackType::SharedType SharedBasisType;
+		typedef DiskStack<BasisWithOperatorsType,IoType>  DiskStackType;
 
 		enum {SYSTEM,ENVIRON};
 
@@ -108,21 +110,43 @@ namespace Dmrg {
 			ENVIRON_STACK_STRING("EnvironStack"),
 			parameters_(parameters),
 			enabled_(parameters_.options.find("checkpoint")!=std::string::npos),
-			systemDisk_(SYSTEM_STACK_STRING+parameters_.checkpoint.filename , SYSTEM_STACK_STRING+parameters_.filename,enabled_,rank),
-			envDisk_(ENVIRON_STACK_STRING+parameters_.checkpoint.filename , ENVIRON_STACK_STRING+parameters_.filename,enabled_,rank),
-			progress_("Checkpoint",rank)
+			resume_(enabled_ && resumeFrom_.load(parameters_.checkpoint.filename,
+			                                     parameters_.checkpoint.position)),
+			keep_(parameters_.options.find("keepCheckpoints")!=std::string::npos),
+			systemStack_(appendWithDir("SpillSystem"+ttos(rank)+"_",parameters_.filename),
+			             parameters_.stackMemory*1024*1024),
+			envStack_(appendWithDir("SpillEnviron"+ttos(rank)+"_",parameters_.filename),
+			          parameters_.stackMemory*1024*1024),
+			systemDisk_(SYSTEM_STACK_STRING+parameters_.checkpoint.filename , SYSTEM_STACK_STRING+parameters_.filename,enabled_ && !resume_,rank),
+			envDisk_(ENVIRON_STACK_STRING+parameters_.checkpoint.filename , ENVIRON_STACK_STRING+parameters_.filename,enabled_ && !resume_,rank),
+			progress_("Checkpoint",rank),
+			rank_(rank),
+			steps_(0),
+			store_(0),
+			stored_(0),
+			systemStore_(0),
+			envStore_(0)
 		{
-			if (!enabled_) return;
-			if (parameters_.checkpoint.filename == parameters_.filename) {
+			if (enabled_ && parameters_.checkpoint.filename == parameters_.filename) {
 				throw std::runtime_error("Checkpoint::ctor(...): "
 						"this run will overwrite previous, throwing\n");
 			}
-			loadStacksDiskToMemory();
+			if (enabled_ && parameters_.checkpoint.position>0 && !resume_) {
+				throw std::runtime_error("Checkpoint::ctor(...): " + parameters_.checkpoint.filename +
+					" has no checkpoint " + ttos(parameters_.checkpoint.position) +
+					" (was it run with keepCheckpoints?)\n");
+			}
+			if (parameters_.checkpoint.every>0 || resume_ || keep_) openStores();
+			if (!enabled_) return;
+			if (resume_) loadStacksFromStores();
+			else loadStacksDiskToMemory();
 		}
 
 		~Checkpoint()
 		{
 			 loadStacksMemoryToDisk();
+			 delete systemStore_;
+			 delete envStore_;
 		}
 
 		// Not related to stacks
@@ -138,6 +162,14 @@ namespace Dmrg {
 		// Not related to stacks
 		void load(BasisWithOperatorsType &pS,BasisWithOperatorsType &pE,TargettingType& psi)
 		{
+			if (resume_) {
+				// the stacks are those of the incremental checkpoint resumed
+				pS = *systemStack_.top();
+				pE = *envStack_.top();
+				const std::string& f = parameters_.checkpoint.filename;
+				psi.load(CheckpointManifest::targetFile(f,resumeFrom_.generation));
+				return;
+			}
 
 			typename IoType::In ioTmp(parameters_.checkpoint.filename);
 			size_t loop = ioTmp.count("#NAME=#CHKPOINTSYSTEM");
@@ -155,20 +187,123 @@ namespace Dmrg {
 
 		void push(const BasisWithOperatorsType &pS,const BasisWithOperatorsType &pE)
 		{
-			systemStack_.push(pS);
-			envStack_.push(pE);
+			push(systemStack_,systemRecords_,SharedBasisType(pS));
+			push(envStack_,envRecords_,SharedBasisType(pE));
 		}
 
 		void push(const BasisWithOperatorsType &pSorE,size_t what)
 		{
-			if (what==ENVIRON) envStack_.push(pSorE);
-			else systemStack_.push(pSorE);
+			if (what==ENVIRON) push(envStack_,envRecords_,SharedBasisType(pSorE));
+			else push(systemStack_,systemRecords_,SharedBasisType(pSorE));
 		}
 
-		BasisWithOperatorsType shrink(size_t what)
+		//! the handle shares the basis with the stack, so it is not copied
+		const SharedBasisType& shrink(size_t what)
 		{
-			if (what==ENVIRON) return shrink(envStack_);
-			else return shrink(systemStack_);
+			if (what==ENVIRON) return shrink(envStack_,envRecords_);
+			else return shrink(systemStack_,systemRecords_);
+		}
+
+		//! True once every CheckpointEvery calls, see saveIncremental
+		bool incrementalDue()
+		{
+			if (parameters_.checkpoint.every==0) return false;
+			steps_++;
+			return (steps_ % parameters_.checkpoint.every == 0);
+		}
+
+		//! Writes a checkpoint from which a run can continue at
+		//! this finite loop position: the stack entries and wft transforms
+		//! not written by previous calls, the target and the rest of the
+		//! wft, and then the manifest that names them. If atLoopStart, it
+		//! is taken before the loop starts, and stepFinal is not used
+		template<typename WftType>
+		void saveIncremental(size_t loop,
+		                     int stepCurrent,
+		                     int stepFinal,
+		                     const std::vector<size_t>& block,
+		                     const TargettingType& psi,
+		                     WftType& wft,
+		                     bool atLoopStart = false)
+		{
+			// entries popped or replaced stay in the stores; once they
+			// are most of them, the entries in use go to new stores
+			if (stored_>2*(systemRecords_.size()+envRecords_.size())) {
+				store_++;
+				openStores();
+				systemRecords_.assign(systemRecords_.size(),-1);
+				envRecords_.assign(envRecords_.size(),-1);
+			}
+
+			CheckpointManifest m;
+			m.generation = last_.generation + 1;
+			m.store = store_;
+			m.loop = loop;
+			m.stepCurrent = stepCurrent;
+			m.stepFinal = stepFinal;
+			m.atLoopStart = atLoopStart;
+
+			std::ostringstream msg;
+			msg<<"Incremental checkpoint "<<m.generation<<" at loop "<<loop;
+			if (atLoopStart) msg<<" start";
+			else msg<<" step "<<stepCurrent;
+			progress_.printline(msg,std::cout);
+
+			appendToStore(*systemStore_,systemStack_,systemRecords_);
+			appendToStore(*envStore_,envStack_,envRecords_);
+			m.system = systemRecords_;
+			m.environment = envRecords_;
+
+			std::string target = CheckpointManifest::targetFile(parameters_.filename,m.generation);
+			typename IoType::Out io(target,rank_);
+			psi.save(block,io);
+			io.close();
+
+			m.hasWft = wft.isEnabled();
+			if (m.hasWft) wft.saveIncremental(CheckpointManifest::wftFile(parameters_.filename,m.generation),
+			                                  CheckpointManifest::transformFile(parameters_.filename,m.store));
+
+			m.save(parameters_.filename,rank_,keep_);
+			if (!keep_) {
+				removeGeneration(last_);
+				if (last_.generation>0 && last_.store!=m.store) removeStores(last_.store);
+			}
+			last_ = m;
+		}
+
+		//! Removes the incremental checkpoints of this run,
+		//! not needed once it ends normally, except those kept
+		//! with keepCheckpoints
+		void removeIncremental()
+		{
+			if (!systemStore_) return;
+			delete systemStore_;
+			delete envStore_;
+			systemStore_ = envStore_ = 0;
+			if (rank_>0) return;
+			if (keep_) {
+				std::remove(CheckpointManifest::manifestFile(parameters_.filename).c_str());
+				return;
+			}
+			removeStores(store_);
+			std::remove(CheckpointManifest::manifestFile(parameters_.filename).c_str());
+			removeGeneration(last_);
+		}
+
+		//! True if this run continues from an incremental checkpoint:
+		//! the last one of a run that did not end, or a kept one
+		bool resuming() const { return resume_; }
+
+		//! True if every incremental checkpoint is kept (option keepCheckpoints)
+		bool keeping() const { return keep_; }
+
+		const CheckpointManifest& resumePoint() const { return resumeFrom_; }
+
+		//! starts reading ahead what the next shrink(what) will need, if on disk
+		void prefetch(size_t what)
+		{
+			if (what==ENVIRON) envStack_.prefetch();
+			else systemStack_.prefetch();
 		}
 
 		bool operator()() const { return enabled_; }
@@ -179,28 +314,121 @@ namespace Dmrg {
 			return systemStack_.size();
 		}
 
+		//! The entry i, counting from the bottom, of stack what
+		SharedBasisType stackEntry(size_t what,size_t i) const
+		{
+			if (what==ENVIRON) return envStack_.entry(i);
+			return systemStack_.entry(i);
+		}
+
+		//! Replaces the entry i, counting from the bottom, of stack what;
+		//! the next incremental checkpoint stores it again
+		void replaceStackEntry(size_t what,size_t i,const BasisWithOperatorsType& x)
+		{
+			if (what==ENVIRON) {
+				envStack_.replace(i,SharedBasisType(x));
+				envRecords_[i] = -1;
+			} else {
+				systemStack_.replace(i,SharedBasisType(x));
+				systemRecords_[i] = -1;
+			}
+		}
+
 	private:
 		const ParametersType& parameters_;
 		bool enabled_;
-		MemoryStackType systemStack_,envStack_; // <--we're the owner
+		CheckpointManifest resumeFrom_;
+		bool resume_;
+		bool keep_;
+		MemoryStackType systemStack_,envStack_; // <--we're the owner, deep entries may be on disk
 		DiskStackType systemDisk_,envDisk_;
 		PsimagLite::ProgressIndicator progress_;
+		size_t rank_;
+		size_t steps_;
+		CheckpointManifest last_;
+		size_t store_; // number of the stores appended to
+		size_t stored_; // entries in them
+		// record in the store of each stack entry, bottom first, or -1 if not stored yet
+		std::vector<int> systemRecords_,envRecords_;
+		DiskStackType* systemStore_; // for incremental checkpoints
+		DiskStackType* envStore_;
+
+		void push(MemoryStackType& thisStack,std::vector<int>& records,const SharedBasisType& x)
+		{
+			thisStack.push(x);
+			records.push_back(-1);
+		}
 
 		//! shrink  (we don't really shrink, we just undo the growth)
-		BasisWithOperatorsType shrink(MemoryStackType& thisStack)
+		const SharedBasisType& shrink(MemoryStackType& thisStack,std::vector<int>& records)
 		{
 			thisStack.pop();
+			records.pop_back();
 			return thisStack.top();
 		}
 
+		//! writes the entries that are not in the store yet
+		void appendToStore(DiskStackType& store,const MemoryStackType& thisStack,std::vector<int>& records)
+		{
+			for (size_t i=0;i<records.size();i++) {
+				if (records[i]>=0) continue;
+				records[i] = store.append(*thisStack.entry(i));
+				stored_++;
+			}
+		}
+
+		//! (Re)creates the stores numbered store_, empty
+		void openStores()
+		{
+			delete systemStore_;
+			delete envStore_;
+			const std::string& f = parameters_.checkpoint.filename;
+			systemStore_ = new DiskStackType(CheckpointManifest::storeFile(f,true,resumeFrom_.store),
+			                                 CheckpointManifest::storeFile(parameters_.filename,true,store_),
+			                                 false,rank_);
+			envStore_ = new DiskStackType(CheckpointManifest::storeFile(f,false,resumeFrom_.store),
+			                              CheckpointManifest::storeFile(parameters_.filename,false,store_),
+			                              false,rank_);
+			stored_ = 0;
+		}
+
+		void removeStores(size_t store)
+		{
+			if (rank_>0) return;
+			std::remove(CheckpointManifest::storeFile(parameters_.filename,true,store).c_str());
+			std::remove(CheckpointManifest::storeFile(parameters_.filename,false,store).c_str());
+			std::remove(CheckpointManifest::transformFile(parameters_.filename,store).c_str());
+		}
+
+		void removeGeneration(const CheckpointManifest& m)
+		{
+			if (m.generation==0 || rank_>0) return;
+			std::remove(CheckpointManifest::targetFile(parameters_.filename,m.generation).c_str());
+			std::remove(CheckpointManifest::wftFile(parameters_.filename,m.generation).c_str());
+		}
+
+		void loadStacksFromStores()
+		{
+			std::ostringstream msg;
+			msg<<"Loading sys. and env. stacks of incremental checkpoint "<<resumeFrom_.generation<<"...";
+			progress_.printline(msg,std::cout);
+
+			const std::vector<int>& s = resumeFrom_.system;
+			for (size_t i=0;i<s.size();i++)
+				push(systemStack_,systemRecords_,SharedBasisType(systemStore_->entry(s[i])));
+			const std::vector<int>& e = resumeFrom_.environment;
+			for (size_t i=0;i<e.size();i++)
+				push(envStack_,envRecords_,SharedBasisType(envStore_->entry(e[i])));
+		}
+
 		void loadStacksDiskToMemory()
 		{
 			std::ostringstream msg;
 			msg<<"Loading sys. and env. stacks from disk...";
 			progress_.printline(msg,std::cout);
 
-			loadStack(systemStack_,systemDisk_);
-			loadStack(envStack_,envDisk_);
+			loadStackFromDisk(systemStack_,systemRecords_,systemDisk_);
+			loadStackFromDisk(envStack_,envRecords_,envDisk_);
 		}
 
 		void loadStacksMemoryToDisk()
@@ -208,19 +436,25 @@ namespace Dmrg {
 			std::ostringstream msg;
 			msg<<"Writing sys. and env. stacks to disk...";
 			progress_.printline(msg,std::cout);
-			loadStack(systemDisk_,systemStack_);
-			loadStack(envDisk_,envStack_);
+			loadStackToDisk(systemDisk_,systemStack_,systemRecords_);
+			loadStackToDisk(envDisk_,envStack_,envRecords_);
 		}
 
-		template<typename StackType1,typename StackType2>
-		void loadStack(StackType1& stackInMemory,StackType2& stackInDisk)
+		void loadStackFromDisk(MemoryStackType& stackInMemory,std::vector<int>& records,DiskStackType& stackInDisk)
 		{
 			while (stackInDisk.size()>0) {
-				BasisWithOperatorsType b = stackInDisk.top();
-				stackInMemory.push(b);
+				push(stackInMemory,records,SharedBasisType(stackInDisk.top()));
 				stackInDisk.pop();
 			}
+		}
 
+		void loadStackToDisk(DiskStackType& stackInDisk,MemoryStackType& stackInMemory,std::vector<int>& records)
+		{
+			while (stackInMemory.size()>0) {
+				stackInDisk.push(*stackInMemory.top());
+				stackInMemory.pop();
+				records.pop_back();
+			}
 		}
 
 		//! Move elsewhere
@@ -0,0 +1,218 @@
+// BEGIN LICENSE BLOCK
+/*
+Copyright (c) 2009, UT-Battelle, LLC
+All rights reserved
+
+[DMRG++, Version 2.0.0]
+[by G.A., Oak Ridge National Laboratory]
+
+UT Battelle Open Source Software License 11242008
+
+OPEN SOURCE LICENSE
+
+Subject to the conditions of this License, each
+contributor to this software hereby grants, free of
+charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"), a
+perpetual, worldwide, non-exclusive, no-charge,
+royalty-free, irrevocable copyright license to use, copy,
+modify, merge, publish, distribute, and/or sublicense
+copies of the Software.
+
+1. Redistributions of Software must retain the above
+copyright and license notices, this list of conditions,
+and the following disclaimer.  Changes or modifications
+to, or derivative works of, the Software should be noted
+with comments and the contributor and organization's
+name.
+
+2. Neither the names of UT-Battelle, LLC or the
+Department of Energy nor the names of the Software
+contributors may be used to endorse or promote products
+derived from this software without specific prior written
+permission of UT-Battelle.
+
+3. The software and the end-user documentation included
+with the redistribution, with or without modification,
+must include the following acknowledgment:
+
+"This product includes software produced by UT-Battelle,
+LLC under Contract No. DE-AC05-00OR22725  with the
+Department of Energy."
+ 
+*********************************************************
+DISCLAIMER
+
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT OWNER, CONTRIBUTORS, UNITED STATES GOVERNMENT,
+OR THE UNITED STATES DEPARTMENT OF ENERGY BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+
+NEITHER THE UNITED STATES GOVERNMENT, NOR THE UNITED
+STATES DEPARTMENT OF ENERGY, NOR THE COPYRIGHT OWNER, NOR
+ANY OF THEIR EMPLOYEES, REPRESENTS THAT THE USE OF ANY
+INFORMATION, DATA, APPARATUS, PRODUCT, OR PROCESS
+DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
+
+*********************************************************
+
+
+*/
+// END LICENSE BLOCK
+/** \ingroup DMRG */
+/*@{*/
+
+/*! \file CheckpointManifest.h
+ *
+ *  Describes an incremental checkpoint of a run (options hasCheckpointEvery
+ *  and keepCheckpoints): the finite loop position, the record of
+ *  each entry of the system and environment stacks in the stack
+ *  stores, and the files with the target and the Wft of that
+ *  checkpoint. The stores only grow, so when most of what they hold
+ *  is no longer used they are replaced by new ones, whose files have
+ *  the next store number in their names. The manifest of the last
+ *  checkpoint is replaced by a rename once all the files it names are
+ *  complete, so after a crash it describes the last checkpoint that
+ *  was fully written. A run that ends normally removes it. With
+ *  keepCheckpoints each checkpoint also has its own manifest, numbered
+ *  by generation, which is kept.
+ */
+#ifndef CHECKPOINT_MANIFEST_H
+#define CHECKPOINT_MANIFEST_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+#include <stdexcept>
+#include "IoSimple.h" // in PsimagLite
+#include "TypeToString.h" // in PsimagLite
+
+namespace Dmrg {
+
+	class CheckpointManifest {
+
+		typedef PsimagLite::IoSimple::In IoInType;
+		typedef PsimagLite::IoSimple::Out IoOutType;
+
+	public:
+
+		CheckpointManifest()
+		: generation(0),store(0),loop(0),stepCurrent(0),stepFinal(0),atLoopStart(false),hasWft(false)
+		{}
+
+		//! the files of the checkpoints of the run that writes to filename
+		static std::string manifestFile(const std::string& filename)
+		{
+			return "Resume" + filename;
+		}
+
+		static std::string manifestFile(const std::string& filename,size_t generation)
+		{
+			return "Resume" + ttos(generation) + "_" + filename;
+		}
+
+		static std::string storeFile(const std::string& filename,bool system,size_t store)
+		{
+			return (system ? "ResumeSystem" : "ResumeEnviron") + ttos(store) + "_" + filename;
+		}
+
+		//! the transforms of the Wft, see WaveFunctionTransfFactory::saveIncremental
+		static std::string transformFile(const std::string& filename,size_t store)
+		{
+			return "ResumeTransforms" + ttos(store) + "_" + filename;
+		}
+
+		static std::string targetFile(const std::string& filename,size_t generation)
+		{
+			return "ResumeTarget" + ttos(generation) + "_" + filename;
+		}
+
+		static std::string wftFile(const std::string& filename,size_t generation)
+		{
+			return "ResumeWft" + ttos(generation) + "_" + filename;
+		}
+
+		//! Reads the manifest of the last checkpoint of the run that wrote
+		//! filename, or of the kept one of generation position if not 0;
+		//! returns false if there is none
+		bool load(const std::string& filename,size_t position = 0)
+		{
+			std::string file = (position==0) ? manifestFile(filename)
+			                                 : manifestFile(filename,position);
+			std::ifstream fin(file.c_str());
+			if (!fin || !fin.good()) return false;
+			fin.close();
+
+			IoInType io(file);
+			io.readline(this->generation,"#GENERATION=");
+			io.readline(store,"#STORE=");
+			io.readline(loop,"#LOOP=");
+			io.readline(stepCurrent,"#STEPCURRENT=");
+			io.readline(stepFinal,"#STEPFINAL=");
+			int x = 0;
+			io.readline(x,"#LOOPSTART=");
+			atLoopStart = (x>0);
+			io.read(system,"#SYSTEMRECORDS");
+			io.read(environment,"#ENVIRONRECORDS");
+			io.readline(x,"#HASWFT=");
+			hasWft = (x>0);
+			return true;
+		}
+
+		//! Writes the manifest for the run that writes to filename
+		//! (only if rank is 0), replacing the previous one atomically;
+		//! if keep, also the one of this generation
+		void save(const std::string& filename,size_t rank,bool keep = false) const
+		{
+			if (rank>0) return;
+			if (keep) save(manifestFile(filename,generation));
+			save(manifestFile(filename));
+		}
+
+		size_t generation;
+		size_t store; // of the store files that have the records
+		size_t loop;
+		int stepCurrent;
+		int stepFinal; // not used if atLoopStart
+		bool atLoopStart; // taken before the loop, which may be changed when resuming
+		std::vector<int> system; // records in the store, bottom of the stack first
+		std::vector<int> environment;
+		bool hasWft;
+
+	private:
+
+		void save(const std::string& file) const
+		{
+			std::string tmp = file + ".tmp";
+			IoOutType io(tmp,0);
+			io.printline("#GENERATION="+ttos(generation));
+			io.printline("#STORE="+ttos(store));
+			io.printline("#LOOP="+ttos(loop));
+			io.printline("#STEPCURRENT="+ttos(stepCurrent));
+			io.printline("#STEPFINAL="+ttos(stepFinal));
+			io.printline("#LOOPSTART="+ttos(atLoopStart));
+			io.printVector(system,"#SYSTEMRECORDS");
+			io.printVector(environment,"#ENVIRONRECORDS");
+			io.printline("#HASWFT="+ttos(hasWft));
+			io.close();
+			if (std::rename(tmp.c_str(),file.c_str())!=0)
+				throw std::runtime_error("CheckpointManifest::save(...): cannot rename "+tmp+"\n");
+		}
+	}; // class CheckpointManifest
+} // namespace Dmrg
+
+/*@}*/
+#endif // CHECKPOINT_MANIFEST_H
@@ -0,0 +1,583 @@
+// BEGIN LICENSE BLOCK
+/*
+Copyright (c) 2009, UT-Battelle, LLC
+All rights reserved
+
+[DMRG++, Version 2.0.0]
+[by G.A., Oak Ridge National Laboratory]
+
+UT Battelle Open Source Software License 11242008
+
+OPEN SOURCE LICENSE
+
+Subject to the conditions of this License, each
+contributor to this software hereby grants, free of
+charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"), a
+perpetual, worldwide, non-exclusive, no-charge,
+royalty-free, irrevocable copyright license to use, copy,
+modify, merge, publish, distribute, and/or sublicense
+copies of the Software.
+
+1. Redistributions of Software must retain the above
+copyright and license notices, this list of conditions,
+and the following disclaimer.  Changes or modifications
+to, or derivative works of, the Software should be noted
+with comments and the contributor and organization's
+name.
+
+2. Neither the names of UT-Battelle, LLC or the
+Department of Energy nor the names of the Software
+contributors may be used to endorse or promote products
+derived from this software without specific prior written
+permission of UT-Battelle.
+
+3. The software and the end-user documentation included
+with the redistribution, with or without modification,
+must include the following acknowledgment:
+
+"This product includes software produced by UT-Battelle,
+LLC under Contract No. DE-AC05-00OR22725  with the
+Department of Energy."
+ 
+*********************************************************
+DISCLAIMER
+
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT OWNER, CONTRIBUTORS, UNITED STATES GOVERNMENT,
+OR THE UNITED STATES DEPARTMENT OF ENERGY BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+
+NEITHER THE UNITED STATES GOVERNMENT, NOR THE UNITED
+STATES DEPARTMENT OF ENERGY, NOR THE COPYRIGHT OWNER, NOR
+ANY OF THEIR EMPLOYEES, REPRESENTS THAT THE USE OF ANY
+INFORMATION, DATA, APPARATUS, PRODUCT, OR PROCESS
+DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
+
+*********************************************************
+
+
+*/
+// END LICENSE BLOCK
+/** \ingroup DMRG */
+/*@{*/
+
+/*! \file CompressedFile.h
+ *
+ *  A compressed container for the files DMRG++ writes through IoBinary
+ *  (data file, Wft file, checkpoints and disk stacks), with the option
+ *  compressedFiles. A container is a magic string followed by records;
+ *  each record has a small header (sizes, method, byte stride and an
+ *  Adler-32 checksum of the original bytes) and its payload, compressed
+ *  with a byte-oriented LZ77 codec similar to LZ4. If the stride is larger
+ *  than one, the bytes are first shuffled so that byte k of each
+ *  element of that size comes together, which helps with arrays of
+ *  floating point numbers. Decompressing gives the exact original bytes.
+ *
+ *  OutBuf and InBuf are the stream buffers IoBinary writes and reads
+ *  through: OutBuf compresses a record whenever enough bytes have been
+ *  written, and InBuf decompresses only the record that holds the
+ *  position read, so seeking skips the others.
+ */
+#ifndef COMPRESSED_FILE_H
+#define COMPRESSED_FILE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <streambuf>
+#include <algorithm>
+#include <stdexcept>
+
+namespace Dmrg {
+
+	class CompressedFile {
+
+		enum {STORED,LZ};
+
+		enum {HASH_BITS = 16, MIN_MATCH = 4, MAX_OFFSET = 65535};
+
+		enum {HEADER_SIZE = 22};
+
+		// bytes of each record, and the least that a change of
+		// stride makes a record of
+		enum {RECORD_SIZE = 4*1024*1024, MIN_RECORD_SIZE = 64*1024};
+
+		typedef unsigned int Uint32Type;
+
+	public:
+
+		//! Compresses what is written to it, RECORD_SIZE bytes per record
+		class OutBuf : public std::streambuf {
+		public:
+			OutBuf() : stride_(1) {}
+
+			~OutBuf()
+			{
+				try {
+					close();
+				} catch (std::exception& e) {
+					std::cerr<<e.what();
+				}
+			}
+
+			//! Truncates the file, or appends records to it if append;
+			//! returns true if the file was empty
+			bool open(const std::string& fn,bool append)
+			{
+				close();
+				fn_ = fn;
+				bool empty = true;
+				if (append) {
+					std::ifstream fin(fn.c_str(),std::ios::binary | std::ios::ate);
+					empty = (!fin || fin.tellg()<=0);
+					if (!empty && !isCompressed(fn))
+						throw std::runtime_error("CompressedFile::OutBuf::open(...): " +
+							fn + " is not compressed\n");
+				}
+				std::ios_base::openmode mode = (append) ? std::ios::app : std::ios::trunc;
+				fout_.open(fn.c_str(),std::ios::out | std::ios::binary | mode);
+				if (!fout_ || !fout_.good())
+					throw std::runtime_error("CompressedFile::OutBuf::open(...): cannot open " +
+						fn + "\n");
+				if (empty) fout_.write(magic().data(),magic().size());
+				return empty;
+			}
+
+			void close()
+			{
+				if (!fout_.is_open()) return;
+				flush();
+				fout_.close();
+			}
+
+			//! The size of the elements of what is written next,
+			//! for the shuffle; a record holds bytes of one stride
+			//! unless it would be smaller than MIN_RECORD_SIZE
+			void stride(size_t s)
+			{
+				if (s==stride_) return;
+				if (pending_.size()>=MIN_RECORD_SIZE) flush();
+				stride_ = s;
+			}
+
+		protected:
+			int overflow(int c)
+			{
+				if (c==EOF) return 0;
+				pending_.push_back(static_cast<char>(c));
+				if (pending_.size()>=RECORD_SIZE) flush();
+				return c;
+			}
+
+			std::streamsize xsputn(const char* s,std::streamsize n)
+			{
+				std::streamsize done = 0;
+				while (done<n) {
+					size_t k = std::min(size_t(n-done),RECORD_SIZE-pending_.size());
+					pending_.append(s+done,k);
+					done += k;
+					if (pending_.size()>=RECORD_SIZE) flush();
+				}
+				return n;
+			}
+
+			int sync()
+			{
+				flush();
+				return 0;
+			}
+
+		private:
+			OutBuf(const OutBuf&);
+
+			OutBuf& operator=(const OutBuf&);
+
+			void flush()
+			{
+				if (pending_.size()==0) return;
+				writeRecord(fout_,pending_,stride_);
+				pending_.clear();
+				if (!fout_)
+					throw std::runtime_error("CompressedFile::OutBuf: cannot write " + fn_ + "\n");
+			}
+
+			std::string fn_;
+			std::ofstream fout_;
+			std::string pending_;
+			size_t stride_;
+		}; // class OutBuf
+
+		//! Reads the original bytes of a container, decompressing
+		//! one record at a time; seeks are by original position
+		class InBuf : public std::streambuf {
+		public:
+			InBuf() : current_(0) {}
+
+			//! A record cut short at the end (by a crash while
+			//! writing) ends the file
+			void open(const std::string& fn)
+			{
+				close();
+				index(offsets_,starts_,fn);
+				fin_.open(fn.c_str(),std::ios::binary);
+				current_ = offsets_.size();
+				setg(0,0,0);
+				seekpos(0,std::ios_base::in);
+			}
+
+			void close()
+			{
+				if (fin_.is_open()) fin_.close();
+				fin_.clear();
+				offsets_.clear();
+				starts_.clear();
+				buffer_.clear();
+				current_ = 0;
+				setg(0,0,0);
+			}
+
+		protected:
+			int underflow()
+			{
+				if (gptr()<egptr()) return traits_type::to_int_type(*gptr());
+				if (current_+1>=offsets_.size()) {
+					current_ = offsets_.size();
+					setg(0,0,0);
+					return EOF;
+				}
+				load(current_+1,0);
+				return traits_type::to_int_type(*gptr());
+			}
+
+			std::streampos seekoff(std::streamoff off,
+			                       std::ios_base::seekdir dir,
+			                       std::ios_base::openmode which)
+			{
+				std::streamoff base = 0;
+				if (dir==std::ios_base::cur) base = position();
+				else if (dir==std::ios_base::end) base = starts_.back();
+				return seekpos(base+off,which);
+			}
+
+			std::streampos seekpos(std::streampos pos,std::ios_base::openmode)
+			{
+				std::streamoff x = pos;
+				if (starts_.size()==0 || x<0 || x>starts_.back())
+					return std::streampos(std::streamoff(-1));
+				size_t r = std::upper_bound(starts_.begin(),starts_.end(),long(x)) -
+						starts_.begin() - 1;
+				if (r>=offsets_.size()) {
+					current_ = offsets_.size();
+					setg(0,0,0);
+				} else {
+					load(r,x-starts_[r]);
+				}
+				return pos;
+			}
+
+		private:
+			InBuf(const InBuf&);
+
+			InBuf& operator=(const InBuf&);
+
+			std::streamoff position() const
+			{
+				if (current_>=offsets_.size()) return starts_.back();
+				return starts_[current_] + (gptr()-eback());
+			}
+
+			void load(size_t r,size_t k)
+			{
+				if (r!=current_) {
+					fin_.clear();
+					fin_.seekg(offsets_[r]);
+					if (!readRecord(fin_,buffer_))
+						throw std::runtime_error("CompressedFile::InBuf: no record\n");
+					current_ = r;
+				}
+				char* b = &buffer_[0];
+				setg(b,b+k,b+buffer_.size());
+			}
+
+			std::ifstream fin_;
+			std::vector<long> offsets_; // of each record in the file
+			std::vector<long> starts_; // original position of each record, and the end
+			std::string buffer_; // record current_, decompressed
+			size_t current_;
+		}; // class InBuf
+
+		//! files written through IoBinary are compressed if enabled
+		static void enable(bool flag) { enabledFlag() = flag; }
+
+		static bool enabled() { return enabledFlag(); }
+
+		static const std::string& magic()
+		{
+			static const std::string m("DMRGPPZ1");
+			return m;
+		}
+
+		static bool isCompressed(const std::string& file)
+		{
+			std::ifstream fin(file.c_str(),std::ios::binary);
+			if (!fin || !fin.good()) return false;
+			std::string m(magic().size(),' ');
+			fin.read(&m[0],m.size());
+			return (fin.gcount()==std::streamsize(m.size()) && m==magic());
+		}
+
+		//! The offsets of the records of a container in the file, and
+		//! where each starts in the original bytes followed by their total;
+		//! a record cut short at the end is ignored
+		static void index(std::vector<long>& offsets,
+		                  std::vector<long>& starts,
+		                  const std::string& file)
+		{
+			offsets.clear();
+			starts.clear();
+			std::ifstream fin(file.c_str(),std::ios::binary);
+			if (!isCompressed(file))
+				throw std::runtime_error("CompressedFile::index(): "+file+" is not compressed\n");
+			fin.seekg(0,std::ios::end);
+			long total = fin.tellg();
+			long offset = magic().size();
+			long start = 0;
+			while (offset<total) {
+				fin.seekg(offset);
+				unsigned char h[HEADER_SIZE];
+				fin.read(reinterpret_cast<char*>(h),HEADER_SIZE);
+				if (fin.gcount()!=HEADER_SIZE) break;
+				long next = offset + HEADER_SIZE + getUint(h+8,8);
+				if (next>total) break;
+				offsets.push_back(offset);
+				starts.push_back(start);
+				start += getUint(h,8);
+				offset = next;
+			}
+			starts.push_back(start);
+		}
+
+		//! LZ77 codec: sequences of a token (literal length and match
+		//! length - MIN_MATCH, 4 bits each, 15 meaning more bytes follow),
+		//! the literals, and a 2-byte offset; the last sequence has no match
+		static void encode(std::string& out,const std::string& in)
+		{
+			out.clear();
+			out.reserve(in.size()/2 + 16);
+			size_t n = in.size();
+			const unsigned char* p = reinterpret_cast<const unsigned char*>(in.data());
+			std::vector<size_t> table(1<<HASH_BITS,0); // position+1 of the last occurrence
+			size_t anchor = 0;
+			size_t i = 0;
+			while (i+MIN_MATCH<=n) {
+				Uint32Type seq = getUint(p+i,4);
+				size_t h = hash(seq);
+				size_t candidate = table[h];
+				table[h] = i+1;
+				if (candidate==0 || i+1-candidate>MAX_OFFSET || getUint(p+candidate-1,4)!=seq) {
+					i++;
+					continue;
+				}
+				size_t c = candidate-1;
+				size_t len = MIN_MATCH;
+				while (i+len<n && p[c+len]==p[i+len]) len++;
+				putSequence(out,p+anchor,i-anchor,i-c,len);
+				i += len;
+				anchor = i;
+			}
+			putSequence(out,p+anchor,n-anchor,0,0);
+		}
+
+		static void decode(std::string& out,const std::string& in,size_t rawSize)
+		{
+			out.resize(rawSize);
+			const unsigned char* ip = reinterpret_cast<const unsigned char*>(in.data());
+			const unsigned char* end = ip + in.size();
+			size_t o = 0;
+			while (ip<end) {
+				size_t token = *ip++;
+				size_t lit = getLength(ip,end,token>>4);
+				if (lit>size_t(end-ip) || o+lit>rawSize)
+					throw std::runtime_error("CompressedFile::decode(): corrupt data\n");
+				for (size_t k=0;k<lit;k++) out[o++] = *ip++;
+				if (ip==end) break; // the last sequence
+				if (end-ip<2) throw std::runtime_error("CompressedFile::decode(): corrupt data\n");
+				size_t offset = getUint(ip,2);
+				ip += 2;
+				size_t len = getLength(ip,end,token & 15) + MIN_MATCH;
+				if (offset==0 || offset>o || o+len>rawSize)
+					throw std::runtime_error("CompressedFile::decode(): corrupt data\n");
+				// byte by byte, matches may overlap
+				for (size_t k=0;k<len;k++,o++) out[o] = out[o-offset];
+			}
+			if (o!=rawSize) throw std::runtime_error("CompressedFile::decode(): corrupt data\n");
+		}
+
+		//! Byte k of element j goes to k*(n/stride)+j; a tail shorter
+		//! than stride stays at the end
+		static void shuffle(std::string& out,const std::string& in,size_t stride)
+		{
+			out = in;
+			if (stride<2) return;
+			size_t m = in.size()/stride;
+			for (size_t j=0;j<m;j++)
+				for (size_t k=0;k<stride;k++)
+					out[k*m+j] = in[j*stride+k];
+		}
+
+		static void unshuffle(std::string& out,const std::string& in,size_t stride)
+		{
+			out = in;
+			if (stride<2) return;
+			size_t m = in.size()/stride;
+			for (size_t j=0;j<m;j++)
+				for (size_t k=0;k<stride;k++)
+					out[j*stride+k] = in[k*m+j];
+		}
+
+		static Uint32Type adler32(const std::string& data)
+		{
+			Uint32Type a = 1, b = 0;
+			for (size_t i=0;i<data.size();i++) {
+				a = (a + static_cast<unsigned char>(data[i])) % 65521;
+				b = (b + a) % 65521;
+			}
+			return (b<<16) | a;
+		}
+
+	private:
+
+		static bool& enabledFlag()
+		{
+			static bool flag = false;
+			return flag;
+		}
+
+		//! header: original size (8), payload size (8), method (1),
+		//! stride (1), checksum of the original (4); then the payload
+		static void writeRecord(std::ostream& os,const std::string& data,size_t stride)
+		{
+			if (stride<1 || stride>255)
+				throw std::runtime_error("CompressedFile::writeRecord(): stride must be in 1..255\n");
+			std::string shuffled,payload;
+			shuffle(shuffled,data,stride);
+			encode(payload,shuffled);
+			size_t method = LZ;
+			if (payload.size()>=data.size()) {
+				payload = data;
+				method = STORED;
+				stride = 1;
+			}
+			unsigned char h[HEADER_SIZE];
+			putUint(h,data.size(),8);
+			putUint(h+8,payload.size(),8);
+			h[16] = method;
+			h[17] = stride;
+			putUint(h+18,adler32(data),4);
+			os.write(reinterpret_cast<const char*>(h),HEADER_SIZE);
+			os.write(payload.data(),payload.size());
+		}
+
+		//! false at the end of the file
+		static bool readRecord(std::istream& is,std::string& data)
+		{
+			unsigned char h[HEADER_SIZE];
+			is.read(reinterpret_cast<char*>(h),HEADER_SIZE);
+			if (is.gcount()==0) return false;
+			if (is.gcount()!=HEADER_SIZE)
+				throw std::runtime_error("CompressedFile::readRecord(): truncated record\n");
+			size_t rawSize = getUint(h,8);
+			size_t size = getUint(h+8,8);
+			size_t method = h[16];
+			size_t stride = h[17];
+			std::string payload(size,' ');
+			if (size>0) is.read(&payload[0],size);
+			if (size_t(is.gcount())!=size)
+				throw std::runtime_error("CompressedFile::readRecord(): truncated record\n");
+			if (method==STORED) {
+				data = payload;
+			} else if (method==LZ) {
+				std::string shuffled;
+				decode(shuffled,payload,rawSize);
+				unshuffle(data,shuffled,stride);
+			} else {
+				throw std::runtime_error("CompressedFile::readRecord(): unknown method\n");
+			}
+			if (data.size()!=rawSize || adler32(data)!=getUint(h+18,4))
+				throw std::runtime_error("CompressedFile::readRecord(): checksum mismatch\n");
+			return true;
+		}
+
+		static void putSequence(std::string& out,
+		                        const unsigned char* literals,
+		                        size_t lit,
+		                        size_t offset,
+		                        size_t len)
+		{
+			size_t litToken = (lit<15) ? lit : 15;
+			size_t lenToken = 0;
+			if (len>0) lenToken = (len-MIN_MATCH<15) ? len-MIN_MATCH : 15;
+			out.push_back(static_cast<char>((litToken<<4) | lenToken));
+			if (litToken==15) putLength(out,lit-15);
+			out.append(reinterpret_cast<const char*>(literals),lit);
+			if (len==0) return;
+			out.push_back(static_cast<char>(offset & 255));
+			out.push_back(static_cast<char>(offset>>8));
+			if (lenToken==15) putLength(out,len-MIN_MATCH-15);
+		}
+
+		static void putLength(std::string& out,size_t x)
+		{
+			for (;x>=255;x-=255) out.push_back(static_cast<char>(255));
+			out.push_back(static_cast<char>(x));
+		}
+
+		static size_t getLength(const unsigned char*& ip,const unsigned char* end,size_t x)
+		{
+			if (x<15) return x;
+			while (true) {
+				if (ip==end) throw std::runtime_error("CompressedFile::decode(): corrupt data\n");
+				size_t b = *ip++;
+				x += b;
+				if (b<255) return x;
+			}
+		}
+
+		static size_t hash(Uint32Type seq)
+		{
+			return ((seq * 2654435761U) & 0xffffffffU) >> (32-HASH_BITS);
+		}
+
+		//! little endian
+		static void putUint(unsigned char* p,size_t x,size_t bytes)
+		{
+			for (size_t k=0;k<bytes;k++,x>>=8) p[k] = static_cast<unsigned char>(x & 255);
+		}
+
+		static size_t getUint(const unsigned char* p,size_t bytes)
+		{
+			size_t x = 0;
+			for (size_t k=bytes;k>0;k--) {
+				x = (x<<8) | p[k-1];
+			}
+			return x;
+		}
+	}; // class CompressedFile
+} // namespace Dmrg
+
+/*@}*/
+#endif // COMPRESSED_FILE_H
@@ -84,6 +84,7 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 
 #include "Matrix.h"
 #include "Vector.h"
+#include "VectorKernels.h"
 
 namespace Dmrg {
 
@@ -131,9 +132,8 @@ namespace Dmrg {
 
 		FieldType scalarProduct(const VectorType& v1,const VectorType& v2) const
 		{
-			FieldType sum = 0;
-			for (size_t i=0;i<v1.size();i++) sum += std::conj(v1[i])*v2[i];
-			return sum;
+			if (v1.size()==0) return 0;
+			return VectorKernels::dotConj(&(v1[0]),&(v2[0]),v1.size());
 		}
 
 		VectorType multiply(const MatrixType& A,const VectorType& v) const
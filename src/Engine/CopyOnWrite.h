@@ -0,0 +1,180 @@
+// BEGIN LICENSE BLOCK
+/*
+Copyright (c) 2009, UT-Battelle, LLC
+All rights reserved
+
+[DMRG++, Version 2.0.0]
+[by G.A., Oak Ridge National Laboratory]
+
+UT Battelle Open Source Software License 11242008
+
+OPEN SOURCE LICENSE
+
+Subject to the conditions of this License, each
+contributor to this software hereby grants, free of
+charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"), a
+perpetual, worldwide, non-exclusive, no-charge,
+royalty-free, irrevocable copyright license to use, copy,
+modify, merge, publish, distribute, and/or sublicense
+copies of the Software.
+
+1. Redistributions of Software must retain the above
+copyright and license notices, this list of conditions,
+and the following disclaimer.  Changes or modifications
+to, or derivative works of, the Software should be noted
+with comments and the contributor and organization's
+name.
+
+2. Neither the names of UT-Battelle, LLC or the
+Department of Energy nor the names of the Software
+contributors may be used to endorse or promote products
+derived from this software without specific prior written
+permission of UT-Battelle.
+
+3. The software and the end-user documentation included
+with the redistribution, with or without modification,
+must include the following acknowledgment:
+
+"This product includes software produced by UT-Battelle,
+LLC under Contract No. DE-AC05-00OR22725  with the
+Department of Energy."
+ 
+*********************************************************
+DISCLAIMER
+
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT OWNER, CONTRIBUTORS, UNITED STATES GOVERNMENT,
+OR THE UNITED STATES DEPARTMENT OF ENERGY BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+
+NEITHER THE UNITED STATES GOVERNMENT, NOR THE UNITED
+STATES DEPARTMENT OF ENERGY, NOR THE COPYRIGHT OWNER, NOR
+ANY OF THEIR EMPLOYEES, REPRESENTS THAT THE USE OF ANY
+INFORMATION, DATA, APPARATUS, PRODUCT, OR PROCESS
+DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
+
+*********************************************************
+
+
+*/
+// END LICENSE BLOCK
+/** \ingroup DMRG */
+/*@{*/
+
+/*! \file CopyOnWrite.h
+ *
+ *  A reference-counted handle to a value that is copied only when
+ *  written while shared. Copies of the handle share the value, so that
+ *  a basis can be in a stack and in the LeftRightSuper without being
+ *  copied. The count is atomic, since a job of AsyncWriter may destroy
+ *  its handles in the writer thread; the value itself must not be
+ *  changed while it is shared (write() copies it instead).
+ *
+ */
+#ifndef COPY_ON_WRITE_H
+#define COPY_ON_WRITE_H
+
+#include <stdexcept>
+
+namespace Dmrg {
+
+	template<typename T>
+	class CopyOnWrite {
+
+		struct Shared {
+			Shared(T* x) : value(x),count(1) {}
+
+			~Shared() { delete value; }
+
+			T* value;
+			size_t count;
+		};
+
+	public:
+		typedef T value_type;
+
+		CopyOnWrite() : shared_(0) {}
+
+		explicit CopyOnWrite(const T& x) : shared_(new Shared(new T(x))) {}
+
+		CopyOnWrite(const CopyOnWrite& other) : shared_(other.shared_)
+		{
+			if (shared_) __sync_add_and_fetch(&shared_->count,1);
+		}
+
+		//! A handle that owns x, allocated with new, without copying it
+		static CopyOnWrite adopt(T* x)
+		{
+			CopyOnWrite h;
+			h.shared_ = new Shared(x);
+			return h;
+		}
+
+		~CopyOnWrite() { release(); }
+
+		CopyOnWrite& operator=(const CopyOnWrite& other)
+		{
+			if (shared_==other.shared_) return *this;
+			release();
+			shared_ = other.shared_;
+			if (shared_) __sync_add_and_fetch(&shared_->count,1);
+			return *this;
+		}
+
+		bool empty() const { return (shared_==0); }
+
+		const T& operator*() const { return get(); }
+
+		const T* operator->() const { return &get(); }
+
+		const T& get() const
+		{
+			if (!shared_) throw std::runtime_error("CopyOnWrite::get(): empty\n");
+			return *shared_->value;
+		}
+
+		//! The value, copied first if it is shared
+		T& write()
+		{
+			if (!shared_) throw std::runtime_error("CopyOnWrite::write(): empty\n");
+			if (__sync_add_and_fetch(&shared_->count,0)>1) {
+				Shared* s = new Shared(new T(*shared_->value));
+				release();
+				shared_ = s;
+			}
+			return *shared_->value;
+		}
+
+		void reset()
+		{
+			release();
+			shared_ = 0;
+		}
+
+	private:
+
+		void release()
+		{
+			if (!shared_) return;
+			if (__sync_sub_and_fetch(&shared_->count,1)==0) delete shared_;
+		}
+
+		Shared* shared_;
+	}; // class CopyOnWrite
+} // namespace Dmrg
+
+/*@}*/
+#endif // COPY_ON_WRITE_H
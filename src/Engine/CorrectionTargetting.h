@@ -105,7 +105,7 @@ namespace Dmrg {
 			typedef ConcurrencyType_ ConcurrencyType;
 			typedef IoType_ IoType;
 			
-			typedef PsimagLite::IoSimple::In IoInputType;
+			typedef typename IoType::In IoInputType;
 
 			typedef typename ModelType::RealType RealType;
 			typedef InternalProductTemplate<RealType,ModelType> InternalProductType;
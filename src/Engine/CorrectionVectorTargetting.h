@@ -128,6 +128,7 @@ namespace Dmrg {
 		typedef WaveFunctionTransfTemplate<LeftRightSuperType,VectorWithOffsetType> WaveFunctionTransfType;
 		typedef typename LanczosSolverType::TridiagonalMatrixType TridiagonalMatrixType;
 		typedef typename LanczosSolverType::DenseMatrixType DenseMatrixType;
+		typedef typename LanczosSolverType::LanczosVectorsType LanczosVectorsType;
 		typedef PsimagLite::ContinuedFraction<RealType,TridiagonalMatrixType>
 			ContinuedFractionType;
 		typedef DynamicSerializer<RealType,VectorWithOffsetType,
@@ -465,7 +466,7 @@ namespace Dmrg {
 				targetVectors_[1].setDataInSector(xi,i0);
 				//set xr
 				targetVectors_[2].setDataInSector(xr,i0);
-				DenseMatrixType V;
+				LanczosVectorsType V;
 				getLanczosVectors(V,sv,p);
 			}
 			setWeights();
@@ -473,7 +474,7 @@ namespace Dmrg {
 		}
 
 		void getLanczosVectors(
-				DenseMatrixType& V,
+				LanczosVectorsType& V,
 				const VectorType& sv,
 				size_t p)
 		{
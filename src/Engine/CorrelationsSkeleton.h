@@ -171,15 +171,25 @@ namespace Dmrg {
 			
 			for (size_t s=nt;s<ns;s++) {
 				helper_.setPointer(s);
-				size_t growOption = growthDirection(s,nt,i);
-				MatrixType Onew(helper_.columns(),helper_.columns());
-				fluffUp(Onew,Odest,fermionicSign,growOption,false);
-				if (!transform && s == ns-1) {
-					Odest = Onew;
-					continue;
-				}
-				helper_.transform(Odest,Onew);
+				growStep(Odest,i,fermionicSign,s,(transform || s+1<ns));
+			}
+		}
+
+		//! One step of growDirectly: grows O, which started at site i,
+		//! with the record at s; the pointer must already be at s
+		void growStep(MatrixType& O,size_t i,int fermionicSign,size_t s,
+				bool transform = true)
+		{
+			int nt=i-1;
+			if (nt<0) nt=0;
+			size_t growOption = growthDirection(s,nt,i);
+			MatrixType Onew(helper_.columns(),helper_.columns());
+			fluffUp(Onew,O,fermionicSign,growOption,false);
+			if (!transform) {
+				O = Onew;
+				return;
 			}
+			helper_.transform(O,Onew);
 		}
 		
 		size_t growthDirection(size_t s,int nt,size_t i) const
@@ -236,6 +246,27 @@ namespace Dmrg {
 			transposeConjugate(Om,O);
 		}
 
+		//! O1^\dagger O2, for the correlation of O1 and O2 at one site
+		MatrixType multiplyTranspose(
+				const MatrixType& O1,
+				const MatrixType& O2) const
+		{
+			size_t n=O1.n_row();
+			MatrixType ret(n,n);
+			for (size_t s=0;s<n;s++)
+				for (size_t t=0;t<n;t++)
+					for (size_t w=0;w<n;w++)
+						ret(s,t) += std::conj(O1(s,w))*O2(w,t);
+			return ret;
+		}
+
+		MatrixType identity(size_t n) const
+		{
+			MatrixType ret(n,n);
+			for (size_t s=0;s<n;s++)  ret(s,s)=static_cast<RealType>(1.0);
+			return ret;
+		}
+
 		FieldType bracket(const MatrixType& A,int fermionicSign)
 		{
 			try {
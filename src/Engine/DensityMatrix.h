@@ -77,6 +77,7 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 
 #include "DensityMatrixLocal.h"
 #include "DensityMatrixSu2.h"
+#include "DensityMatrixSvd.h"
 
 namespace Dmrg {
 
@@ -103,6 +104,9 @@ namespace Dmrg {
 		typedef DensityMatrixSu2<RealType,DmrgBasisType,
 			DmrgBasisWithOperatorsType,TargettingType>
 			DensityMatrixSu2Type;
+		typedef DensityMatrixSvd<RealType,DmrgBasisType,
+			DmrgBasisWithOperatorsType,TargettingType>
+			DensityMatrixSvdType;
 		typedef DensityMatrixBase<RealType,DmrgBasisType,
 			DmrgBasisWithOperatorsType,TargettingType>
 			DensityMatrixBaseType;
@@ -118,17 +122,23 @@ namespace Dmrg {
 			const DmrgBasisType& pSE,
 			size_t direction,
 			bool debug=false,
-			bool verbose=false)
+			bool verbose=false,
+			bool useSvd=false)
 			
 
 			: densityMatrixLocal_(target,pBasis,pBasisSummed,pSE,
 					direction,debug,verbose),
 				densityMatrixSu2_(target,pBasis,pBasisSummed,pSE,
-					direction,debug,verbose)
+					direction,debug,verbose),
+				densityMatrixSvd_(target,pBasis,pBasisSummed,pSE,
+					direction,debug,verbose),
+				useSvd_(useSvd && !DmrgBasisType::useSu2Symmetry())
 		{
 
 			if (DmrgBasisType::useSu2Symmetry()) {
 				densityMatrixImpl_ = &densityMatrixSu2_;
+			} else if (useSvd_) {
+				densityMatrixImpl_ = &densityMatrixSvd_;
 			} else {
 				densityMatrixImpl_ = &densityMatrixLocal_;
 			}
@@ -154,11 +164,13 @@ namespace Dmrg {
 		}
 
 		template<typename ConcurrencyType>
-		void diag(std::vector<RealType>& eigs,char jobz,
+		void diag(std::vector<RealType>& eigs,char jobz,size_t kept,
 				ConcurrencyType& concurrency)
 		{
-			if (!DmrgBasisType::useSu2Symmetry()) {
-				densityMatrixLocal_.diag(eigs,jobz,concurrency);
+			if (useSvd_) {
+				densityMatrixSvd_.diag(eigs,jobz,concurrency);
+			} else if (!DmrgBasisType::useSu2Symmetry()) {
+				densityMatrixLocal_.diag(eigs,jobz,kept,concurrency);
 			} else {
 				densityMatrixSu2_.diag(eigs,jobz,concurrency);
 			}
@@ -178,6 +190,8 @@ namespace Dmrg {
 	private:
 		DensityMatrixLocalType densityMatrixLocal_;
 		DensityMatrixSu2Type densityMatrixSu2_;
+		DensityMatrixSvdType densityMatrixSvd_;
+		bool useSvd_;
 		DensityMatrixBaseType* densityMatrixImpl_;
 	}; // class DensityMatrix
 
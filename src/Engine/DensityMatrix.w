@@ -33,7 +33,8 @@
 the density matrix calculation  and diagonalization for the DMRG algorithm.
 This is a lazy class, it doesn't do much but instead delegates the work%'
 to either the |DensityMatrixLocal| for when there's only local symmetries,
-or to the |DensityMatrixSu2| when there's local symmetries and SU(2) symmetry.
+or to the |DensityMatrixSu2| when there's local symmetries and SU(2) symmetry,
+or to the |DensityMatrixSvd| when the option truncationSvd is given without SU(2).
 
 The file starts with the normal define guards:
 @o DensityMatrix.h -t
@@ -61,12 +62,14 @@ Hamiltonian
 #include "BlockMatrix.h"
 @}
 
-Now this class works in conjunction with three more files \verb|DensityMatrixBase.h|,
-\verb|DensityMatrixLocal.h|, and \verb|DensityMatrixSu2.h|, as explained in detail below.
+Now this class works in conjunction with four more files \verb|DensityMatrixBase.h|,
+\verb|DensityMatrixLocal.h|, \verb|DensityMatrixSu2.h|, and \verb|DensityMatrixSvd.h|,
+as explained in detail below.
 @o DensityMatrix.h -t
 @{
 #include "DensityMatrixLocal.h"
 #include "DensityMatrixSu2.h"
+#include "DensityMatrixSvd.h"
 
 namespace Dmrg {
 @}
@@ -107,6 +110,9 @@ for these types. In other words, these are aliases to shorten things later.
 		typedef DensityMatrixSu2<RealType,DmrgBasisType,
 			DmrgBasisWithOperatorsType,TargettingType>
 			DensityMatrixSu2Type;
+		typedef DensityMatrixSvd<RealType,DmrgBasisType,
+			DmrgBasisWithOperatorsType,TargettingType>
+			DensityMatrixSvdType;
 		typedef DensityMatrixBase<RealType,DmrgBasisType,
 			DmrgBasisWithOperatorsType,TargettingType>
 			DensityMatrixBaseType;
@@ -131,8 +137,9 @@ vice-versa.
 Then, there's \verb|pSE|, a light Hilbert space object (BasisType), which represents the superblock%'
 (system+environment). Remember that superblock objects are always light (i.e. do not
 contain operators) due to memory reasons. The argument \verb|direction| indicates if we're expanding%'
-the system or expanding the environment instead. Finally  the \verb|verbose| variable tells us
-if we want to print informational stuff.
+the system or expanding the environment instead. The \verb|verbose| variable tells us
+if we want to print informational stuff. Finally \verb|useSvd| selects the SVD of the
+wave function instead of the density matrix; it is ignored with SU(2).
 
 @o DensityMatrix.h -t
 @{
@@ -143,20 +150,24 @@ if we want to print informational stuff.
 			const DmrgBasisType& pSE,
 			size_t direction,
 			bool debug=false,
-			bool verbose=false)
+			bool verbose=false,
+			bool useSvd=false)
 			
 @}
 
 Note the colon that comes here indicating that we're setting stuff on the stack.
-We're constructing two objects, one to handle local symmetries only, and another one to
-handle local and SU(2) symmetries. These objects have very light constructors that are
+We're constructing three objects, one to handle local symmetries only, another one to
+handle local and SU(2) symmetries, and one for the SVD. These objects have very light constructors that are
 described in (not sure how to cross reference with literate programming, need to learn more!!).
 @o DensityMatrix.h -t
 @{
 			: densityMatrixLocal_(target,pBasis,pBasisSummed,pSE,
 					direction,debug,verbose),
 				densityMatrixSu2_(target,pBasis,pBasisSummed,pSE,
-					direction,debug,verbose)
+					direction,debug,verbose),
+				densityMatrixSvd_(target,pBasis,pBasisSummed,pSE,
+					direction,debug,verbose),
+				useSvd_(useSvd && !DmrgBasisType::useSu2Symmetry())
 		{
 @}
 
@@ -169,6 +180,8 @@ correct one.
 @{
 			if (DmrgBasisType::useSu2Symmetry()) {
 				densityMatrixImpl_ = &densityMatrixSu2_;
+			} else if (useSvd_) {
+				densityMatrixImpl_ = &densityMatrixSvd_;
 			} else {
 				densityMatrixImpl_ = &densityMatrixLocal_;
 			}
@@ -229,9 +242,11 @@ And more checks to see if everything is OK.
 @}
 The function \verb|diag| diagonalizes the density matrix, which, if you remember, is one
 of the key steps of the DMRG algorithm. 
-Three arguments are passed here. First \verb|eigs| which will be filled with the eigenvalues
+Four arguments are passed here. First \verb|eigs| which will be filled with the eigenvalues
 of the density matrix. Next \verb|jobz| which is either 'N' or 'V' indicating if we need
-also eigenvectors ('V') or only eigenvalues ('N'). 
+also eigenvectors ('V') or only eigenvalues ('N'). Then \verb|kept|, the number of states
+that will be kept, so that with only local symmetries only the eigenvectors of the
+largest \verb|kept| eigenvalues are computed.
 Finally a \verb|concurrency| object is also passed that can help with parallelizing this 
 diagonalization operation.
 Again, we don't do much here, just delegate, and
@@ -239,11 +254,13 @@ it's some other class's problem.%'
 @o DensityMatrix.h -t
 @{
 		template<typename ConcurrencyType>
-		void diag(std::vector<RealType>& eigs,char jobz,
+		void diag(std::vector<RealType>& eigs,char jobz,size_t kept,
 				ConcurrencyType& concurrency)
 		{
-			if (!DmrgBasisType::useSu2Symmetry()) {
-				densityMatrixLocal_.diag(eigs,jobz,concurrency);
+			if (useSvd_) {
+				densityMatrixSvd_.diag(eigs,jobz,concurrency);
+			} else if (!DmrgBasisType::useSu2Symmetry()) {
+				densityMatrixLocal_.diag(eigs,jobz,kept,concurrency);
 			} else {
 				densityMatrixSu2_.diag(eigs,jobz,concurrency);
 			}
@@ -265,10 +282,11 @@ of this class. This function will enable printing this class for debugging purpo
 						dm);
 @}
 
-This class has 3 data memeber, all of them private. 
+This class has 5 data memeber, all of them private. 
 We've already seen \verb|densityMatrixLocal_| that does the real work
 for the density matrix when there's local symmetries, and  also
 \verb|densityMatrixSu2_| that does the real work when there's local symmetries and the SU(2) symmetry.%'
+Then \verb|densityMatrixSvd_| does it with an SVD, if \verb|useSvd_| is true.
 As we explained above, \verb|densityMatrixImpl_| is a pointer that points to the 
 correct object, depending on which symmetries the user chose.
 @o DensityMatrix.h -t
@@ -276,6 +294,8 @@ correct object, depending on which symmetries the user chose.
 	private:
 		DensityMatrixLocalType densityMatrixLocal_;
 		DensityMatrixSu2Type densityMatrixSu2_;
+		DensityMatrixSvdType densityMatrixSvd_;
+		bool useSvd_;
 		DensityMatrixBaseType* densityMatrixImpl_;
 	}; // class DensityMatrix
 @}
@@ -75,6 +75,7 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 #include "TypeToString.h"
 #include "BlockMatrix.h"
 #include "DensityMatrixBase.h"
+#include "Threads.h"
 
 namespace Dmrg {
 	//!
@@ -130,10 +131,11 @@ namespace Dmrg {
 		{
 		}
 
+		//! Only the eigenvectors of the kept largest eigenvalues are computed
 		template<typename ConcurrencyType>
-		void diag(std::vector<RealType>& eigs,char jobz,ConcurrencyType& concurrency)
+		void diag(std::vector<RealType>& eigs,char jobz,size_t kept,ConcurrencyType& concurrency)
 		{
-			diagonalise<DensityMatrixElementType,RealType,ConcurrencyType>(data_,eigs,jobz,concurrency);
+			diagonalise<DensityMatrixElementType,RealType,ConcurrencyType>(data_,eigs,jobz,kept,concurrency);
 		}
 		virtual void init(
 				const TargettingType& target,
@@ -147,32 +149,9 @@ namespace Dmrg {
 				msg<<"Init partition for all targets";
 				progress_.printline(msg,std::cout);
 			}
-			//loop over all partitions:
-			for (size_t m=0;m<pBasis.partition()-1;m++) {
-				// size of this partition
-				size_t bs = pBasis.partition(m+1)-pBasis.partition(m);
-				
-				// density matrix block for this partition:
-				BuildingBlockType matrixBlock(bs,bs);
-				
-				// weight of the ground state:
-				RealType w = target.gsWeight();
-				
-				// if we are to target the ground state do it now:
-				if (target.includeGroundStage())
-					initPartition(matrixBlock,pBasis,m,target.gs(),
-							pBasisSummed,pSE,direction,w);
-				
-				// target all other states if any:
-				for (size_t i=0;i<target.size();i++) {
-					w = target.weight(i)/target.normSquared(i);
-					initPartition(matrixBlock,pBasis,m,target(i),
-							pBasisSummed,pSE,direction,w);
-				}
-				
-				// set this matrix block into data_
-				data_.setBlock(m,pBasis.partition(m),matrixBlock);
-			}
+			//loop over all partitions, in parallel:
+			ParallelInit parallelInit(*this,target,pBasis,pBasisSummed,pSE,direction);
+			Threads::loopCreate(pBasis.partition()-1,parallelInit);
 			{
 				std::ostringstream msg;
 				msg<<"Done with init partition";
@@ -191,10 +170,77 @@ namespace Dmrg {
     					DmrgBasisType_,DmrgBasisWithOperatorsType_,TargettingType_>& dm);
 
 	private:
+
+		class ParallelInit {
+		public:
+			ParallelInit(DensityMatrixLocal& dm,
+			             const TargettingType& target,
+			             DmrgBasisWithOperatorsType const &pBasis,
+			             const DmrgBasisWithOperatorsType& pBasisSummed,
+			             DmrgBasisType const &pSE,
+			             int direction)
+			: dm_(dm),target_(target),pBasis_(pBasis),
+			  pBasisSummed_(pBasisSummed),pSE_(pSE),direction_(direction)
+			{}
+
+			void thread_function_(size_t threadNum,size_t blockSize,pthread_mutex_t*)
+			{
+				size_t total = pBasis_.partition()-1;
+				for (size_t p=0;p<blockSize;p++) {
+					size_t m = threadNum*blockSize + p;
+					if (m>=total) break;
+					dm_.initBlock(m,target_,pBasis_,pBasisSummed_,pSE_,direction_);
+				}
+			}
+
+		private:
+			DensityMatrixLocal& dm_;
+			const TargettingType& target_;
+			DmrgBasisWithOperatorsType const &pBasis_;
+			const DmrgBasisWithOperatorsType& pBasisSummed_;
+			DmrgBasisType const &pSE_;
+			int direction_;
+		}; // class ParallelInit
+
+		friend class ParallelInit;
+
 		ProgressIndicatorType progress_;
 		BlockMatrixType data_;
 		bool debug_,verbose_;
 
+		//! Sets block m of data_; each m can be done by a different thread
+		void initBlock(size_t m,
+		               const TargettingType& target,
+		               DmrgBasisWithOperatorsType const &pBasis,
+		               const DmrgBasisWithOperatorsType& pBasisSummed,
+		               DmrgBasisType const &pSE,
+		               int direction)
+		{
+			// size of this partition
+			size_t bs = pBasis.partition(m+1)-pBasis.partition(m);
+
+			// density matrix block for this partition:
+			BuildingBlockType matrixBlock(bs,bs);
+
+			// weight of the ground state:
+			RealType w = target.gsWeight();
+
+			// if we are to target the ground state do it now:
+			if (target.includeGroundStage())
+				initPartition(matrixBlock,pBasis,m,target.gs(),
+						pBasisSummed,pSE,direction,w);
+
+			// target all other states if any:
+			for (size_t i=0;i<target.size();i++) {
+				w = target.weight(i)/target.normSquared(i);
+				initPartition(matrixBlock,pBasis,m,target(i),
+						pBasisSummed,pSE,direction,w);
+			}
+
+			// set this matrix block into data_
+			data_.setBlock(m,pBasis.partition(m),matrixBlock);
+		}
+
 		void initPartition(BuildingBlockType& matrixBlock,
 				DmrgBasisWithOperatorsType const &pBasis,
 				size_t m,
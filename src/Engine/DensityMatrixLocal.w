@@ -39,6 +39,7 @@ These are the include guards and included files:
 #include "Utils.h"
 #include "BlockMatrix.h"
 #include "DensityMatrixBase.h"
+#include "Threads.h"
 @}
 
 This is a templated class, and it is templated on 4 templates.
@@ -166,19 +167,21 @@ These are just checks to see if everything is OK. They're empty for this local s
 
 The function \verb|diag| diagonalizes the density matrix, which, if you remember, is one
 of the key steps of the DMRG algorithm. 
-Three arguments are passed here. First \verb|eigs| which will be filled with the eigenvalues
+Four arguments are passed here. First \verb|eigs| which will be filled with the eigenvalues
 of the density matrix. Next \verb|jobz| which is either 'N' or 'V' indicating if we need
-also eigenvectors ('V') or only eigenvalues ('N'). 
+also eigenvectors ('V') or only eigenvalues ('N'). Then \verb|kept|, the number of states
+that will be kept: only the eigenvectors of the \verb|kept| largest eigenvalues are computed.
 Finally a \verb|concurrency| object is also passed that can help with parallelizing this 
 diagonalization operation.
 We don't do much here, just delegate the work to the \verb|BlockMatrix.h| class
 that knows how to diagonalize a block matrix (i.e. block diagonal matrix).%'
 @o DensityMatrixLocal.h -t
 @{
+		//! Only the eigenvectors of the kept largest eigenvalues are computed
 		template<typename ConcurrencyType>
-		void diag(std::vector<RealType>& eigs,char jobz,ConcurrencyType& concurrency)
+		void diag(std::vector<RealType>& eigs,char jobz,size_t kept,ConcurrencyType& concurrency)
 		{
-			diagonalise<DensityMatrixElementType,RealType,ConcurrencyType>(data_,eigs,jobz,concurrency);
+			diagonalise<DensityMatrixElementType,RealType,ConcurrencyType>(data_,eigs,jobz,kept,concurrency);
 		}
 @}
 
@@ -188,8 +191,8 @@ This is because we only need one type (either local or SU(2)) per run,
 and initializing both would be a waste of 
 resources (both CPU and memory).
 The argument this function takes are similar to the constructor of the class and won't be explained again.%'
-This function calls \verb|initPartition| to accumulate the density matrix for each target state,
-since the density matrix is the sum of the density matrices for each state we want to target.
+The blocks, one per partition, are independent, so they are computed in parallel
+by \verb|ParallelInit| (see \verb|Threads.h|), each by \verb|initBlock| below.
 @o DensityMatrixLocal.h -t
 @{		virtual void init(
 				const TargettingType& target,
@@ -198,30 +201,9 @@ since the density matrix is the sum of the density matrices for each state we wa
 				DmrgBasisType const &pSE,
 				int direction)
 		{	
-			//loop over all partitions:
-			for (size_t m=0;m<pBasis.partition()-1;m++) {
-				// size of this partition
-				size_t bs = pBasis.partition(m+1)-pBasis.partition(m);
-				
-				// density matrix block for this partition:
-				BuildingBlockType matrixBlock(bs,bs);
-				
-				// weight of the ground state:
-				RealType w = target.gsWeight();
-				
-				// if we are to target the ground state do it now:
-				if (target.includeGroundStage())
-					initPartition(matrixBlock,pBasis,m,target.gs(),pBasisSummed,pSE,direction,w);
-				
-				// target all other states if any:
-				for (size_t i=0;i<target.size();i++) {
-					w = target.weight(i)/target.normSquared(i);
-					initPartition(matrixBlock,pBasis,m,target(i),pBasisSummed,pSE,direction,w);
-				}
-				
-				// set this matrix block into data_
-				data_.setBlock(m,pBasis.partition(m),matrixBlock);
-			}
+			//loop over all partitions, in parallel:
+			ParallelInit parallelInit(*this,target,pBasis,pBasisSummed,pSE,direction);
+			Threads::loopCreate(pBasis.partition()-1,parallelInit);
 		}
 @}
 
@@ -240,15 +222,94 @@ of this class. This function will enable printing this class for debugging purpo
     					DmrgBasisType_,DmrgBasisWithOperatorsType_,TargettingType_>& dm);
 @}
 
+The helper class \verb|ParallelInit| gives each thread some of the partitions; for each one
+it calls \verb|initBlock| below.
+@o DensityMatrixLocal.h -t
+@{
+	private:
+
+		class ParallelInit {
+		public:
+			ParallelInit(DensityMatrixLocal& dm,
+			             const TargettingType& target,
+			             DmrgBasisWithOperatorsType const &pBasis,
+			             const DmrgBasisWithOperatorsType& pBasisSummed,
+			             DmrgBasisType const &pSE,
+			             int direction)
+			: dm_(dm),target_(target),pBasis_(pBasis),
+			  pBasisSummed_(pBasisSummed),pSE_(pSE),direction_(direction)
+			{}
+
+			void thread_function_(size_t threadNum,size_t blockSize,pthread_mutex_t*)
+			{
+				size_t total = pBasis_.partition()-1;
+				for (size_t p=0;p<blockSize;p++) {
+					size_t m = threadNum*blockSize + p;
+					if (m>=total) break;
+					dm_.initBlock(m,target_,pBasis_,pBasisSummed_,pSE_,direction_);
+				}
+			}
+
+		private:
+			DensityMatrixLocal& dm_;
+			const TargettingType& target_;
+			DmrgBasisWithOperatorsType const &pBasis_;
+			const DmrgBasisWithOperatorsType& pBasisSummed_;
+			DmrgBasisType const &pSE_;
+			int direction_;
+		}; // class ParallelInit
+
+		friend class ParallelInit;
+@}
+
 This class has 3 data memebers, all of them private. 
 We've already seen \verb|data_|, a block diagonal matrix that contains the actual density matrix.%'
 @o DensityMatrixLocal.h -t
 @{
-	private:
 		BlockMatrixType data_;
 		bool debug_,verbose_;
 @}
 
+The function \verb|initBlock| computes block \verb|m| of the density matrix.
+It calls \verb|initPartition| to accumulate the density matrix for each target state,
+since the density matrix is the sum of the density matrices for each state we want to target.
+Each \verb|m| sets only its own block of \verb|data_|, so different threads can do different ones.
+@o DensityMatrixLocal.h -t
+@{
+		//! Sets block m of data_; each m can be done by a different thread
+		void initBlock(size_t m,
+		               const TargettingType& target,
+		               DmrgBasisWithOperatorsType const &pBasis,
+		               const DmrgBasisWithOperatorsType& pBasisSummed,
+		               DmrgBasisType const &pSE,
+		               int direction)
+		{
+			// size of this partition
+			size_t bs = pBasis.partition(m+1)-pBasis.partition(m);
+
+			// density matrix block for this partition:
+			BuildingBlockType matrixBlock(bs,bs);
+
+			// weight of the ground state:
+			RealType w = target.gsWeight();
+
+			// if we are to target the ground state do it now:
+			if (target.includeGroundStage())
+				initPartition(matrixBlock,pBasis,m,target.gs(),
+						pBasisSummed,pSE,direction,w);
+
+			// target all other states if any:
+			for (size_t i=0;i<target.size();i++) {
+				w = target.weight(i)/target.normSquared(i);
+				initPartition(matrixBlock,pBasis,m,target(i),
+						pBasisSummed,pSE,direction,w);
+			}
+
+			// set this matrix block into data_
+			data_.setBlock(m,pBasis.partition(m),matrixBlock);
+		}
+@}
+
 OK, this function was called above and accumulates the density matrix for a single target vector 
 \verb|v| and a single symmetry sector \verb|m|. It also weights the contribution of \verb|v| with \verb|weight|.
 The algorithm distingushes if we're expanding the system or the environment.%'
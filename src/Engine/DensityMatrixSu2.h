@@ -86,6 +86,7 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 #include "AlmostEqual.h" // in PsimagLite
 #include "BlockMatrix.h"
 #include "DensityMatrixBase.h"
+#include "Threads.h"
 
 namespace Dmrg {
 	//!
@@ -179,8 +180,6 @@ namespace Dmrg {
 				DmrgBasisType const &pSE,
 				int direction)
 		{
-			BuildingBlockType matrixBlock;
-			
 			for (size_t m=0;m<pBasis.partition()-1;m++) {
 				// Definition: Given partition p with (j m) findMaximalPartition(p) returns the partition p' (with j,j)
 				
@@ -189,22 +188,12 @@ namespace Dmrg {
 					//if (enforceSymmetry && size_t(m)!=mMaximal_[m]) continue; 
 					// we'll fill non-maximal partitions later
 				}
-
-				size_t bs = pBasis.partition(m+1)-pBasis.partition(m);
-				
-				matrixBlock.reset(bs,bs);
-				
-				for (size_t i=pBasis.partition(m);i<pBasis.partition(m+1);i++) {
-					for (size_t j=pBasis.partition(m);j<pBasis.partition(m+1);j++) {
-						
-						matrixBlock(i-pBasis.partition(m),j-pBasis.partition(m))=
-							densityMatrixAux(i,j,target,pBasisSummed,pSE,direction);
-						
-					}
-				}
-				data_.setBlock(m,pBasis.partition(m),matrixBlock);
 			}
 
+			//loop over all partitions, in parallel:
+			ParallelInit parallelInit(*this,target,pBasis,pBasisSummed,pSE,direction);
+			Threads::loopCreate(pBasis.partition()-1,parallelInit);
+
 			if (verbose_) {
 				std::cerr<<"DENSITYMATRIXPRINT option="<<direction<<"\n";
 				std::cerr<<(*this);
@@ -224,6 +213,40 @@ namespace Dmrg {
 				const DensityMatrixSu2<RealType_,
     					DmrgBasisType_,DmrgBasisWithOperatorsType_,TargettingType_>& dm);
 	private:
+
+		class ParallelInit {
+		public:
+			ParallelInit(DensityMatrixSu2& dm,
+			             const TargettingType& target,
+			             DmrgBasisWithOperatorsType const &pBasis,
+			             const DmrgBasisWithOperatorsType& pBasisSummed,
+			             DmrgBasisType const &pSE,
+			             int direction)
+			: dm_(dm),target_(target),pBasis_(pBasis),
+			  pBasisSummed_(pBasisSummed),pSE_(pSE),direction_(direction)
+			{}
+
+			void thread_function_(size_t threadNum,size_t blockSize,pthread_mutex_t*)
+			{
+				size_t total = pBasis_.partition()-1;
+				for (size_t p=0;p<blockSize;p++) {
+					size_t m = threadNum*blockSize + p;
+					if (m>=total) break;
+					dm_.initBlock(m,target_,pBasis_,pBasisSummed_,pSE_,direction_);
+				}
+			}
+
+		private:
+			DensityMatrixSu2& dm_;
+			const TargettingType& target_;
+			DmrgBasisWithOperatorsType const &pBasis_;
+			const DmrgBasisWithOperatorsType& pBasisSummed_;
+			DmrgBasisType const &pSE_;
+			int direction_;
+		}; // class ParallelInit
+
+		friend class ParallelInit;
+
 		BlockMatrixType data_;
 		std::vector<size_t> mMaximal_;
 		const DmrgBasisWithOperatorsType& pBasis_;
@@ -265,25 +288,44 @@ namespace Dmrg {
 			}
 			return true;
 		}
-		DensityMatrixElementType densityMatrixAux(size_t alpha1,size_t alpha2,const TargettingType& target,
-			DmrgBasisWithOperatorsType const &pBasisSummed,DmrgBasisType const &pSE,size_t direction)
+		//! Sets block m of data_; each m can be done by a different thread
+		void initBlock(size_t m,
+		               const TargettingType& target,
+		               DmrgBasisWithOperatorsType const &pBasis,
+		               const DmrgBasisWithOperatorsType& pBasisSummed,
+		               DmrgBasisType const &pSE,
+		               size_t direction)
 		{
-			DensityMatrixElementType sum=0;
+			size_t bs = pBasis.partition(m+1)-pBasis.partition(m);
+			BuildingBlockType matrixBlock(bs,bs);
+
 			// The g.s. has to be treated separately because it's usually a vector of double, whereas
 			// the other targets might be complex, and C++ generic programming capabilities are weak... we need D!!!
-			if (target.includeGroundStage()) sum +=  densityMatrixHasFactors(alpha1,alpha2,target.gs(),
-			    		pBasisSummed,pSE,direction)*target.gsWeight();
-			
-			for (size_t i=0;i<target.size();i++) 
-				sum += densityMatrixHasFactors(alpha1,alpha2,target(i),
-					pBasisSummed,pSE,direction)*target.weight(i)/target.normSquared(i);
+			if (target.includeGroundStage())
+				densityMatrixHasFactors(matrixBlock,pBasis,m,target.gs(),
+						pBasisSummed,pSE,direction,target.gsWeight());
+
+			for (size_t i=0;i<target.size();i++)
+				densityMatrixHasFactors(matrixBlock,pBasis,m,target(i),
+						pBasisSummed,pSE,direction,target.weight(i)/target.normSquared(i));
 
-			return sum;
+			data_.setBlock(m,pBasis.partition(m),matrixBlock);
 		}
-		
+
+		//! Adds weight * w * w^\dagger to matrixBlock, where
+		//! w(alpha,beta) = sum_eta factors(alpha,beta;eta) v(eta), for alpha in
+		//! partition m; only columns beta of w that aren't zero are kept.
+		//! The factors are real, so this is the same as summing
+		//! v(eta1) v(eta2)^* factors(alpha1,beta;eta1) factors(alpha2,beta;eta2)
 		template<typename TargetVectorType>
-		DensityMatrixElementType densityMatrixHasFactors(size_t alpha1,size_t alpha2,const TargetVectorType& v,
-			DmrgBasisWithOperatorsType const &pBasisSummed,DmrgBasisType const &pSE,size_t direction)
+		void densityMatrixHasFactors(BuildingBlockType& matrixBlock,
+		                             DmrgBasisWithOperatorsType const &pBasis,
+		                             size_t m,
+		                             const TargetVectorType& v,
+		                             DmrgBasisWithOperatorsType const &pBasisSummed,
+		                             DmrgBasisType const &pSE,
+		                             size_t direction,
+		                             RealType weight)
 		{
 			int ne = pBasisSummed.size();
 			int ns = pSE.size()/ne;
@@ -292,35 +334,40 @@ namespace Dmrg {
 				ns=pBasisSummed.size();
 				ne=pSE.size()/ns;
 			}
-				
-			DensityMatrixElementType sum=0;
+			size_t offset = pBasis.partition(m);
+			int bs = pBasis.partition(m+1)-offset;
 
 			// Make sure we don't copy just get the reference here!!
 			const FactorsType& factors = pSE.getFactors();
 
+			// w is stored by columns, and grows only by the non-zero ones
+			std::vector<DensityMatrixElementType> w;
+			std::vector<DensityMatrixElementType> column(bs);
+			int cols = 0;
 			for (size_t beta=0;beta<total;beta++) {
-				// sum over environ:
-				int i1 = alpha1+beta*ns;
-				int i2 = alpha2+beta*ns;
-				// sum over system:
-				if (direction!=EXPAND_SYSTEM) {
-					i1 = beta + alpha1*ns;
-					i2 = beta + alpha2*ns;
-				}		
-				for (int k1=factors.getRowPtr(i1);k1<factors.getRowPtr(i1+1);k1++) {
-					int eta1 = factors.getCol(k1);
-					int ii = pSE.permutationInverse(eta1);
-					for (int k2=factors.getRowPtr(i2);k2<factors.getRowPtr(i2+1);k2++) {
-						int eta2 =  factors.getCol(k2);
-						int jj = pSE.permutationInverse(eta2);
-					
-						DensityMatrixElementType tmp3= v[ii] * std::conj(v[jj]) * 
-							factors.getValue(k1) * factors.getValue(k2);
-						sum += tmp3;
+				bool nonZero = false;
+				for (int a=0;a<bs;a++) {
+					// sum over environ:
+					int i1 = offset+a+beta*ns;
+					// sum over system:
+					if (direction!=EXPAND_SYSTEM) i1 = beta + (offset+a)*ns;
+					DensityMatrixElementType sum=0;
+					for (int k1=factors.getRowPtr(i1);k1<factors.getRowPtr(i1+1);k1++) {
+						int ii = pSE.permutationInverse(factors.getCol(k1));
+						sum += v[ii] * factors.getValue(k1);
 					}
+					column[a] = sum;
+					if (sum!=static_cast<RealType>(0.0)) nonZero = true;
 				}
+				if (!nonZero) continue;
+				w.insert(w.end(),column.begin(),column.end());
+				cols++;
 			}
-			return sum;
+			if (cols==0) return;
+
+			DensityMatrixElementType alpha=weight,one=1.0;
+			psimag::BLAS::GEMM('N','C',bs,bs,cols,alpha,&(w[0]),bs,&(w[0]),bs,
+			                   one,&(matrixBlock(0,0)),bs);
 		}
 
 		//! only used for debugging
@@ -0,0 +1,324 @@
+
+/*
+Copyright (c) 2009, UT-Battelle, LLC
+All rights reserved
+
+[DMRG++, Version 2.0.0]
+[by G.A., Oak Ridge National Laboratory]
+
+UT Battelle Open Source Software License 11242008
+
+OPEN SOURCE LICENSE
+
+Subject to the conditions of this License, each
+contributor to this software hereby grants, free of
+charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"), a
+perpetual, worldwide, non-exclusive, no-charge,
+royalty-free, irrevocable copyright license to use, copy,
+modify, merge, publish, distribute, and/or sublicense
+copies of the Software.
+
+1. Redistributions of Software must retain the above
+copyright and license notices, this list of conditions,
+and the following disclaimer.  Changes or modifications
+to, or derivative works of, the Software should be noted
+with comments and the contributor and organization's
+name.
+
+2. Neither the names of UT-Battelle, LLC or the
+Department of Energy nor the names of the Software
+contributors may be used to endorse or promote products
+derived from this software without specific prior written
+permission of UT-Battelle.
+
+3. The software and the end-user documentation included
+with the redistribution, with or without modification,
+must include the following acknowledgment:
+
+"This product includes software produced by UT-Battelle,
+LLC under Contract No. DE-AC05-00OR22725  with the
+Department of Energy."
+ 
+*********************************************************
+DISCLAIMER
+
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT OWNER, CONTRIBUTORS, UNITED STATES GOVERNMENT,
+OR THE UNITED STATES DEPARTMENT OF ENERGY BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+
+NEITHER THE UNITED STATES GOVERNMENT, NOR THE UNITED
+STATES DEPARTMENT OF ENERGY, NOR THE COPYRIGHT OWNER, NOR
+ANY OF THEIR EMPLOYEES, REPRESENTS THAT THE USE OF ANY
+INFORMATION, DATA, APPARATUS, PRODUCT, OR PROCESS
+DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
+
+*********************************************************
+*/
+/** \ingroup DMRG */
+/*@{*/
+
+/*! \file DensityMatrixSvd.h
+ *
+ *  Same result as DensityMatrixLocal, but without forming the density
+ *  matrix: for each symmetry block, the target vectors are written as a
+ *  matrix psi(alpha,beta), with alpha in the block and beta in the
+ *  basis that is summed over, and the columns of all targets are put
+ *  side by side, each multiplied by the square root of its weight.
+ *  Then rho = psi * psi^\dagger, so that the left singular vectors of psi
+ *  are the eigenvectors of rho, and the squared singular values are
+ *  its eigenvalues. Columns that are zero (because of the symmetry)
+ *  are not included.
+ *
+ */
+
+#ifndef DENSITY_MATRIX_SVD_H
+#define DENSITY_MATRIX_SVD_H
+#include <cmath>
+#include "ProgressIndicator.h"
+#include "BlockMatrix.h"
+#include "DensityMatrixBase.h"
+#include "LapackExtra.h"
+#include "Threads.h"
+
+namespace Dmrg {
+	//!
+	template<
+		typename RealType,
+		typename DmrgBasisType,
+		typename DmrgBasisWithOperatorsType,
+		typename TargettingType
+		>
+
+	class DensityMatrixSvd : public DensityMatrixBase<RealType,DmrgBasisType,DmrgBasisWithOperatorsType,TargettingType> {
+		typedef typename TargettingType::VectorWithOffsetType TargetVectorType;
+		typedef typename TargettingType::TargetVectorType::value_type DensityMatrixElementType;
+		typedef BlockMatrix<DensityMatrixElementType,PsimagLite::Matrix<DensityMatrixElementType> > BlockMatrixType;
+		typedef PsimagLite::ProgressIndicator ProgressIndicatorType;
+
+		enum {EXPAND_SYSTEM = TargettingType::EXPAND_SYSTEM };
+
+	public:
+		typedef typename BlockMatrixType::BuildingBlockType BuildingBlockType;
+
+		DensityMatrixSvd(
+			const TargettingType& target,
+			const DmrgBasisWithOperatorsType& pBasis,
+			const DmrgBasisWithOperatorsType& pBasisSummed,
+			const DmrgBasisType& pSE,
+			size_t direction,bool debug=false,bool verbose=false)
+		:
+			progress_("DensityMatrixSvd",0),
+			data_(pBasis.size(),pBasis.partition()-1),
+			eigs_(pBasis.size(),0.0),
+			debug_(debug),verbose_(verbose)
+		{
+		}
+
+		virtual BlockMatrixType& operator()()
+		{
+			return data_;
+		}
+
+		virtual size_t rank() { return data_.rank(); }
+
+		virtual void check(int direction)
+		{
+		}
+
+		virtual void check2(int direction)
+		{
+		}
+
+		//! The work was done by init; all processes do all blocks
+		template<typename ConcurrencyType>
+		void diag(std::vector<RealType>& eigs,char jobz,ConcurrencyType& concurrency)
+		{
+			eigs = eigs_;
+		}
+
+		virtual void init(
+				const TargettingType& target,
+				DmrgBasisWithOperatorsType const &pBasis,
+				const DmrgBasisWithOperatorsType& pBasisSummed,
+				DmrgBasisType const &pSE,
+				int direction)
+		{
+			{
+				std::ostringstream msg;
+				msg<<"Init partition for all targets, by svd";
+				progress_.printline(msg,std::cout);
+			}
+			ParallelInit parallelInit(*this,target,pBasis,pBasisSummed,pSE,direction);
+			Threads::loopCreate(pBasis.partition()-1,parallelInit);
+			{
+				std::ostringstream msg;
+				msg<<"Done with init partition";
+				progress_.printline(msg,std::cout);
+			}
+		}
+
+	private:
+
+		class ParallelInit {
+		public:
+			ParallelInit(DensityMatrixSvd& dm,
+			             const TargettingType& target,
+			             DmrgBasisWithOperatorsType const &pBasis,
+			             const DmrgBasisWithOperatorsType& pBasisSummed,
+			             DmrgBasisType const &pSE,
+			             int direction)
+			: dm_(dm),target_(target),pBasis_(pBasis),
+			  pBasisSummed_(pBasisSummed),pSE_(pSE),direction_(direction)
+			{}
+
+			void thread_function_(size_t threadNum,size_t blockSize,pthread_mutex_t*)
+			{
+				size_t total = pBasis_.partition()-1;
+				for (size_t p=0;p<blockSize;p++) {
+					size_t m = threadNum*blockSize + p;
+					if (m>=total) break;
+					dm_.initBlock(m,target_,pBasis_,pBasisSummed_,pSE_,direction_);
+				}
+			}
+
+		private:
+			DensityMatrixSvd& dm_;
+			const TargettingType& target_;
+			DmrgBasisWithOperatorsType const &pBasis_;
+			const DmrgBasisWithOperatorsType& pBasisSummed_;
+			DmrgBasisType const &pSE_;
+			int direction_;
+		}; // class ParallelInit
+
+		friend class ParallelInit;
+
+		ProgressIndicatorType progress_;
+		BlockMatrixType data_;
+		std::vector<RealType> eigs_;
+		bool debug_,verbose_;
+
+		//! Sets block m of data_ and eigs_; each m can be done by a different thread
+		void initBlock(size_t m,
+		               const TargettingType& target,
+		               DmrgBasisWithOperatorsType const &pBasis,
+		               const DmrgBasisWithOperatorsType& pBasisSummed,
+		               DmrgBasisType const &pSE,
+		               int direction)
+		{
+			size_t offset = pBasis.partition(m);
+			size_t bs = pBasis.partition(m+1)-offset;
+
+			std::vector<std::vector<DensityMatrixElementType> > columns;
+			if (target.includeGroundStage())
+				addColumns(columns,pBasis,m,target.gs(),pBasisSummed,pSE,
+						direction,target.gsWeight());
+			for (size_t i=0;i<target.size();i++)
+				addColumns(columns,pBasis,m,target(i),pBasisSummed,pSE,
+						direction,target.weight(i)/target.normSquared(i));
+
+			BuildingBlockType psi(bs,columns.size());
+			for (size_t j=0;j<columns.size();j++)
+				for (size_t i=0;i<bs;i++) psi(i,j) = columns[j][i];
+			columns.clear();
+
+			BuildingBlockType u;
+			std::vector<RealType> s;
+			leftSingularVectors(u,s,psi);
+
+			// singular values are in decreasing order, but eigenvalues
+			// are in increasing order (as in DensityMatrixLocal), so that
+			// ties are broken in the same way when choosing the kept states
+			size_t zeros = bs - s.size();
+			BuildingBlockType uIncreasing(bs,bs);
+			for (size_t k=0;k<s.size();k++) {
+				size_t kk = s.size() - 1 - k;
+				for (size_t i=0;i<bs;i++) uIncreasing(i,zeros+k) = u(i,kk);
+				eigs_[offset+zeros+k] = s[kk]*s[kk];
+			}
+			for (size_t k=0;k<zeros;k++) eigs_[offset+k] = 0.0;
+			completeColumns(uIncreasing,zeros);
+			enforcePhase(uIncreasing);
+			data_.setBlock(m,offset,uIncreasing);
+		}
+
+		//! Fills the first nz columns of a with an orthonormal basis of the
+		//! complement of its other (orthonormal) columns; these are the states
+		//! of zero weight, which the thin SVD does not return
+		void completeColumns(BuildingBlockType& a,size_t nz) const
+		{
+			size_t n = a.n_row();
+			std::vector<DensityMatrixElementType> v(n);
+			size_t filled = 0;
+			for (size_t j=0;j<n && filled<nz;j++) {
+				for (size_t i=0;i<n;i++) v[i] = (i==j) ? 1.0 : 0.0;
+				// project out twice, so that rounding does not spoil orthogonality
+				for (size_t pass=0;pass<2;pass++) {
+					for (size_t k=0;k<n;k++) {
+						if (k>=filled && k<nz) continue;
+						DensityMatrixElementType p = 0.0;
+						for (size_t i=0;i<n;i++) p += std::conj(a(i,k))*v[i];
+						for (size_t i=0;i<n;i++) v[i] -= p*a(i,k);
+					}
+				}
+				RealType norm2 = 0;
+				for (size_t i=0;i<n;i++) norm2 += std::norm(v[i]);
+				// some unit vector always has at least 1/n of its norm squared
+				// left in the complement, so this finds all nz columns
+				if (norm2*n<0.5) continue;
+				RealType norm = sqrt(norm2);
+				for (size_t i=0;i<n;i++) a(i,filled) = v[i]/norm;
+				filled++;
+			}
+			if (filled<nz) throw std::runtime_error(
+				"DensityMatrixSvd::completeColumns(...): internal error\n");
+		}
+
+		//! Adds to columns the non-zero columns psi(.,beta) of block m of v
+		void addColumns(std::vector<std::vector<DensityMatrixElementType> >& columns,
+				DmrgBasisWithOperatorsType const &pBasis,
+				size_t m,
+				const TargetVectorType& v,
+				DmrgBasisWithOperatorsType const &pBasisSummed,
+				DmrgBasisType const &pSE,
+				int direction,
+				RealType weight)
+		{
+			if (weight<=0) return;
+			RealType factor = sqrt(weight);
+			size_t total = pBasisSummed.size();
+			size_t ns = (direction==EXPAND_SYSTEM) ? pSE.size()/total : total;
+			size_t offset = pBasis.partition(m);
+			size_t bs = pBasis.partition(m+1)-offset;
+
+			std::vector<DensityMatrixElementType> column(bs);
+			for (size_t beta=0;beta<total;beta++) {
+				bool nonZero = false;
+				for (size_t i=0;i<bs;i++) {
+					size_t alpha = offset + i;
+					size_t x = (direction==EXPAND_SYSTEM) ?
+							alpha + beta*ns : beta + alpha*ns;
+					column[i] = v[pSE.permutationInverse(x)]*factor;
+					if (column[i]!=static_cast<RealType>(0.0)) nonZero = true;
+				}
+				if (nonZero) columns.push_back(column);
+			}
+		}
+	}; // class DensityMatrixSvd
+} // namespace Dmrg
+
+/*@}*/
+#endif
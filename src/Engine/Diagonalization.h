@@ -83,6 +83,9 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 #include "ProgressIndicator.h"
 #include "VectorWithOffset.h" // includes the std::norm functions
 #include "VectorWithOffsets.h" // includes the std::norm functions
+#include "InternalProductDistributed.h"
+#include "Threads.h"
+#include "AsyncWriter.h"
 
 namespace Dmrg {
 	
@@ -106,17 +109,21 @@ namespace Dmrg {
 		typedef typename TargettingType::TargetVectorType TargetVectorType;
 		typedef typename TargettingType::RealType RealType;
 		typedef typename IoType::Out IoOutType;
+		typedef AsyncWriter<IoOutType> AsyncWriterType;
 		typedef typename ModelType::OperatorsType OperatorsType;
 		typedef typename  OperatorsType::SparseMatrixType SparseMatrixType;
 		typedef typename ModelType::ModelHelperType ModelHelperType;
 		typedef typename ModelHelperType::LeftRightSuperType
 						LeftRightSuperType;
+		typedef typename TargettingType::VectorWithOffsetType
+				VectorWithOffsetType;
+
 		Diagonalization(const ParametersType& parameters,
 				const ModelType& model,
     				ConcurrencyType& concurrency,
 				const bool& verbose,
     				const bool& useReflection,
-				IoOutType& io,
+				AsyncWriterType& io,
     				const size_t& quantumSector,
     				WaveFunctionTransfType& waveFunctionTransformation)
 			:
@@ -148,7 +155,6 @@ namespace Dmrg {
 			msg<<"Setting up Hamiltonian basis of size="<<lrs.super().size();
 			progress_.printline(msg,std::cout);
 		
-			TargetVectorType tmpVec;
 			std::vector<TargetVectorType> vecSaved;
 			std::vector<RealType> energySaved;
 			RealType gsEnergy;
@@ -180,41 +186,24 @@ namespace Dmrg {
 				vecSaved[i].resize(weights[i]);
 			}
 
-			typedef typename TargettingType::VectorWithOffsetType
-					VectorWithOffsetType;
 			VectorWithOffsetType initialVector(weights,lrs.super());
 			
 			waveFunctionTransformation_.triggerOn(lrs);
 			target.initialGuess(initialVector);
 			
+			std::vector<size_t> sectors;
+			for (size_t i=0;i<total;i++)
+				if (weights[i]>0) sectors.push_back(i);
 
-			for (size_t i=0;i<total;i++) {
-				if (weights[i]==0) continue;
-				std::ostringstream msg;
-				msg<<"About to diag. sector with quantum numbs. ";
-				size_t j = lrs.super().qn(lrs.super().partition(i));
-				std::vector<size_t> qns = BasisType::decodeQuantumNumber(j);
-				for (size_t k=0;k<qns.size();k++) msg<<qns[k]<<" ";
-				msg<<" pseudo="<<lrs.super().pseudoEffectiveNumber(
-						lrs.super().partition(i));
-				msg<<" quantumSector="<<quantumSector_;
-				
-				if (verbose_ && concurrency_.root()) {
-					msg<<" diagonaliseOneBlock, i="<<i;
-					msg<<" and weight="<<weights[i];
-				}
-				progress_.printline(msg,std::cout);
-				TargetVectorType initialVectorBySector(weights[i]);
-				initialVector.extract(initialVectorBySector,i);
-				if (onlyWft) {
-					vecSaved[i]=initialVectorBySector;
-					gsEnergy = oldEnergy_;
-				} else {
-					diagonaliseOneBlock(i,tmpVec,gsEnergy,lrs,initialVectorBySector);
-					vecSaved[i] = tmpVec;
-				}
-				energySaved[i]=gsEnergy;
-			}
+			ParallelSectors parallelSectors(*this,sectors,weights,initialVector,
+					lrs,onlyWft,vecSaved,energySaved);
+			// sectors in threads only if there are enough of them,
+			// otherwise the threads do each matrix vector product
+			if (sectors.size()>=Threads::threads() && !onlyWft &&
+			    parameters_.options.find("distributedMatvec")==std::string::npos)
+				Threads::loopCreate(sectors.size(),parallelSectors);
+			else
+				parallelSectors.thread_function_(0,sectors.size(),0);
 				
 			// calc gs energy
 			if (verbose_ && concurrency_.root()) std::cerr<<"About to calc gs energy\n";
@@ -258,6 +247,83 @@ namespace Dmrg {
 		}
 
  private:
+
+		//! Diagonalises sectors[x], each x can be done by a different thread
+		class ParallelSectors {
+		public:
+			ParallelSectors(Diagonalization& diag,
+			                const std::vector<size_t>& sectors,
+			                const std::vector<size_t>& weights,
+			                const VectorWithOffsetType& initialVector,
+			                const LeftRightSuperType& lrs,
+			                bool onlyWft,
+			                std::vector<TargetVectorType>& vecSaved,
+			                std::vector<RealType>& energySaved)
+			: diag_(diag),sectors_(sectors),weights_(weights),
+			  initialVector_(initialVector),lrs_(lrs),onlyWft_(onlyWft),
+			  vecSaved_(vecSaved),energySaved_(energySaved)
+			{}
+
+			void thread_function_(size_t threadNum,size_t blockSize,pthread_mutex_t*)
+			{
+				for (size_t p=0;p<blockSize;p++) {
+					size_t x = threadNum*blockSize + p;
+					if (x>=sectors_.size()) break;
+					size_t i = sectors_[x];
+					diag_.diagonaliseSector(i,weights_[i],initialVector_,lrs_,
+							onlyWft_,vecSaved_[i],energySaved_[i]);
+				}
+			}
+
+		private:
+			Diagonalization& diag_;
+			const std::vector<size_t>& sectors_;
+			const std::vector<size_t>& weights_;
+			const VectorWithOffsetType& initialVector_;
+			const LeftRightSuperType& lrs_;
+			bool onlyWft_;
+			std::vector<TargetVectorType>& vecSaved_;
+			std::vector<RealType>& energySaved_;
+		}; // class ParallelSectors
+
+		friend class ParallelSectors;
+
+		void diagonaliseSector(size_t i,
+		                       size_t weight,
+		                       const VectorWithOffsetType& initialVector,
+		                       const LeftRightSuperType& lrs,
+		                       bool onlyWft,
+		                       TargetVectorType& vecSaved,
+		                       RealType& energySaved)
+		{
+			std::ostringstream msg;
+			msg<<"About to diag. sector with quantum numbs. ";
+			size_t j = lrs.super().qn(lrs.super().partition(i));
+			std::vector<size_t> qns = BasisType::decodeQuantumNumber(j);
+			for (size_t k=0;k<qns.size();k++) msg<<qns[k]<<" ";
+			msg<<" pseudo="<<lrs.super().pseudoEffectiveNumber(
+					lrs.super().partition(i));
+			msg<<" quantumSector="<<quantumSector_;
+
+			if (verbose_ && concurrency_.root()) {
+				msg<<" diagonaliseOneBlock, i="<<i;
+				msg<<" and weight="<<weight;
+			}
+			progress_.printline(msg,std::cout);
+			TargetVectorType initialVectorBySector(weight);
+			initialVector.extract(initialVectorBySector,i);
+			if (onlyWft) {
+				vecSaved=initialVectorBySector;
+				energySaved = oldEnergy_;
+				return;
+			}
+			TargetVectorType tmpVec;
+			double gsEnergy = 0;
+			diagonaliseOneBlock(i,tmpVec,gsEnergy,lrs,initialVectorBySector);
+			vecSaved = tmpVec;
+			energySaved = gsEnergy;
+		}
+
 		//! Diagonalise the i-th block of the matrix, return its eigenvectors in tmpVec and its eigenvalues in energyTmp
 		template<typename SomeVectorType>
 		void diagonaliseOneBlock(
@@ -271,7 +337,14 @@ namespace Dmrg {
 			int iter=ProgramGlobals::LanczosSteps;
 			std::vector<RealType> tmpVec1,tmpVec2;
 			//srand48(7123443);
-			
+
+			if (parameters_.options.find("distributedMatvec")!=std::string::npos) {
+				DistributedTag<ModelType::ModelHelperType::DISTRIBUTED> tag;
+				diagonaliseOneBlockDistributed(i,tmpVec,energyTmp,lrs,
+					initialVector,iter,eps,tag);
+				return;
+			}
+
 			typename ModelType::ModelHelperType
 				modelHelper(i,lrs,model_.orbitals(),useReflection_);
 
@@ -300,6 +373,78 @@ namespace Dmrg {
 			diagonaliseOneBlock(i,tmpVec,energyTmp,modelHelper,
 					initialVector,iter,eps);
 		}
+
+		//! ModelHelperType::DISTRIBUTED, so that the distributed x+=Hy is
+		//! only compiled for model helpers that can do it
+		template<int> struct DistributedTag {};
+
+		//! Same as diagonaliseOneBlock below, but the Lanczos vectors
+		//! are split among MPI processes (see DistributedSector)
+		template<typename SomeVectorType>
+		void diagonaliseOneBlockDistributed(
+				int i,
+				SomeVectorType &tmpVec,
+				double &energyTmp,
+				const LeftRightSuperType& lrs,
+				const SomeVectorType& initialVector,
+				size_t iter,
+				RealType eps,
+				DistributedTag<1>)
+		{
+			typedef InternalProductDistributed<typename SomeVectorType::value_type,
+					ModelType> MyInternalProduct;
+			typedef LanczosSolver<RealType,MyInternalProduct,SomeVectorType> LanczosSolverType;
+			typedef typename MyInternalProduct::DistributedSectorType DistributedSectorType;
+
+			if (useReflection_)
+				throw std::runtime_error("distributedMatvec is unsupported with"
+					" reflection symmetry\n");
+
+			DistributedSectorType sector(lrs,i);
+			std::ostringstream msg;
+			msg<<"I will now diagonalize a matrix of size="<<sector.globalSize();
+			progress_.printline(msg,std::cout);
+			if (sector.globalSize()==0) {
+				tmpVec.resize(0);
+				energyTmp=10000;
+				return;
+			}
+
+			typename ModelType::ModelHelperType modelHelper(i,lrs,sector.rows());
+			std::vector<size_t> columns;
+			model_.columns(columns,modelHelper);
+			sector.setHalo(columns);
+			modelHelper.setHalo(sector.halo());
+			MyInternalProduct lanczosHelper(&model_,&modelHelper,&sector);
+
+			std::ostringstream msg2;
+			msg2<<"Distributed among "<<sector.processes()<<" processes, ";
+			msg2<<"this one has "<<sector.size()<<" rows and a halo of ";
+			msg2<<sector.halo().size();
+			progress_.printline(msg2,std::cout);
+
+			LanczosSolverType lanczosSolver(lanczosHelper,iter,eps,concurrency_.rank(),parameters_.options);
+			SomeVectorType initialLocal;
+			sector.extract(initialLocal,initialVector);
+			SomeVectorType tmpLocal(lanczosHelper.rank());
+			lanczosSolver.computeGroundState(energyTmp,tmpLocal,initialLocal);
+			sector.allGather(tmpVec,tmpLocal);
+		}
+
+		//! dmrg.cpp (see configure.pl) already rejects distributedMatvec
+		//! for these model helpers (SU(2))
+		template<typename SomeVectorType>
+		void diagonaliseOneBlockDistributed(int,
+		                                    SomeVectorType&,
+		                                    double&,
+		                                    const LeftRightSuperType&,
+		                                    const SomeVectorType&,
+		                                    size_t,
+		                                    RealType,
+		                                    DistributedTag<0>)
+		{
+			throw std::runtime_error("distributedMatvec is unsupported with SU(2)\n");
+		}
 		
 		template<typename SomeVectorType>
 		void diagonaliseOneBlock(
@@ -340,7 +485,7 @@ namespace Dmrg {
 		//DiagonalizationType diagonalization_;
 		const bool& verbose_;
 		const bool& useReflection_;
-		IoOutType& io_;
+		AsyncWriterType& io_; // the data file
 		PsimagLite::ProgressIndicator progress_;
 		const size_t& quantumSector_; // this needs to be a reference since DmrgSolver will change it
 		WaveFunctionTransfType& waveFunctionTransformation_;
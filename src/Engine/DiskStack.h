@@ -80,12 +80,13 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 #include "ProgressIndicator.h"
 
 //! A disk stack, similar to std::stack but stores in disk not in memory
+//! IoType is IoSimple or IoBinary
 namespace Dmrg {
-	template<typename DataType>
+	template<typename DataType,typename IoType=PsimagLite::IoSimple>
 	class DiskStack {
 	
-		typedef typename PsimagLite::IoSimple::In IoInType;
-		typedef typename PsimagLite::IoSimple::Out IoOutType;
+		typedef typename IoType::In IoInType;
+		typedef typename IoType::Out IoOutType;
 
 		public:
 			DiskStack(const std::string &file1,const std::string &file2,bool hasLoad,size_t rank=0) :
@@ -128,7 +129,11 @@ namespace Dmrg {
 				//ioOut_.printline("#STACKMETADEBUG="+ttos(debug_));
 				ioOut_<<"#STACKMETASTACK\n";
 				ioOut_<<stack_;
-				ioOut_.close();
+				try {
+					ioOut_.close();
+				} catch (std::exception& e) {
+					std::cerr<<e.what();
+				}
 			}
 
 			static bool persistent() { return true; }
@@ -136,12 +141,7 @@ namespace Dmrg {
 			void push(DataType const &d) 
 			{
 				//std::string tmpLabel = fileOut_ + ttos(total_);
-				ioOut_.open(fileOut_,std::ios_base::app,rank_);
-				d.save(ioOut_);
-				ioOut_.close();
-
-				stack_.push(total_);
-				total_++;
+				stack_.push(append(d));
 
 				//std::string s = "Pushing with label="+fileOut_+" and total="+ttos(total_);
 				//debugPrint(s);
@@ -161,20 +161,36 @@ namespace Dmrg {
 
 			DataType top()
 			{
-				ioIn_.open(fileIn_);
-				DataType dt(ioIn_,"",stack_.top());
 //				std::string s = "Topping with label="+fileIn_+" stack_.top="+ttos(stack_.top());
 //				std::ostringstream msg;
 //				msg<<s;
 //				progress_.printline(msg,std::cout);
+				return entry(stack_.top());
+			}
+
+			//! Writes d after the entries written so far, without
+			//! pushing it; returns its number, for entry(...)
+			int append(DataType const &d)
+			{
+				ioOut_.open(fileOut_,std::ios_base::app,rank_);
+				d.save(ioOut_);
+				ioOut_.close();
+				return total_++;
+			}
+
+			//! The entry number x of the input file
+			DataType entry(int x)
+			{
+				ioIn_.open(fileIn_);
+				DataType dt(ioIn_,"",x);
 				ioIn_.close();
 				return dt;
 			}
 
 			size_t size() const { return stack_.size(); }
 
-			template<typename DataType_>
-			friend std::ostream& operator<<(std::ostream& os,const DiskStack<DataType_>& ds);
+			template<typename DataType_,typename IoType_>
+			friend std::ostream& operator<<(std::ostream& os,const DiskStack<DataType_,IoType_>& ds);
 
 		private:
 
@@ -187,8 +203,8 @@ namespace Dmrg {
 			std::stack<int> stack_;
 	}; // class DiskStack
 
-	template<typename DataType>
-	std::ostream& operator<<(std::ostream& os,const DiskStack<DataType>& ds)
+	template<typename DataType,typename IoType>
+	std::ostream& operator<<(std::ostream& os,const DiskStack<DataType,IoType>& ds)
 	{
 		os<<"DISKSTACK: filein: "<<ds.fileIn_<<" fileout="<<ds.fileOut_<<"\n";
 		os<<"total="<<ds.total_<<"\n";
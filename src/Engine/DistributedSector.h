@@ -0,0 +1,364 @@
+// BEGIN LICENSE BLOCK
+/*
+Copyright (c) 2009, UT-Battelle, LLC
+All rights reserved
+
+[DMRG++, Version 2.0.0]
+[by G.A., Oak Ridge National Laboratory]
+
+UT Battelle Open Source Software License 11242008
+
+OPEN SOURCE LICENSE
+
+Subject to the conditions of this License, each
+contributor to this software hereby grants, free of
+charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"), a
+perpetual, worldwide, non-exclusive, no-charge,
+royalty-free, irrevocable copyright license to use, copy,
+modify, merge, publish, distribute, and/or sublicense
+copies of the Software.
+
+1. Redistributions of Software must retain the above
+copyright and license notices, this list of conditions,
+and the following disclaimer.  Changes or modifications
+to, or derivative works of, the Software should be noted
+with comments and the contributor and organization's
+name.
+
+2. Neither the names of UT-Battelle, LLC or the
+Department of Energy nor the names of the Software
+contributors may be used to endorse or promote products
+derived from this software without specific prior written
+permission of UT-Battelle.
+
+3. The software and the end-user documentation included
+with the redistribution, with or without modification,
+must include the following acknowledgment:
+
+"This product includes software produced by UT-Battelle,
+LLC under Contract No. DE-AC05-00OR22725  with the
+Department of Energy."
+ 
+*********************************************************
+DISCLAIMER
+
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT OWNER, CONTRIBUTORS, UNITED STATES GOVERNMENT,
+OR THE UNITED STATES DEPARTMENT OF ENERGY BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+
+NEITHER THE UNITED STATES GOVERNMENT, NOR THE UNITED
+STATES DEPARTMENT OF ENERGY, NOR THE COPYRIGHT OWNER, NOR
+ANY OF THEIR EMPLOYEES, REPRESENTS THAT THE USE OF ANY
+INFORMATION, DATA, APPARATUS, PRODUCT, OR PROCESS
+DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
+
+*********************************************************
+
+
+*/
+// END LICENSE BLOCK
+
+/** \ingroup DMRG */
+/*@{*/
+
+/*! \file DistributedSector.h
+ *
+ *  Splits the rows of one symmetry sector of the superblock among
+ *  the MPI processes, grouping rows by the quantum number of their
+ *  left (system) state. Each process owns whole left-qn blocks,
+ *  assigned largest first to the least loaded process.
+ *
+ *  Vectors are kept by each process only for its own rows ("local").
+ *  For x+=Hy a process also needs the entries of y at the rows of other
+ *  processes that its rows connect to (the "halo"); these are exchanged
+ *  at each product, after the lists of what to send to whom are set up
+ *  once (see setHalo). The full sector vector ("global") is assembled
+ *  only for the result. Renormalized operators are replicated, so no
+ *  other communication is needed.
+ *
+ *  Without -DUSE_MPI there is a single process that owns all rows.
+ */
+#ifndef DISTRIBUTED_SECTOR_H
+#define DISTRIBUTED_SECTOR_H
+
+#include <vector>
+#include <map>
+#include <stdexcept>
+#include <algorithm>
+#include <complex>
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+#include "PackIndices.h" // in PsimagLite
+
+namespace Dmrg {
+
+	//! MPI type of the real scalars that make up FieldType
+	template<typename FieldType>
+	struct MpiRealType {
+		typedef FieldType RealType;
+#ifdef USE_MPI
+		static MPI_Datatype type() { return MPI_DOUBLE; }
+#endif
+	};
+
+	template<>
+	struct MpiRealType<float> {
+		typedef float RealType;
+#ifdef USE_MPI
+		static MPI_Datatype type() { return MPI_FLOAT; }
+#endif
+	};
+
+	template<typename T>
+	struct MpiRealType<std::complex<T> > {
+		typedef T RealType;
+#ifdef USE_MPI
+		static MPI_Datatype type() { return MpiRealType<T>::type(); }
+#endif
+	};
+
+	template<typename LeftRightSuperType>
+	class DistributedSector {
+
+		typedef std::pair<size_t,size_t> PairType;
+		typedef PsimagLite::PackIndices PackIndicesType;
+
+	public:
+
+		DistributedSector(const LeftRightSuperType& lrs,size_t m)
+		: lrs_(lrs),offset_(lrs.super().partition(m)),nprocs_(1),rank_(0)
+		{
+#ifdef USE_MPI
+			MPI_Comm_size(MPI_COMM_WORLD,&nprocs_);
+			MPI_Comm_rank(MPI_COMM_WORLD,&rank_);
+#endif
+			globalSize_ = lrs.super().partition(m+1) - offset_;
+
+			// number of rows for each quantum number of alpha
+			std::map<size_t,size_t> blocks;
+			for (size_t i=0;i<globalSize_;i++) blocks[leftQn(i)]++;
+
+			// largest first, to the least loaded process
+			std::vector<PairType> sizes;
+			std::map<size_t,size_t>::const_iterator it;
+			for (it=blocks.begin();it!=blocks.end();++it)
+				sizes.push_back(PairType(it->second,it->first));
+			std::sort(sizes.begin(),sizes.end());
+			std::vector<size_t> load(nprocs_,0);
+			for (size_t b=sizes.size();b>0;b--) {
+				size_t p = std::min_element(load.begin(),load.end()) - load.begin();
+				owner_[sizes[b-1].second] = p;
+				load[p] += sizes[b-1].first;
+			}
+			for (size_t i=0;i<globalSize_;i++)
+				if (owner(i)==rank_) rows_.push_back(i);
+		}
+
+		size_t processes() const { return nprocs_; }
+
+		//! Number of rows of this process
+		size_t size() const { return rows_.size(); }
+
+		size_t globalSize() const { return globalSize_; }
+
+		//! Rows of this process, in the numbering of the full sector
+		const std::vector<size_t>& rows() const { return rows_; }
+
+		//! Rows of other processes that this process reads, see exchange
+		const std::vector<size_t>& halo() const { return halo_; }
+
+		//! columns are the rows of y, sorted and in the numbering of the
+		//! full sector, that x+=Hy needs for the rows of this process.
+		//! Sets the halo and tells each owner which of its rows to send
+		void setHalo(const std::vector<size_t>& columns)
+		{
+			std::vector<PairType> remote;
+			for (size_t k=0;k<columns.size();k++) {
+				int p = owner(columns[k]);
+				if (p!=rank_) remote.push_back(PairType(p,columns[k]));
+			}
+			std::sort(remote.begin(),remote.end());
+			halo_.resize(remote.size());
+			recvCounts_.assign(nprocs_,0);
+			for (size_t k=0;k<remote.size();k++) {
+				halo_[k] = remote[k].second;
+				recvCounts_[remote[k].first]++;
+			}
+			sendCounts_.assign(nprocs_,0);
+			sendIndices_.clear();
+			if (nprocs_==1) return;
+#ifdef USE_MPI
+			MPI_Alltoall(&(recvCounts_[0]),1,MPI_INT,&(sendCounts_[0]),1,MPI_INT,
+			             MPI_COMM_WORLD);
+			std::vector<int> recvDispls,sendDispls;
+			size_t nsend = displacements(sendDispls,sendCounts_,1);
+			displacements(recvDispls,recvCounts_,1);
+			std::vector<unsigned long> wanted(halo_.begin(),halo_.end());
+			std::vector<unsigned long> requested(nsend);
+			MPI_Alltoallv(pointer(wanted,0),&(recvCounts_[0]),&(recvDispls[0]),
+			              MPI_UNSIGNED_LONG,pointer(requested,0),&(sendCounts_[0]),
+			              &(sendDispls[0]),MPI_UNSIGNED_LONG,MPI_COMM_WORLD);
+			sendIndices_.resize(nsend);
+			for (size_t k=0;k<nsend;k++) {
+				std::vector<size_t>::const_iterator found =
+					std::lower_bound(rows_.begin(),rows_.end(),requested[k]);
+				if (found==rows_.end() || *found!=requested[k])
+					throw std::runtime_error("DistributedSector::setHalo(...):"
+						" requested row not owned by this process\n");
+				sendIndices_[k] = found - rows_.begin();
+			}
+#endif
+		}
+
+		template<typename SomeVectorType>
+		void extract(SomeVectorType& local,const SomeVectorType& global) const
+		{
+			local.resize(rows_.size());
+			for (size_t k=0;k<rows_.size();k++) local[k] = global[rows_[k]];
+		}
+
+		//! extended is local followed by the entries of the halo
+		//! (see ModelHelperLocal::setHalo)
+		template<typename SomeVectorType>
+		void exchange(SomeVectorType& extended,const SomeVectorType& local) const
+		{
+			extended.resize(local.size()+halo_.size());
+			for (size_t k=0;k<local.size();k++) extended[k] = local[k];
+			if (nprocs_==1) return;
+#ifdef USE_MPI
+			typedef typename SomeVectorType::value_type FieldType;
+			typedef MpiRealType<FieldType> MpiType;
+			typedef typename MpiType::RealType RealType;
+			size_t factor = sizeof(FieldType)/sizeof(RealType);
+			SomeVectorType send(sendIndices_.size());
+			for (size_t k=0;k<send.size();k++) send[k] = local[sendIndices_[k]];
+			std::vector<int> sendCounts(nprocs_),recvCounts(nprocs_);
+			for (int p=0;p<nprocs_;p++) {
+				sendCounts[p] = sendCounts_[p]*factor;
+				recvCounts[p] = recvCounts_[p]*factor;
+			}
+			std::vector<int> sendDispls,recvDispls;
+			displacements(sendDispls,sendCounts,1);
+			displacements(recvDispls,recvCounts,1);
+			MPI_Alltoallv(pointer(send,0),&(sendCounts[0]),&(sendDispls[0]),
+			              MpiType::type(),pointer(extended,local.size()),
+			              &(recvCounts[0]),&(recvDispls[0]),MpiType::type(),
+			              MPI_COMM_WORLD);
+#endif
+		}
+
+		//! Every process gets the full vector from the local parts;
+		//! done only once, for the result of the Lanczos
+		template<typename SomeVectorType>
+		void allGather(SomeVectorType& global,const SomeVectorType& local) const
+		{
+			global.resize(globalSize_);
+			if (globalSize_==0) return;
+			if (nprocs_==1) {
+				for (size_t k=0;k<local.size();k++) global[rows_[k]] = local[k];
+				return;
+			}
+#ifdef USE_MPI
+			typedef typename SomeVectorType::value_type FieldType;
+			typedef MpiRealType<FieldType> MpiType;
+			typedef typename MpiType::RealType RealType;
+			size_t factor = sizeof(FieldType)/sizeof(RealType);
+			int n = rows_.size();
+			std::vector<int> counts(nprocs_),displs;
+			MPI_Allgather(&n,1,MPI_INT,&(counts[0]),1,MPI_INT,MPI_COMM_WORLD);
+			displacements(displs,counts,1);
+			std::vector<unsigned long> mine(rows_.begin(),rows_.end());
+			std::vector<unsigned long> indices(globalSize_);
+			MPI_Allgatherv(pointer(mine,0),n,MPI_UNSIGNED_LONG,&(indices[0]),
+			               &(counts[0]),&(displs[0]),MPI_UNSIGNED_LONG,MPI_COMM_WORLD);
+			for (int p=0;p<nprocs_;p++) counts[p] *= factor;
+			displacements(displs,counts,1);
+			SomeVectorType recv(globalSize_);
+			SomeVectorType& localNonConst = const_cast<SomeVectorType&>(local);
+			MPI_Allgatherv(pointer(localNonConst,0),n*factor,MpiType::type(),
+			               &(recv[0]),&(counts[0]),&(displs[0]),
+			               MpiType::type(),MPI_COMM_WORLD);
+			for (size_t k=0;k<globalSize_;k++) global[indices[k]] = recv[k];
+#endif
+		}
+
+		//! Sum over all processes of a partial (local) scalar
+		template<typename RealType>
+		RealType reduce(const RealType& partial) const
+		{
+			if (nprocs_==1) return partial;
+			RealType ret = partial;
+#ifdef USE_MPI
+			RealType tmp = partial;
+			MPI_Allreduce(&tmp,&ret,1,MpiRealType<RealType>::type(),
+			              MPI_SUM,MPI_COMM_WORLD);
+#endif
+			return ret;
+		}
+
+	private:
+
+		size_t leftQn(size_t i) const
+		{
+			PackIndicesType pack(lrs_.left().size());
+			size_t alpha,beta;
+			pack.unpack(alpha,beta,lrs_.super().permutation(i+offset_));
+			return lrs_.left().qn(alpha);
+		}
+
+		int owner(size_t i) const
+		{
+			std::map<size_t,int>::const_iterator it = owner_.find(leftQn(i));
+			return it->second;
+		}
+
+		static size_t displacements(std::vector<int>& displs,
+		                            const std::vector<int>& counts,
+		                            size_t factor)
+		{
+			displs.resize(counts.size());
+			size_t sum = 0;
+			for (size_t p=0;p<counts.size();p++) {
+				displs[p] = sum;
+				sum += counts[p]*factor;
+			}
+			return sum;
+		}
+
+		//! MPI wants a pointer even for empty vectors
+		template<typename SomeVectorType>
+		static void* pointer(SomeVectorType& v,size_t k)
+		{
+			return (k<v.size()) ? &(v[k]) : 0;
+		}
+
+		const LeftRightSuperType& lrs_;
+		size_t offset_;
+		int nprocs_;
+		int rank_;
+		size_t globalSize_;
+		std::map<size_t,int> owner_; // process of each quantum number of alpha
+		std::vector<size_t> rows_;
+		std::vector<size_t> halo_;
+		std::vector<int> sendCounts_,recvCounts_;
+		std::vector<size_t> sendIndices_; // positions in rows_ to send
+	}; // class DistributedSector
+} // namespace Dmrg
+
+/*@}*/
+#endif // DISTRIBUTED_SECTOR_H
@@ -84,6 +84,7 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 #include "BLAS.h"
 #include "IoSimple.h"
 #include "FermionSign.h"
+#include "BlockDiagonalMatrix.h"
 
 namespace Dmrg {
 	//! Move also checkpointing from DmrgSolver to here (FIXME)
@@ -102,13 +103,14 @@ namespace Dmrg {
 					BasisType;
 			typedef FermionSign FermionSignType;
 			typedef typename BasisType::RealType RealType;
+			typedef BlockDiagonalMatrix<MatrixType> BlockDiagonalMatrixType;
 
 			DmrgSerializer(
 				const FermionSignType& fS,
 				const FermionSignType& fE,
 				const LeftRightSuperType& lrs,
 				const VectorType& wf,
-				const MatrixType& transform,
+				const BlockDiagonalMatrixType& transform,
 				size_t direction)
 			: fS_(fS),
 			  fE_(fE),
@@ -119,7 +121,8 @@ namespace Dmrg {
 			{}
 			
 			
-			DmrgSerializer(typename PsimagLite::IoSimple::In& io,bool bogus = false) 
+			template<typename IoInputType>
+			DmrgSerializer(IoInputType& io,bool bogus = false) 
 			: fS_(io,bogus),
 			  fE_(io,bogus),
 			  lrs_(io)
@@ -128,7 +131,7 @@ namespace Dmrg {
 				std::string s = "#WAVEFUNCTION_sites=";
 				wavefunction_.load(io,s);
 				s = "#TRANSFORM_sites=";
-				io.readMatrix(transform_,s);
+				transform_.load(io,s);
 				s = "#DIRECTION=";
 				int x = 0;
 				io.readline(x,s);
@@ -157,7 +160,7 @@ namespace Dmrg {
 				for (size_t i=0;i<lrs_.left().block().size();i++) {
 					label += ttos(lrs_.left().block()[i])+",";
 				}
-				io.printMatrix(transform_,label);
+				transform_.save(io,label);
 				std::string s = "#DIRECTION="+ttos(direction_);
 				io.printline(s);
 			}
@@ -187,20 +190,7 @@ namespace Dmrg {
 			
 			void transform(MatrixType& ret,const MatrixType& O) const
 			{
-				//typedef typename MatrixType::value_type FieldType;
-				int nBig = O.n_row();
-				int nSmall = transform_.n_col();
-				MatrixType fmTmp(nSmall,nBig);
-				typename MatrixType::value_type alpha=1.0,beta=0.0;
-				if (ret.n_row()!=size_t(nSmall) || ret.n_col()!=
-						size_t(nSmall)) ret.reset(nSmall,nSmall);
-				psimag::BLAS::GEMM('N','N',nBig,nSmall,nBig,alpha,
-						&(O(0,0)),nBig,&(transform_(0,0)),nBig,beta,
-						&(fmTmp(0,0)),nBig);
-				
-				psimag::BLAS::GEMM('C','N',nSmall,nSmall,nBig,alpha,
-						&(transform_(0,0)),nBig,&(fmTmp(0,0)),nBig,beta,
-						&(ret(0,0)),nSmall);
+				transform_.transform(ret,O);
 			}
 
 		private:
@@ -212,7 +202,7 @@ namespace Dmrg {
 			FermionSignType fS_,fE_;
 			LeftRightSuperType lrs_;
 			VectorType wavefunction_;
-			MatrixType transform_;
+			BlockDiagonalMatrixType transform_;
 			size_t direction_;
 	}; // class DmrgSerializer
 } // namespace Dmrg 
@@ -91,6 +91,9 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 #include "Checkpoint.h"
 #include "WaveFunctionTransfFactory.h"
 #include "Truncation.h"
+#include "Threads.h"
+#include "ScratchStorage.h"
+#include "AsyncWriter.h"
 
 namespace Dmrg {
 
@@ -138,10 +141,12 @@ namespace Dmrg {
 		typedef typename TruncationType::TransformType TransformType;
 
 		typedef DmrgSerializer<LeftRightSuperType,VectorWithOffsetType,
-				TransformType> DmrgSerializerType;
+				typename TransformType::BuildingBlockType> DmrgSerializerType;
 		typedef typename ModelType::GeometryType GeometryType;
 		typedef Checkpoint<ParametersType,TargettingType> CheckpointType;
 		typedef typename DmrgSerializerType::FermionSignType FermionSignType;
+		typedef typename IoType::Out IoOutType;
+		typedef AsyncWriter<IoOutType> AsyncWriterType;
 
 		enum {SAVE_TO_DISK=1,DO_NOT_SAVE=0};
 		enum {EXPAND_ENVIRON=WaveFunctionTransfType::EXPAND_ENVIRON,
@@ -161,6 +166,7 @@ namespace Dmrg {
 				useReflection_(false),
 				lrs_("pSprime","pEprime","pSE"),
 				io_(parameters_.filename,concurrency.rank()),
+				writer_(io_,parameters_.options.find("asyncDataFile")!=std::string::npos),
 				ioIn_(parameters_.filename),
 				progress_("DmrgSolver",concurrency.rank()),
 				quantumSector_(0),
@@ -168,31 +174,33 @@ namespace Dmrg {
 				checkpoint_(parameters_,concurrency.rank()),
 				waveFunctionTransformation_(parameters_,model_.hilbertSize()),
 				diagonalization_(parameters,model,concurrency,verbose_,
-					useReflection_,io_,quantumSector_,waveFunctionTransformation_),
+					useReflection_,writer_,quantumSector_,waveFunctionTransformation_),
 				truncate_(lrs_,waveFunctionTransformation_,concurrency_,
 					parameters_,verbose_)
 		{
-			io_.print(parameters_);
-			io_.print(targetStruct_);
+			writer_.print(parameters_);
+			writer_.print(targetStruct_);
 			PsimagLite::HostInfo hostInfo;
 			std::string s =hostInfo.getTimeDate();
-			io_.print(s);
+			writer_.print(s);
 			if (parameters_.options.find("verbose")!=std::string::npos) verbose_=true;
 			if (parameters_.options.find("useReflection")!=std::string::npos)
 				useReflection_=true;
-			ModelType::SharedMemoryType::setThreads(parameters_.nthreads);
+			bool pinThreads = (parameters_.options.find("pinThreads")!=std::string::npos);
+			Threads::setThreads(parameters_.nthreads,pinThreads);
+			ScratchStorage::setDirectory(parameters_.scratchDirectory);
 		}
 
 		~DmrgSolver()
 		{
 			PsimagLite::HostInfo hostInfo;
 			std::string s =hostInfo.getTimeDate();
-			io_.print(s);
+			writer_.print(s);
 		}
 
 		void main(const GeometryType& geometry)
 		{
-			io_.print(geometry);
+			writer_.print(geometry);
 			if (checkpoint_())
 				std::cerr<<"WARNING: Will not check finite loops for consistency while checkpoint is in use\n";
 			 else 
@@ -203,7 +211,7 @@ namespace Dmrg {
 			msg<<"Turning the engine on";
 			progress_.printline(msg,std::cout);
 
-			io_.print(model_);
+			writer_.print(model_);
 			BlockType S,E;
 			std::vector<BlockType> X,Y;
 			geometry.split(S,X,Y,E);
@@ -216,13 +224,15 @@ namespace Dmrg {
 
 			
 			TargettingType psi(lrs_,model_,targetStruct_,waveFunctionTransformation_);
-			io_.print(psi);
+			writer_.print(psi);
 
 			MyBasisWithOperators pS("pS");
 			MyBasisWithOperators pE("pE");
 
 			if (checkpoint_()) {	
 				checkpoint_.load(pS,pE,psi);
+				if (parameters_.options.find("warmStart")!=std::string::npos)
+					rebuildHamiltonians(pS,pE);
 			} else { // move this block elsewhere:
 				std::vector<OperatorType> creationMatrix;
 				SparseMatrixType hmatrix;
@@ -251,6 +261,7 @@ namespace Dmrg {
 		bool verbose_,useReflection_;
 		LeftRightSuperType lrs_;
 		typename IoType::Out io_;
+		AsyncWriterType writer_; // everything for io_ goes through it
 		typename IoType::In ioIn_;
 		PsimagLite::ProgressIndicator progress_;
 		size_t quantumSector_;
@@ -299,6 +310,84 @@ namespace Dmrg {
 			progress_.print("Infinite dmrg loop has been done!\n",std::cout);
 		}
 
+		//! For the option warmStart: the block Hamiltonians of the
+		//! checkpoint are those of the model of the run that wrote it,
+		//! so they are made again with this model. Bases and operators
+		//! do not change, and the stored target is the initial guess
+		void rebuildHamiltonians(MyBasisWithOperators& pS,MyBasisWithOperators& pE)
+		{
+			if (MyBasis::useSu2Symmetry()) throw std::runtime_error(
+					"DmrgSolver::rebuildHamiltonians(...): warmStart is not supported with SU(2)\n");
+			if (!waveFunctionTransformation_.isEnabled()) throw std::runtime_error(
+					"DmrgSolver::rebuildHamiltonians(...): warmStart needs the WFT\n");
+
+			std::ostringstream msg;
+			msg<<"Rebuilding the block Hamiltonians of the checkpoint for this model";
+			progress_.printline(msg,std::cout);
+
+			rebuildHamiltonians(CheckpointType::SYSTEM,EXPAND_SYSTEM);
+			rebuildHamiltonians(CheckpointType::ENVIRON,EXPAND_ENVIRON);
+
+			size_t ns = checkpoint_.stackSize(CheckpointType::SYSTEM);
+			size_t ne = checkpoint_.stackSize(CheckpointType::ENVIRON);
+			// the handles keep the entries alive even if they were read from disk
+			typename CheckpointType::SharedBasisType topS = checkpoint_.stackEntry(CheckpointType::SYSTEM,ns-1);
+			typename CheckpointType::SharedBasisType topE = checkpoint_.stackEntry(CheckpointType::ENVIRON,ne-1);
+			if (topS->block()!=pS.block() || topE->block()!=pE.block()) throw std::runtime_error(
+					"DmrgSolver::rebuildHamiltonians(...): pS or pE is not the top of its stack\n");
+			pS = *topS;
+			pE = *topE;
+		}
+
+		//! Each entry of the stack is grown again, with this model, from the
+		//! entry below it, and changed to its basis with the transform that
+		//! the WFT kept for it, as the truncation did; the bottom entry is
+		//! the natural basis of its block
+		void rebuildHamiltonians(size_t what,size_t direction)
+		{
+			size_t n = checkpoint_.stackSize(what);
+			if (n==0 || waveFunctionTransformation_.transforms(direction)+1!=n)
+				throw std::runtime_error("DmrgSolver::rebuildHamiltonians(...): "
+				                         "the stack and the WFT transforms do not match\n");
+
+			MyBasisWithOperators prev = *checkpoint_.stackEntry(what,0);
+			std::vector<OperatorType> creationMatrix;
+			SparseMatrixType hmatrix;
+			BasisDataType q;
+			model_.setNaturalBasis(creationMatrix,hmatrix,q,prev.block());
+			prev.setHamiltonian(hmatrix);
+			checkpoint_.replaceStackEntry(what,0,prev);
+
+			size_t dir = (direction==EXPAND_SYSTEM) ? LeftRightSuperType::GROW_TO_THE_RIGHT
+			                                        : LeftRightSuperType::GROW_TO_THE_LEFT;
+			for (size_t i=1;i<n;i++) {
+				MyBasisWithOperators b = *checkpoint_.stackEntry(what,i);
+				const BlockType& block = b.block();
+				size_t added = (block.size()>prev.block().size()) ? block.size()-prev.block().size() : 0;
+				BlockType X(block.begin(),block.begin()+added);
+				BlockType rest(block.begin()+added,block.end());
+				if (direction==EXPAND_SYSTEM) {
+					X = BlockType(block.end()-added,block.end());
+					rest = BlockType(block.begin(),block.end()-added);
+				}
+				if (added==0 || rest!=prev.block()) throw std::runtime_error(
+						"DmrgSolver::rebuildHamiltonians(...): stack entries do not grow by sites\n");
+
+				MyBasisWithOperators grown("grown");
+				lrs_.grow(grown,model_,prev,X,dir);
+				const TransformType& t = waveFunctionTransformation_.transform(direction,i-1);
+				if (t.n_row()!=grown.size() || t.n_col()!=b.size()) throw std::runtime_error(
+						"DmrgSolver::rebuildHamiltonians(...): transform does not fit the stack entry\n");
+
+				PsimagLite::Matrix<typename SparseMatrixType::value_type> tmp;
+				t.transform(tmp,grown.hamiltonian());
+				fullMatrixToCrsMatrix(hmatrix,tmp);
+				b.setHamiltonian(hmatrix);
+				checkpoint_.replaceStackEntry(what,i,b);
+				prev = b;
+			}
+		}
+
 		void finiteDmrgLoops(
 					BlockType const &S,
      					BlockType const &E,
@@ -330,25 +419,49 @@ namespace Dmrg {
 			int sc = PsimagLite::isInVector(sitesIndices_,siteToAdd);
 			if (sc<0) throw std::runtime_error("finiteDmrgLoops(...): internal error: siteIndices_\n");
 			stepCurrent_ = sc; // phew!!, that's all folks, now bugs, go away!!
+
+			// or continue where an incremental checkpoint was taken
+			size_t firstLoop = 0;
+			int stepFinal = 0;
+			if (checkpoint_.resuming()) {
+				const CheckpointManifest& m = checkpoint_.resumePoint();
+				if (m.loop>=parameters_.finiteLoop.size())
+					throw std::runtime_error("finiteDmrgLoops(...): checkpoint is past the finite loops\n");
+				firstLoop = m.loop;
+				stepCurrent_ = m.stepCurrent;
+				stepFinal = m.stepFinal;
+			}
 			
-			for (size_t i=0;i<parameters_.finiteLoop.size();i++)  {
+			for (size_t i=firstLoop;i<parameters_.finiteLoop.size();i++)  {
 				std::ostringstream msg;
 				msg<<"Finite loop number "<<i;
 				msg<<" with l="<<parameters_.finiteLoop[i].stepLength;
 				msg<<" keptStates="<<parameters_.finiteLoop[i].keptStates;
 				progress_.printline(msg,std::cout);
-				
-				if (i>0) {
-					int sign = parameters_.finiteLoop[i].stepLength*parameters_.finiteLoop[i-1].stepLength;
-					if (sign>0) {
-						if (parameters_.finiteLoop[i].stepLength>0) stepCurrent_++;
-						if (parameters_.finiteLoop[i].stepLength<0) stepCurrent_--;
+
+				// kept checkpoints mark the start of every loop, so that
+				// a later run can continue from any of them with new loops
+				bool resumedHere = (i==firstLoop && checkpoint_.resuming());
+				if (checkpoint_.keeping() && !resumedHere)
+					checkpoint_.saveIncremental(i,stepCurrent_,0,sitesIndices_[stepCurrent_],
+					                            psi,waveFunctionTransformation_,true);
+
+				if (!resumedHere || checkpoint_.resumePoint().atLoopStart) {
+					if (i>0) {
+						int sign = parameters_.finiteLoop[i].stepLength*parameters_.finiteLoop[i-1].stepLength;
+						if (sign>0) {
+							if (parameters_.finiteLoop[i].stepLength>0) stepCurrent_++;
+							if (parameters_.finiteLoop[i].stepLength<0) stepCurrent_--;
+						}
 					}
+					stepFinal = stepCurrent_+parameters_.finiteLoop[i].stepLength;
 				}
-				finiteStep(S,E,pS,pE,i,psi);
+				finiteStep(S,E,pS,pE,i,stepFinal,psi);
 			}
+			writer_.flush();
 			checkpoint_.save(pS,pE,io_);
 			psi.save(sitesIndices_[stepCurrent_],io_);
+			checkpoint_.removeIncremental();
 		}
 
 		void finiteStep(
@@ -357,6 +470,7 @@ namespace Dmrg {
 				MyBasisWithOperators &pS,
 				MyBasisWithOperators &pE,
 				size_t loopIndex,
+				int stepFinal,
     				TargettingType& target)
 		{
 			int stepLength = parameters_.finiteLoop[loopIndex].stepLength;
@@ -369,7 +483,6 @@ namespace Dmrg {
 
 			waveFunctionTransformation_.setStage(direction);
 
-			int stepFinal = stepCurrent_+stepLength;
 			
 			while(true) {
 				
@@ -395,6 +508,9 @@ namespace Dmrg {
 				updateQuantumSector(lrs_.sites());
 				
 				lrs_.setToProduct(quantumSector_);
+
+				// the next step shrinks the same stack, read it while we diagonalize
+				checkpoint_.prefetch((direction==EXPAND_SYSTEM) ? CheckpointType::ENVIRON : CheckpointType::SYSTEM);
 				
 				bool needsPrinting = (saveOption==SAVE_TO_DISK);
 				gsEnergy =diagonalization_(target,direction,sitesIndices_[stepCurrent_],loopIndex,needsPrinting);
@@ -403,6 +519,10 @@ namespace Dmrg {
 				
 				if (finalStep(stepLength,stepFinal)) break;
 				if (stepCurrent_<0) throw std::runtime_error("DmrgSolver::finiteStep() currentStep_ is negative\n");
+
+				if (checkpoint_.incrementalDue())
+					checkpoint_.saveIncremental(loopIndex,stepCurrent_,stepFinal,
+					                            sitesIndices_[stepCurrent_],target,waveFunctionTransformation_);
 				
 			}
 			if (direction==EXPAND_SYSTEM) {
@@ -413,7 +533,7 @@ namespace Dmrg {
 			}
 			if (saveOption==SAVE_TO_DISK) {
 				std::string s="#WAVEFUNCTION_ENERGY="+ttos(gsEnergy);
-				io_.printline(s);
+				writer_.printline(s);
 			}
 		}
 
@@ -429,7 +549,7 @@ namespace Dmrg {
 			truncate_(pS,pE,target,keptStates,direction);
 			std::ostringstream msg2;
 			msg2<<"#Error="<<truncate_.error();
-			io_.printline(msg2);
+			writer_.printline(msg2);
 			
 			if (direction==EXPAND_SYSTEM) {
 				checkpoint_.push(pS,CheckpointType::SYSTEM);
@@ -447,12 +567,57 @@ namespace Dmrg {
 				const TransformType& transform,
 				size_t direction)
 		{
-			DmrgSerializerType ds(fsS,fsE,lrs_,target.gs(),transform,direction);
-			ds.save(io_);
+			if (!writer_.async()) {
+				DmrgSerializerType ds(fsS,fsE,lrs_,target.gs(),transform,direction);
+				ds.save(io_);
 
-			target.save(sitesIndices_[stepCurrent_],io_);
+				target.save(sitesIndices_[stepCurrent_],io_);
+				return;
+			}
+			// the record is written in the writer's thread, but the target
+			// cannot be copied, so it is formatted now
+			writer_.push(new SerializerJob(fsS,fsE,lrs_,target.gs(),transform,direction));
+			std::ostringstream os;
+			IoOutType memIo(os);
+			target.save(sitesIndices_[stepCurrent_],memIo);
+			writer_.write(os.str());
 		}
 
+		//! A DmrgSerializer record that shares the bases of lrs through
+		//! handles: lrs grows new bases afterwards instead of changing
+		//! these, see LeftRightSuper::leftHandle() and AsyncWriter
+		class SerializerJob : public AsyncWriterType::Job {
+		public:
+			template<typename SomeVectorType>
+			SerializerJob(const FermionSignType& fsS,
+			              const FermionSignType& fsE,
+			              LeftRightSuperType& lrs,
+			              const SomeVectorType& gs,
+			              const TransformType& transform,
+			              size_t direction)
+			: left_(lrs.leftHandle()),
+			  right_(lrs.rightHandle()),
+			  super_(lrs.superHandle()),
+			  lrs_(const_cast<MyBasisWithOperators&>(*left_),
+			       const_cast<MyBasisWithOperators&>(*right_),
+			       const_cast<MyBasis&>(*super_)),
+			  ds_(fsS,fsE,lrs_,gs,transform,direction)
+			{
+				// the writer thread only reads them then
+				left_->materialiseOperators();
+				right_->materialiseOperators();
+			}
+
+			void write(IoOutType& io) { ds_.save(io); }
+
+		private:
+			typename LeftRightSuperType::SharedBasisType left_;
+			typename LeftRightSuperType::SharedBasisType right_;
+			typename LeftRightSuperType::SharedSuperType super_;
+			LeftRightSuperType lrs_;
+			DmrgSerializerType ds_;
+		}; // class SerializerJob
+
 		bool finalStep(int stepLength,int stepFinal)
 		{
 			if (stepLength<0) {
@@ -81,6 +81,7 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 #ifndef DMRG_WAVE_H
 #define DMRG_WAVE_H
 
+#include "BlockDiagonalMatrix.h"
 
 namespace Dmrg {
 	
@@ -94,8 +95,10 @@ struct DmrgWaveStruct {
 	typedef typename SparseMatrixType::value_type SparseElementType;
 	typedef typename BasisWithOperatorsType::BasisType BasisType;
 
-	PsimagLite::Matrix<SparseElementType> ws;
-	PsimagLite::Matrix<SparseElementType> we;
+	typedef BlockDiagonalMatrix<PsimagLite::Matrix<SparseElementType> > TransformType;
+
+	TransformType ws;
+	TransformType we;
 	LeftRightSuperType lrs;
 
 	DmrgWaveStruct() : lrs("pSE","pSprime","pEprime") { }
@@ -103,16 +106,16 @@ struct DmrgWaveStruct {
 	template<typename IoInputType>
 	void load(IoInputType& io)
 	{
-		io.readMatrix(ws,"Ws");
-		io.readMatrix(we,"We");
+		ws.load(io,"Ws");
+		we.load(io,"We");
 		lrs.load(io);
 	}
 
 	template<typename IoOutputType>
 	void save(IoOutputType& io) const
 	{
-		io.printMatrix(ws,"Ws");
-		io.printMatrix(we,"We");
+		ws.save(io,"Ws");
+		we.save(io,"We");
 		lrs.save(io);
 	}
 
@@ -128,6 +128,7 @@ namespace Dmrg {
 		typedef WaveFunctionTransfTemplate<LeftRightSuperType,VectorWithOffsetType> WaveFunctionTransfType;
 		typedef typename LanczosSolverType::TridiagonalMatrixType TridiagonalMatrixType;
 		typedef typename LanczosSolverType::DenseMatrixType DenseMatrixType;
+		typedef typename LanczosSolverType::LanczosVectorsType LanczosVectorsType;
 		typedef PsimagLite::ContinuedFraction<RealType,TridiagonalMatrixType>
 			ContinuedFractionType;
 		typedef DynamicSerializer<RealType,VectorWithOffsetType,
@@ -457,7 +458,7 @@ namespace Dmrg {
 				VectorType sv;
 				size_t i0 = phi.sector(i);
 				phi.extract(sv,i0);
-				DenseMatrixType V;
+				LanczosVectorsType V;
 				size_t p = lrs_.super().findPartitionNumber(phi.offset(i0));
 				getLanczosVectors(V,sv,p);
 				if (i==0) {
@@ -473,7 +474,7 @@ namespace Dmrg {
 		}
 
 		void getLanczosVectors(
-				DenseMatrixType& V,
+				LanczosVectorsType& V,
 				const VectorType& sv,
 				size_t p)
 		{
@@ -494,7 +495,7 @@ namespace Dmrg {
 		}
 
 		void setLanczosVectors(
-				const DenseMatrixType& V,
+				const LanczosVectorsType& V,
 				size_t i0)
 		{
 			for (size_t i=0;i<targetVectors_.size();i++) {
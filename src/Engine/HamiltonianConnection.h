@@ -81,7 +81,9 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 #ifndef HAMILTONIAN_CONNECTION_H
 #define HAMILTONIAN_CONNECTION_H
 
+#include <algorithm>
 #include "LinkProductStruct.h"
+#include "Threads.h"
 
 namespace Dmrg {
 	
@@ -101,7 +103,8 @@ namespace Dmrg {
 				const LinkProductStructType* lps = 0,
 				std::vector<SparseElementType>* x = 0,
 				const std::vector<SparseElementType>* y = 0)
-			: lps_(*lps),x_(*x),y_(*y),geometry_(geometry),modelHelper_(modelHelper),
+			: lps_(*lps),x_(*x),y_(*y),xthread_(Threads::threads()),
+				geometry_(geometry),modelHelper_(modelHelper),
 				systemBlock_(modelHelper.leftRightSuper().left().block()),
 				envBlock_(modelHelper.leftRightSuper().right().block()),
 				smax_(*std::max_element(systemBlock_.begin(),systemBlock_.end())),
@@ -153,10 +156,13 @@ namespace Dmrg {
 				return flag;
 			}
 			
-			void thread_function_(size_t threadNum,size_t blockSize,pthread_mutex_t* myMutex)
+			//! Each thread but the calling one sums into its own copy
+			//! of x, see sumThreads
+			void thread_function_(size_t threadNum,size_t blockSize,pthread_mutex_t*)
 			{
-				std::vector<SparseElementType> xtemp(x_.size(),0);
-				//for (size_t i=0;i<xtemp.size();i++) xtemp[i]=0;
+				size_t thread = Threads::thread();
+				std::vector<SparseElementType>& xtemp = (thread==0) ? x_ : xthread_[thread];
+				if (xtemp.size()!=x_.size()) xtemp.resize(x_.size(),0);
 				for (size_t p=0;p<blockSize;p++) {
 					size_t ix = threadNum * blockSize + p;
 					if (ix>=lps_.isaved.size()) break;
@@ -171,13 +177,96 @@ namespace Dmrg {
 					linkProduct(xtemp,y_,i,j,type,tmp,term,dofs);
 					
 				}
-				if (myMutex) pthread_mutex_lock( myMutex);
-				for (size_t i=0;i<x_.size();i++) x_[i]+=xtemp[i];
-				if (myMutex) pthread_mutex_unlock( myMutex );
 			}
 
-			
+			//! Adds the copies of x of the threads to x, after the loop
+			void sumThreads()
+			{
+				ThreadSum threadSum(x_,xthread_);
+				Threads::loopCreate(x_.size(),threadSum);
+			}
+
+			//! Appends to cols the columns that the ix-th link of lps needs
+			//! (see ModelHelperLocal::fastOpProdInterColumns)
+			void linkColumns(std::vector<size_t>& cols,size_t ix) const
+			{
+				const SparseMatrixType* A = 0;
+				const SparseMatrixType* B = 0;
+				LinkType link = linkOperators(&A,&B,ix);
+				modelHelper_.fastOpProdInterColumns(cols,*A,*B,link);
+			}
+
+			//! Makes the operators of the ix-th link of lps explicit (and
+			//! transposed if needed), so that afterwards threads only read them
+			void prepareOperators(size_t ix) const
+			{
+				const SparseMatrixType* A = 0;
+				const SparseMatrixType* B = 0;
+				linkOperators(&A,&B,ix);
+			}
+
 		private:
+
+			//! The link ix of lps and its operators A and B, without the
+			//! value modifier
+			LinkType linkOperators(const SparseMatrixType** A,
+			                       const SparseMatrixType** B,
+			                       size_t ix) const
+			{
+				size_t i=lps_.isaved[ix];
+				size_t j=lps_.jsaved[ix];
+				size_t type=lps_.typesaved[ix];
+				size_t term = lps_.termsaved[ix];
+				size_t dofs = lps_.dofssaved[ix];
+				int offset =modelHelper_.leftRightSuper().left().block().size();
+				std::pair<size_t,size_t> ops;
+				std::pair<char,char> mods('N','C');
+				size_t fermionOrBoson=ProgramGlobals::FERMION,angularMomentum=0,category=0;
+				RealType angularFactor=0;
+				bool isSu2 = modelHelper_.isSu2();
+				LinkProductType::setLinkData(term,dofs,isSu2,
+						fermionOrBoson,ops,mods,angularMomentum,angularFactor,category);
+				LinkType link(i,j,type,lps_.tmpsaved[ix],dofs,
+					      fermionOrBoson,ops,mods,angularMomentum,angularFactor,category);
+				if (type==ProgramGlobals::SYSTEM_ENVIRON) {
+					*A = &modelHelper_.getReducedOperator(mods.first,i,
+							link.ops.first,ModelHelperType::System);
+					*B = &modelHelper_.getReducedOperator(mods.second,j-offset,
+							link.ops.second,ModelHelperType::Environ);
+				} else {
+					*A = &modelHelper_.getReducedOperator(mods.first,i-offset,
+							link.ops.first,ModelHelperType::Environ);
+					*B = &modelHelper_.getReducedOperator(mods.second,j,
+							link.ops.second,ModelHelperType::System);
+				}
+				return link;
+			}
+
+			// Adds the copies of x of all threads to x, each chunk
+			// of rows can be done by a different thread
+			class ThreadSum {
+			public:
+				ThreadSum(std::vector<SparseElementType>& x,
+				          const std::vector<std::vector<SparseElementType> >& xthread)
+				: x_(x),xthread_(xthread)
+				{}
+
+				void thread_function_(size_t threadNum,size_t blockSize,pthread_mutex_t*)
+				{
+					size_t start = threadNum*blockSize;
+					size_t end = std::min(start+blockSize,x_.size());
+					for (size_t t=0;t<xthread_.size();t++) {
+						const std::vector<SparseElementType>& xtemp = xthread_[t];
+						if (xtemp.size()==0) continue;
+						for (size_t i=start;i<end;i++) x_[i] += xtemp[i];
+					}
+				}
+
+			private:
+				std::vector<SparseElementType>& x_;
+				const std::vector<std::vector<SparseElementType> >& xthread_;
+			}; // class ThreadSum
+
 			//! Adds a connector between system and environment
 			size_t calcBond(
 				SparseMatrixType &matrixBlock,
@@ -270,6 +359,7 @@ namespace Dmrg {
 			const LinkProductStructType& lps_;
 			std::vector<SparseElementType>& x_;
 			const std::vector<SparseElementType>& y_;
+			std::vector<std::vector<SparseElementType> > xthread_;
 			const GeometryType& geometry_;
 			const ModelHelperType& modelHelper_;
 			const typename GeometryType::BlockType& systemBlock_;
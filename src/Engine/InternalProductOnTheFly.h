@@ -104,6 +104,10 @@ namespace Dmrg {
 		}
 
 		size_t rank() const { return modelHelper_->size(); }
+
+		size_t globalRank() const { return rank(); }
+
+		RealType reduce(const RealType& partial) const { return partial; }
 		
 		template<typename SomeVectorType>
 		void matrixVectorProduct(SomeVectorType &x,SomeVectorType const &y) const
@@ -109,6 +109,10 @@ namespace Dmrg {
 
 		size_t rank() const { return matrixStored_.rank(); }
 
+		size_t globalRank() const { return rank(); }
+
+		RealType reduce(const RealType& partial) const { return partial; }
+
 		template<typename SomeVectorType>
 		void matrixVectorProduct(SomeVectorType &x, SomeVectorType const &y) const
 		{
@@ -0,0 +1,836 @@
+// BEGIN LICENSE BLOCK
+/*
+Copyright (c) 2009, UT-Battelle, LLC
+All rights reserved
+
+[DMRG++, Version 2.0.0]
+[by G.A., Oak Ridge National Laboratory]
+
+UT Battelle Open Source Software License 11242008
+
+OPEN SOURCE LICENSE
+
+Subject to the conditions of this License, each
+contributor to this software hereby grants, free of
+charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"), a
+perpetual, worldwide, non-exclusive, no-charge,
+royalty-free, irrevocable copyright license to use, copy,
+modify, merge, publish, distribute, and/or sublicense
+copies of the Software.
+
+1. Redistributions of Software must retain the above
+copyright and license notices, this list of conditions,
+and the following disclaimer.  Changes or modifications
+to, or derivative works of, the Software should be noted
+with comments and the contributor and organization's
+name.
+
+2. Neither the names of UT-Battelle, LLC or the
+Department of Energy nor the names of the Software
+contributors may be used to endorse or promote products
+derived from this software without specific prior written
+permission of UT-Battelle.
+
+3. The software and the end-user documentation included
+with the redistribution, with or without modification,
+must include the following acknowledgment:
+
+"This product includes software produced by UT-Battelle,
+LLC under Contract No. DE-AC05-00OR22725  with the
+Department of Energy."
+ 
+*********************************************************
+DISCLAIMER
+
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT OWNER, CONTRIBUTORS, UNITED STATES GOVERNMENT,
+OR THE UNITED STATES DEPARTMENT OF ENERGY BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+
+NEITHER THE UNITED STATES GOVERNMENT, NOR THE UNITED
+STATES DEPARTMENT OF ENERGY, NOR THE COPYRIGHT OWNER, NOR
+ANY OF THEIR EMPLOYEES, REPRESENTS THAT THE USE OF ANY
+INFORMATION, DATA, APPARATUS, PRODUCT, OR PROCESS
+DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
+
+*********************************************************
+
+
+*/
+// END LICENSE BLOCK
+/** \ingroup DMRG */
+/*@{*/
+
+/*! \file IoBinary.h
+ *
+ *  Writes and reads the data file, the checkpoints and the stacks
+ *  in binary, with the interface of IoSimple (in PsimagLite), so that
+ *  either can be the IoType of DmrgSolver; configure.pl asks which.
+ *  A file is a header (a magic string, the version of the format,
+ *  and the byte order and integer size of the machine that wrote it)
+ *  followed by records, each [kind][label size][label][payload size][payload].
+ *  A line is a record with its text as label and no payload; a vector
+ *  or a matrix has its label, and in its payload the type and size of
+ *  each array before the array, so that arrays of numbers are written
+ *  and read in bulk. Records are found by the prefix of their label,
+ *  as IoSimple finds them, skipping the payload of the others.
+ *  IoBinary::In reads text files written by IoSimple too.
+ *  With CompressedFile::enable(true), Out writes through a CompressedFile;
+ *  In reads either kind of file.
+ */
+#ifndef IO_BINARY_H
+#define IO_BINARY_H
+
+#include <string>
+#include <vector>
+#include <complex>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+#include "IoSimple.h" // in PsimagLite
+#include "CrsMatrix.h" // in PsimagLite
+#include "Matrix.h" // in PsimagLite
+#include "Operator.h"
+#include "CompressedFile.h"
+
+namespace Dmrg {
+
+	//! How elements of a vector are written: one by one if CODE is 0,
+	//! else all at once, SIZE bytes each
+	template<typename T>
+	struct IoBinaryType { enum {CODE = 0}; };
+
+	template<>
+	struct IoBinaryType<int> { enum {CODE = 1, SIZE = sizeof(int)}; };
+
+	template<>
+	struct IoBinaryType<long> { enum {CODE = 1, SIZE = sizeof(long)}; };
+
+	template<>
+	struct IoBinaryType<unsigned int> { enum {CODE = 2, SIZE = sizeof(unsigned int)}; };
+
+	template<>
+	struct IoBinaryType<unsigned long> { enum {CODE = 2, SIZE = sizeof(unsigned long)}; };
+
+	template<>
+	struct IoBinaryType<float> { enum {CODE = 3, SIZE = sizeof(float)}; };
+
+	template<>
+	struct IoBinaryType<double> { enum {CODE = 3, SIZE = sizeof(double)}; };
+
+	template<>
+	struct IoBinaryType<std::complex<float> > { enum {CODE = 4, SIZE = sizeof(std::complex<float>)}; };
+
+	template<>
+	struct IoBinaryType<std::complex<double> > { enum {CODE = 4, SIZE = sizeof(std::complex<double>)}; };
+
+	//! Only in a vector, where it is packed, see binaryWrite
+	template<>
+	struct IoBinaryType<bool> { enum {CODE = 5}; };
+
+	//! The size of the numbers that make most of the payload,
+	//! for the shuffle of CompressedFile
+	template<typename T>
+	struct IoBinaryStride { enum {SIZE = 1}; };
+
+	template<>
+	struct IoBinaryStride<int> { enum {SIZE = sizeof(int)}; };
+
+	template<>
+	struct IoBinaryStride<unsigned long> { enum {SIZE = sizeof(unsigned long)}; };
+
+	template<>
+	struct IoBinaryStride<float> { enum {SIZE = sizeof(float)}; };
+
+	template<>
+	struct IoBinaryStride<double> { enum {SIZE = sizeof(double)}; };
+
+	template<typename T>
+	struct IoBinaryStride<std::complex<T> > { enum {SIZE = IoBinaryStride<T>::SIZE}; };
+
+	template<typename T>
+	struct IoBinaryStride<std::vector<T> > { enum {SIZE = IoBinaryStride<T>::SIZE}; };
+
+	template<typename T>
+	struct IoBinaryStride<PsimagLite::CrsMatrix<T> > { enum {SIZE = IoBinaryStride<T>::SIZE}; };
+
+	template<typename T>
+	struct IoBinaryStride<PsimagLite::Matrix<T> > { enum {SIZE = IoBinaryStride<T>::SIZE}; };
+
+	template<typename RealType,typename SparseMatrixType>
+	struct IoBinaryStride<Operator<RealType,SparseMatrixType> > {
+		enum {SIZE = IoBinaryStride<SparseMatrixType>::SIZE};
+	};
+
+	// numbers only: other types have no SIZE
+	template<typename T>
+	void binaryWrite(std::ostream& os,const T& x)
+	{
+		os.write(reinterpret_cast<const char*>(&x),IoBinaryType<T>::SIZE);
+	}
+
+	template<typename T>
+	void binaryRead(std::istream& is,T& x)
+	{
+		is.read(reinterpret_cast<char*>(&x),IoBinaryType<T>::SIZE);
+	}
+
+	template<typename T1,typename T2>
+	void binaryWrite(std::ostream& os,const std::pair<T1,T2>& x);
+
+	template<typename T1,typename T2>
+	void binaryRead(std::istream& is,std::pair<T1,T2>& x);
+
+	template<typename T>
+	void binaryWrite(std::ostream& os,const std::vector<T>& v);
+
+	template<typename T>
+	void binaryRead(std::istream& is,std::vector<T>& v);
+
+	inline void binaryWrite(std::ostream& os,const std::vector<bool>& v);
+
+	inline void binaryRead(std::istream& is,std::vector<bool>& v);
+
+	template<typename T>
+	void binaryWrite(std::ostream& os,const PsimagLite::CrsMatrix<T>& m);
+
+	template<typename T>
+	void binaryRead(std::istream& is,PsimagLite::CrsMatrix<T>& m);
+
+	template<typename T>
+	void binaryWrite(std::ostream& os,const PsimagLite::Matrix<T>& m);
+
+	template<typename T>
+	void binaryRead(std::istream& is,PsimagLite::Matrix<T>& m);
+
+	template<typename RealType,typename SparseMatrixType>
+	void binaryWrite(std::ostream& os,const Operator<RealType,SparseMatrixType>& op);
+
+	template<typename RealType,typename SparseMatrixType>
+	void binaryRead(std::istream& is,Operator<RealType,SparseMatrixType>& op);
+
+	template<typename T1,typename T2>
+	void binaryWrite(std::ostream& os,const std::pair<T1,T2>& x)
+	{
+		binaryWrite(os,x.first);
+		binaryWrite(os,x.second);
+	}
+
+	template<typename T1,typename T2>
+	void binaryRead(std::istream& is,std::pair<T1,T2>& x)
+	{
+		binaryRead(is,x.first);
+		binaryRead(is,x.second);
+	}
+
+	//! The element type, the element size and the number of elements,
+	//! then the elements
+	template<typename T>
+	void binaryWrite(std::ostream& os,const std::vector<T>& v)
+	{
+		size_t code = IoBinaryType<T>::CODE;
+		size_t bytes = (code>0) ? sizeof(T) : 0;
+		binaryWrite(os,code);
+		binaryWrite(os,bytes);
+		binaryWrite(os,v.size());
+		if (v.size()==0) return;
+		if (code>0) {
+			os.write(reinterpret_cast<const char*>(&v[0]),bytes*v.size());
+			return;
+		}
+		for (size_t i=0;i<v.size();i++) binaryWrite(os,v[i]);
+	}
+
+	template<typename T>
+	void binaryRead(std::istream& is,std::vector<T>& v)
+	{
+		size_t code = 0, bytes = 0, n = 0;
+		binaryRead(is,code);
+		binaryRead(is,bytes);
+		binaryRead(is,n);
+		if (!is) throw std::runtime_error("binaryRead(...): vector: truncated\n");
+		if (code!=size_t(IoBinaryType<T>::CODE) || (code>0 && bytes!=sizeof(T)))
+			throw std::runtime_error("binaryRead(...): vector of another type\n");
+		v.resize(n);
+		if (n==0) return;
+		if (code>0) {
+			is.read(reinterpret_cast<char*>(&v[0]),bytes*n);
+			return;
+		}
+		for (size_t i=0;i<n;i++) binaryRead(is,v[i]);
+	}
+
+	//! A vector<bool> has no element to take the address of: its
+	//! elements are packed 8 to a byte, the first in the lowest bit
+	inline void binaryWrite(std::ostream& os,const std::vector<bool>& v)
+	{
+		size_t code = IoBinaryType<bool>::CODE;
+		size_t bytes = 1;
+		binaryWrite(os,code);
+		binaryWrite(os,bytes);
+		binaryWrite(os,v.size());
+		std::vector<unsigned char> packed((v.size()+7)/8,0);
+		for (size_t i=0;i<v.size();i++)
+			if (v[i]) packed[i/8] |= (1<<(i%8));
+		if (packed.size()>0)
+			os.write(reinterpret_cast<const char*>(&packed[0]),packed.size());
+	}
+
+	inline void binaryRead(std::istream& is,std::vector<bool>& v)
+	{
+		size_t code = 0, bytes = 0, n = 0;
+		binaryRead(is,code);
+		binaryRead(is,bytes);
+		binaryRead(is,n);
+		if (!is) throw std::runtime_error("binaryRead(...): vector: truncated\n");
+		if (code!=size_t(IoBinaryType<bool>::CODE) || bytes!=1)
+			throw std::runtime_error("binaryRead(...): vector of another type\n");
+		std::vector<unsigned char> packed((n+7)/8);
+		if (packed.size()>0)
+			is.read(reinterpret_cast<char*>(&packed[0]),packed.size());
+		if (!is) throw std::runtime_error("binaryRead(...): vector: truncated\n");
+		v.resize(n);
+		for (size_t i=0;i<n;i++) v[i] = ((packed[i/8]>>(i%8)) & 1);
+	}
+
+	//! The rank, then the three arrays of the compressed row storage
+	template<typename T>
+	void binaryWrite(std::ostream& os,const PsimagLite::CrsMatrix<T>& m)
+	{
+		size_t n = m.rank();
+		binaryWrite(os,n);
+		if (n==0) return;
+		std::vector<int> rowptr(n+1);
+		for (size_t i=0;i<=n;i++) rowptr[i] = m.getRowPtr(i);
+		std::vector<int> cols(rowptr[n]);
+		std::vector<T> values(rowptr[n]);
+		for (size_t k=0;k<cols.size();k++) {
+			cols[k] = m.getCol(k);
+			values[k] = m.getValue(k);
+		}
+		binaryWrite(os,rowptr);
+		binaryWrite(os,cols);
+		binaryWrite(os,values);
+	}
+
+	template<typename T>
+	void binaryRead(std::istream& is,PsimagLite::CrsMatrix<T>& m)
+	{
+		size_t n = 0;
+		binaryRead(is,n);
+		m.resize(n);
+		if (n==0) return;
+		std::vector<int> rowptr,cols;
+		std::vector<T> values;
+		binaryRead(is,rowptr);
+		binaryRead(is,cols);
+		binaryRead(is,values);
+		if (rowptr.size()!=n+1 || rowptr[0]!=0 || size_t(rowptr[n])!=cols.size()
+		    || values.size()!=cols.size())
+			throw std::runtime_error("binaryRead(...): CrsMatrix: wrong sizes\n");
+		for (size_t i=0;i<n;i++) {
+			m.setRow(i,rowptr[i]);
+			for (int k=rowptr[i];k<rowptr[i+1];k++) {
+				m.pushCol(cols[k]);
+				m.pushValue(values[k]);
+			}
+		}
+		m.setRow(n,rowptr[n]);
+	}
+
+	//! The rows and columns, then the elements row by row
+	template<typename T>
+	void binaryWrite(std::ostream& os,const PsimagLite::Matrix<T>& m)
+	{
+		size_t rows = m.n_row();
+		size_t cols = m.n_col();
+		std::vector<T> values(rows*cols);
+		for (size_t i=0;i<rows;i++)
+			for (size_t j=0;j<cols;j++)
+				values[i*cols+j] = m(i,j);
+		binaryWrite(os,rows);
+		binaryWrite(os,cols);
+		binaryWrite(os,values);
+	}
+
+	template<typename T>
+	void binaryRead(std::istream& is,PsimagLite::Matrix<T>& m)
+	{
+		size_t rows = 0, cols = 0;
+		std::vector<T> values;
+		binaryRead(is,rows);
+		binaryRead(is,cols);
+		binaryRead(is,values);
+		if (values.size()!=rows*cols)
+			throw std::runtime_error("binaryRead(...): Matrix: wrong sizes\n");
+		m.resize(rows,cols);
+		for (size_t i=0;i<rows;i++)
+			for (size_t j=0;j<cols;j++)
+				m(i,j) = values[i*cols+j];
+	}
+
+	//! The same fields as operator<<(std::ostream&,const Operator&)
+	template<typename RealType,typename SparseMatrixType>
+	void binaryWrite(std::ostream& os,const Operator<RealType,SparseMatrixType>& op)
+	{
+		binaryWrite(os,op.data);
+		binaryWrite(os,op.fermionSign);
+		binaryWrite(os,op.jm);
+		binaryWrite(os,op.angularFactor);
+		binaryWrite(os,op.su2Related.offset);
+	}
+
+	template<typename RealType,typename SparseMatrixType>
+	void binaryRead(std::istream& is,Operator<RealType,SparseMatrixType>& op)
+	{
+		binaryRead(is,op.data);
+		binaryRead(is,op.fermionSign);
+		binaryRead(is,op.jm);
+		binaryRead(is,op.angularFactor);
+		binaryRead(is,op.su2Related.offset);
+	}
+
+	class IoBinary {
+
+		enum {VERSION = 1};
+
+		enum {LINE = 1, VECTOR = 2, MATRIX = 4, ANY = 7};
+
+		typedef unsigned int Uint32Type;
+
+		//! counts what is written to it, for the payload size
+		class Counter : public std::streambuf {
+		public:
+			Counter() : n_(0) {}
+
+			size_t size() const { return n_; }
+
+		protected:
+			int overflow(int c)
+			{
+				n_++;
+				return c;
+			}
+
+			std::streamsize xsputn(const char*,std::streamsize n)
+			{
+				n_ += n;
+				return n;
+			}
+
+		private:
+			size_t n_;
+		}; // class Counter
+
+		static const std::string& magic()
+		{
+			static const std::string m("DMRGPPIO");
+			return m;
+		}
+
+		static void writeHeader(std::ostream& os)
+		{
+			os.write(magic().data(),magic().size());
+			Uint32Type x[3] = {VERSION,0x01020304,sizeof(size_t)};
+			os.write(reinterpret_cast<const char*>(x),sizeof(x));
+		}
+
+	public:
+
+		class Out {
+		public:
+			Out() : rank_(0),zout_(&zbuf_),os_(0) {}
+
+			//! Records only, without the file header, see AsyncWriter
+			Out(std::ostream& os) : rank_(0),zout_(&zbuf_),os_(&os) {}
+
+			Out(const std::string& fn,size_t rank) : rank_(rank),zout_(&zbuf_),os_(0)
+			{
+				open(fn,std::ios_base::trunc,rank);
+			}
+
+			void open(const std::string& fn,std::ios_base::openmode mode,size_t rank)
+			{
+				close();
+				rank_ = rank;
+				if (rank_>0) return;
+				if (CompressedFile::enabled()) {
+					bool empty = zbuf_.open(fn,(mode & std::ios_base::app)!=0);
+					zout_.clear();
+					os_ = &zout_;
+					if (empty) writeHeader(zout_);
+					return;
+				}
+				bool empty = true;
+				if (mode & std::ios_base::app) {
+					std::ifstream fin(fn.c_str(),std::ios::binary | std::ios::ate);
+					empty = (!fin || fin.tellg()<=0);
+				}
+				fout_.open(fn.c_str(),std::ios_base::out | std::ios_base::binary | mode);
+				if (!fout_ || !fout_.good())
+					throw std::runtime_error("IoBinary::Out::open(...): cannot open " + fn + "\n");
+				os_ = &fout_;
+				if (empty) writeHeader(fout_);
+			}
+
+			void close()
+			{
+				if (os_==&zout_) {
+					zbuf_.close();
+					os_ = 0;
+				}
+				if (!fout_.is_open()) return;
+				fout_.close();
+				os_ = 0;
+			}
+
+			void printline(const std::string& s)
+			{
+				writeLines(s);
+			}
+
+			void printline(std::ostringstream& s)
+			{
+				writeLines(s.str());
+			}
+
+			template<typename T>
+			void print(const T& x)
+			{
+				if (rank_>0) return;
+				std::ostringstream os;
+				os<<x;
+				writeLines(os.str());
+			}
+
+			template<typename T>
+			void printVector(const std::vector<T>& v,const std::string& label)
+			{
+				writeRecord(VECTOR,label,v);
+			}
+
+			template<typename MatrixType>
+			void printMatrix(const MatrixType& m,const std::string& label)
+			{
+				writeRecord(MATRIX,label,m);
+			}
+
+			//! records written by an Out on a std::ostream
+			void write(const std::string& records)
+			{
+				if (rank_>0) return;
+				os_->write(records.data(),records.size());
+			}
+
+			template<typename T>
+			friend Out& operator<<(Out& io,const T& x)
+			{
+				io.print(x);
+				return io;
+			}
+
+		private:
+
+			Out(const Out&);
+
+			Out& operator=(const Out&);
+
+			//! a record for each line that is not empty
+			void writeLines(const std::string& text)
+			{
+				if (rank_>0) return;
+				size_t begin = 0;
+				while (begin<text.size()) {
+					size_t end = text.find('\n',begin);
+					if (end==std::string::npos) end = text.size();
+					if (end>begin) writeHead(LINE,text.substr(begin,end-begin),0);
+					begin = end + 1;
+				}
+			}
+
+			template<typename T>
+			void writeRecord(char kind,const std::string& label,const T& x)
+			{
+				if (rank_>0) return;
+				Counter counter;
+				std::ostream cs(&counter);
+				binaryWrite(cs,x);
+				writeHead(kind,label,counter.size());
+				if (os_==&zout_) zbuf_.stride(IoBinaryStride<T>::SIZE);
+				binaryWrite(*os_,x);
+				if (!os_->good())
+					throw std::runtime_error("IoBinary::Out: cannot write " + label + "\n");
+			}
+
+			void writeHead(char kind,const std::string& label,size_t size)
+			{
+				os_->put(kind);
+				binaryWrite(*os_,label.size());
+				os_->write(label.data(),label.size());
+				binaryWrite(*os_,size);
+			}
+
+			size_t rank_;
+			std::ofstream fout_;
+			CompressedFile::OutBuf zbuf_;
+			std::ostream zout_;
+			std::ostream* os_;
+		}; // class Out
+
+		class In {
+
+			struct Head {
+				int kind;
+				std::string label;
+				size_t size;
+			};
+
+			// a label longer than this means the file is damaged
+			enum {MAX_LABEL = 1<<20};
+
+		public:
+
+			typedef long LongIntegerType;
+
+			static const LongIntegerType LAST_INSTANCE = -1;
+
+			In() : text_(false),fin_(0) {}
+
+			In(const std::string& fn) : text_(false),fin_(0) { open(fn); }
+
+			//! reads fn as text if it does not start with the magic string
+			void open(const std::string& fn)
+			{
+				close();
+				filename_ = fn;
+				bool compressed = CompressedFile::isCompressed(fn);
+				text_ = (!compressed && !isBinary(fn));
+				if (text_) {
+					textIn_.open(fn);
+					return;
+				}
+				if (compressed) {
+					zbuf_.open(fn);
+					fin_.rdbuf(&zbuf_);
+				} else {
+					file_.open(fn.c_str(),std::ios::binary);
+					fin_.rdbuf(file_.rdbuf());
+				}
+				fin_.seekg(magic().size());
+				Uint32Type x[3] = {0,0,0};
+				fin_.read(reinterpret_cast<char*>(x),sizeof(x));
+				if (!fin_ || x[0]>VERSION)
+					throw std::runtime_error("IoBinary::In: " + fn +
+						" was written by a newer version\n");
+				if (x[1]!=0x01020304 || x[2]!=sizeof(size_t))
+					throw std::runtime_error("IoBinary::In: " + fn +
+						" was written on a machine of another kind\n");
+				start_ = fin_.tellg();
+			}
+
+			void close()
+			{
+				if (text_) textIn_.close();
+				if (file_.is_open()) file_.close();
+				file_.clear();
+				zbuf_.close();
+				fin_.rdbuf(0);
+				text_ = false;
+			}
+
+			void rewind()
+			{
+				if (text_) {
+					textIn_.rewind();
+					return;
+				}
+				fin_.clear();
+				fin_.seekg(start_);
+			}
+
+			template<typename X>
+			void readline(X& x,const std::string& label,LongIntegerType level=0)
+			{
+				if (text_) {
+					textIn_.readline(x,label,level);
+					return;
+				}
+				std::pair<std::string,size_t> sc = advance(label,level);
+				std::istringstream is(sc.first.substr(label.size()));
+				is>>x;
+			}
+
+			template<typename X>
+			void read(X& x,const std::string& label,LongIntegerType level=0)
+			{
+				if (text_) {
+					textIn_.read(x,label,level);
+					return;
+				}
+				readPayload(x,find(label,VECTOR,level));
+			}
+
+			template<typename X>
+			void readMatrix(X& x,const std::string& label,LongIntegerType level=0)
+			{
+				if (text_) {
+					textIn_.readMatrix(x,label,level);
+					return;
+				}
+				readPayload(x,find(label,MATRIX,level));
+			}
+
+			//! past the record, unlike IoSimple::In which stops after the label
+			std::pair<std::string,size_t> advance(const std::string& label,LongIntegerType level=0)
+			{
+				if (text_) return textIn_.advance(label,level);
+				Head h = find(label,ANY,level);
+				fin_.seekg(h.size,std::ios::cur);
+				return std::pair<std::string,size_t>(h.label,level);
+			}
+
+			//! the records from the start, then rewinds
+			size_t count(const std::string& label)
+			{
+				if (text_) return textIn_.count(label);
+				rewind();
+				size_t counter = 0;
+				Head h;
+				while (readHead(h)) {
+					if (h.label.compare(0,label.size(),label)==0) counter++;
+					fin_.seekg(h.size,std::ios::cur);
+				}
+				rewind();
+				return counter;
+			}
+
+			//! formatted from the lines that follow
+			template<typename X>
+			friend void operator>>(In& io,X& x)
+			{
+				if (io.text_) {
+					io.textIn_>>x;
+					return;
+				}
+				std::istringstream is(io.lines());
+				is>>x;
+			}
+
+		private:
+
+			In(const In&);
+
+			In& operator=(const In&);
+
+			static bool isBinary(const std::string& fn)
+			{
+				std::ifstream fin(fn.c_str(),std::ios::binary);
+				if (!fin || !fin.good()) return false;
+				std::string m(magic().size(),' ');
+				fin.read(&m[0],m.size());
+				return (fin.gcount()==std::streamsize(m.size()) && m==magic());
+			}
+
+			//! false at the end of the file, or of what was written of it
+			bool readHead(Head& h)
+			{
+				int c = fin_.get();
+				if (!fin_) return false;
+				h.kind = c;
+				size_t n = 0;
+				binaryRead(fin_,n);
+				if (!fin_) return false;
+				if (n>MAX_LABEL) throw std::runtime_error("IoBinary::In: " + filename_ +
+					" is damaged\n");
+				h.label.resize(n);
+				if (n>0) fin_.read(&h.label[0],n);
+				binaryRead(fin_,h.size);
+				return fin_.good();
+			}
+
+			//! Finds the record number level from here (the last one if
+			//! level is LAST_INSTANCE) of one of kinds whose label starts
+			//! with label, and leaves the file at its payload
+			Head find(const std::string& label,int kinds,LongIntegerType level)
+			{
+				Head h, last;
+				std::streampos lastPayload = 0;
+				LongIntegerType counter = 0;
+				while (readHead(h)) {
+					if ((h.kind & kinds) && h.label.compare(0,label.size(),label)==0) {
+						if (counter==level) return h;
+						last = h;
+						lastPayload = fin_.tellg();
+						counter++;
+					}
+					fin_.seekg(h.size,std::ios::cur);
+				}
+				fin_.clear();
+				if (level==LAST_INSTANCE && counter>0) {
+					fin_.seekg(lastPayload);
+					return last;
+				}
+				throw std::runtime_error("IoBinary::In: " + label + " not found in " +
+					filename_ + "\n");
+			}
+
+			template<typename X>
+			void readPayload(X& x,const Head& h)
+			{
+				std::streampos end = fin_.tellg() + std::streamoff(h.size);
+				binaryRead(fin_,x);
+				if (!fin_ || fin_.tellg()!=end)
+					throw std::runtime_error("IoBinary::In: " + h.label + " in " +
+						filename_ + " has another type or is damaged\n");
+			}
+
+			//! the text of the lines from here to the next vector or matrix
+			std::string lines()
+			{
+				std::string text;
+				Head h;
+				std::streampos pos = fin_.tellg();
+				while (readHead(h) && h.kind==LINE) {
+					text += h.label + "\n";
+					pos = fin_.tellg();
+				}
+				fin_.clear();
+				fin_.seekg(pos);
+				return text;
+			}
+
+			std::string filename_;
+			bool text_;
+			PsimagLite::IoSimple::In textIn_;
+			std::ifstream file_;
+			CompressedFile::InBuf zbuf_;
+			std::istream fin_; // reads file_ or zbuf_
+			std::streampos start_;
+		}; // class In
+
+	}; // class IoBinary
+
+	//! Writes records formatted by an IoBinary::Out on a std::ostream,
+	//! see AsyncWriter
+	inline void printFormatted(IoBinary::Out& io,const std::string& records)
+	{
+		io.write(records);
+	}
+} // namespace Dmrg
+
+/*@}*/
+#endif
@@ -86,6 +86,9 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 #include "ProgramGlobals.h"
 #include "ProgressIndicator.h"
 #include "TridiagonalMatrix.h"
+#include "VectorKernels.h"
+#include "Threads.h"
+#include "ScratchStorage.h"
 
 namespace Dmrg {
 
@@ -94,6 +97,8 @@ namespace Dmrg {
 	//! 	rank() member function to indicate the rank of the matrix
 	//! 	matrixVectorProduct(std::vector<RealType>& x,const std::vector<RealType>& const y) 
 	//!    	   member function that implements the operation x += Hy
+	//!	globalRank() and reduce(partialSum) member functions for vectors
+	//!	   distributed among processes (rank() is then the local size)
 
 	template<typename RealType,typename MatrixType,typename VectorType>
 	class LanczosSolver {
@@ -103,6 +108,8 @@ namespace Dmrg {
 		typedef PsimagLite::TridiagonalMatrix<RealType> TridiagonalMatrixType;
 		typedef typename VectorType::value_type VectorElementType;
 		typedef typename PsimagLite::Matrix<VectorElementType> DenseMatrixType;
+		// one vector per column, in a file if too large, see ScratchStorage
+		typedef ScratchMatrix<VectorElementType> LanczosVectorsType;
 		enum {WITH_INFO=1,DEBUG=2,ALLOWS_ZERO=4};
 		
 		LanczosSolver(MatrixType const &mat, size_t& max_nstep,RealType eps,
@@ -127,6 +134,7 @@ namespace Dmrg {
 				y[i]=tmp;
 				atmp += utils::myProductT(y[i],y[i]);
 			}
+			atmp = mat_.reduce(atmp);
 			if (mode_ & DEBUG) {
 				computeGroundStateTest(gsEnergy,z,y);
 				return;
@@ -157,11 +165,11 @@ namespace Dmrg {
 				y[i]=initialVector[i];
 				atmp += utils::myProductT(y[i],y[i]);
 			}
-			atmp = 1.0 / sqrt (atmp);
+			atmp = 1.0 / sqrt (mat_.reduce(atmp));
 			for (size_t i = 0; i < mat_.rank(); i++) y[i] *= atmp;
 			
 			TridiagonalMatrixType ab;
-			DenseMatrixType lanczosVectors; 
+			LanczosVectorsType lanczosVectors;
 			tridiagonalDecomposition(y,ab,lanczosVectors);
 			std::vector<RealType> c(steps_);
 			try {
@@ -173,6 +181,7 @@ namespace Dmrg {
 
 			for (size_t i = 0; i < mat_.rank(); i++) z[i]=0;
 
+			lanczosVectors.advise(ScratchStorage::SEQUENTIAL);
 			for (size_t j = 0; j < steps_; j++) {
  				//mat_.matrixVectorProduct (x, y);
  				//atmp = ab.a(j);
@@ -188,6 +197,7 @@ namespace Dmrg {
 					//y[i] = tmp / btmp;
 					//x[i] = -btmp * tmp;
 				}
+				lanczosVectors.adviseColumn(j,ScratchStorage::DONT_NEED);
 			}
 			if (mode_ & WITH_INFO) info(gsEnergy,initialVector,std::cerr);
 			
@@ -196,7 +206,7 @@ namespace Dmrg {
 		void tridiagonalDecomposition(
 				const VectorType& initVector,
     				TridiagonalMatrixType& ab,
-				DenseMatrixType& lanczosVectors)
+				LanczosVectorsType& lanczosVectors)
 		{ /*
 			*     In each step of the Lanczos algorithm the values of a[]
 			*     and b[] are computed.
@@ -220,17 +230,27 @@ namespace Dmrg {
 			
 			VectorType x(mat_.rank());
 			VectorType z(mat_.rank());
-			VectorType y = initVector;
+			VectorType y(mat_.rank());
+			// x+=Hy writes x and reads y by chunks of rows, one chunk per thread
+			Threads::firstTouch(x);
+			Threads::firstTouch(y);
 			RealType atmp = 0;
 			for (size_t i = 0; i < mat_.rank(); i++) {
 				z[i] = x[i] = 0;
+				y[i] = initVector[i];
 				atmp += utils::myProductT (y[i] ,y[i]);
  			}
+			atmp = mat_.reduce(atmp);
 
 			for (size_t i = 0; i < y.size(); i++) y[i] /= sqrt(atmp);
 
-			if (max_nstep > mat_.rank()) max_nstep = mat_.rank();
+			if (max_nstep > mat_.globalRank()) max_nstep = mat_.globalRank();
 			lanczosVectors.resize(mat_.rank(),max_nstep);
+			// each column by the same chunks of rows as x and y
+			if (mat_.rank()>0 && max_nstep>0)
+				Threads::firstTouch(&(lanczosVectors(0,0)),mat_.rank(),max_nstep);
+			// written, and later read, one column after the other
+			lanczosVectors.advise(ScratchStorage::SEQUENTIAL);
 			ab.resize(max_nstep,0);
 			
 			if (mode_ & ALLOWS_ZERO && isHyZero(y,ab,lanczosVectors)) return;
@@ -242,6 +262,7 @@ namespace Dmrg {
 			for (; j < max_nstep; j++) {
 				for (size_t i = 0; i < mat_.rank(); i++) 
 					lanczosVectors(i,j) = y[i];
+				lanczosVectors.adviseColumn(j,ScratchStorage::DONT_NEED); // not read until the end
 			
 				RealType btmp = 0;
 				oneStepDecomposition(x,y,atmp,btmp);
@@ -282,15 +303,12 @@ namespace Dmrg {
 		{
 			mat_.matrixVectorProduct (x, y); // x+= Hy
 
-			atmp = 0.0;
-			for (size_t i = 0; i < mat_.rank(); i++)
-				atmp += utils::myProductT (y[i] ,x[i]);
-			btmp = 0.0;
-			for (size_t i = 0; i < mat_.rank(); i++) {
-				x[i] -= atmp * y[i];
-				btmp += utils::myProductT (x[i] ,x[i]);
-			}
-			btmp = sqrt (btmp);
+			size_t n = mat_.rank();
+			atmp = (n==0) ? 0.0 : VectorKernels::realProduct(&(y[0]),&(x[0]),n);
+			atmp = mat_.reduce(atmp);
+			if (n>0) VectorKernels::realAxpy(&(x[0]),-atmp,&(y[0]),n);
+			btmp = (n==0) ? 0.0 : VectorKernels::realProduct(&(x[0]),&(x[0]),n);
+			btmp = sqrt (mat_.reduce(btmp));
 
 			for (size_t i = 0; i < mat_.rank(); i++) {
 				//lanczosVectors(i,j) = y[i];
@@ -317,7 +335,9 @@ namespace Dmrg {
 
 		void info(RealType energyTmp,const VectorType& x,std::ostream& os)
 		{
-			RealType norma=PsimagLite::norm(x);
+			RealType norma = 0.0;
+			for (size_t i=0;i<x.size();i++) norma += utils::myProductT(x[i],x[i]);
+			norma = sqrt(mat_.reduce(norma));
 			size_t& iter = steps_;
 			
 			if (norma<1e-5 || norma>100) throw std::runtime_error("Norm\n");
@@ -468,7 +488,7 @@ namespace Dmrg {
 		// provides a gracious way to exit if Ay == 0 (we assume that then A=0)
 		bool isHyZero(const VectorType& y,
 				TridiagonalMatrixType& ab,
-			DenseMatrixType& lanczosVectors) const
+			LanczosVectorsType& lanczosVectors) const
 		{
 			std::ostringstream msg;
 			msg<<"Testing whether matrix is zero...";
@@ -480,8 +500,10 @@ namespace Dmrg {
 
 			mat_.matrixVectorProduct (x, y); // x+= Hy
 
+			RealType sum = 0.0;
 			for (size_t i = 0; i < x.size(); i++)
-				if (utils::myProductT (x[i] ,x[i])!=0) return false;
+				sum += utils::myProductT (x[i] ,x[i]);
+			if (mat_.reduce(sum)!=0) return false;
 
 			for (size_t j=0; j < lanczosVectors.n_col(); j++) {
 				for (size_t i = 0; i < mat_.rank(); i++) {
@@ -0,0 +1,351 @@
+// BEGIN LICENSE BLOCK
+/*
+Copyright (c) 2009, UT-Battelle, LLC
+All rights reserved
+
+[DMRG++, Version 2.0.0]
+[by G.A., Oak Ridge National Laboratory]
+
+UT Battelle Open Source Software License 11242008
+
+OPEN SOURCE LICENSE
+
+Subject to the conditions of this License, each
+contributor to this software hereby grants, free of
+charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"), a
+perpetual, worldwide, non-exclusive, no-charge,
+royalty-free, irrevocable copyright license to use, copy,
+modify, merge, publish, distribute, and/or sublicense
+copies of the Software.
+
+1. Redistributions of Software must retain the above
+copyright and license notices, this list of conditions,
+and the following disclaimer.  Changes or modifications
+to, or derivative works of, the Software should be noted
+with comments and the contributor and organization's
+name.
+
+2. Neither the names of UT-Battelle, LLC or the
+Department of Energy nor the names of the Software
+contributors may be used to endorse or promote products
+derived from this software without specific prior written
+permission of UT-Battelle.
+
+3. The software and the end-user documentation included
+with the redistribution, with or without modification,
+must include the following acknowledgment:
+
+"This product includes software produced by UT-Battelle,
+LLC under Contract No. DE-AC05-00OR22725  with the
+Department of Energy."
+ 
+*********************************************************
+DISCLAIMER
+
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT OWNER, CONTRIBUTORS, UNITED STATES GOVERNMENT,
+OR THE UNITED STATES DEPARTMENT OF ENERGY BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+
+NEITHER THE UNITED STATES GOVERNMENT, NOR THE UNITED
+STATES DEPARTMENT OF ENERGY, NOR THE COPYRIGHT OWNER, NOR
+ANY OF THEIR EMPLOYEES, REPRESENTS THAT THE USE OF ANY
+INFORMATION, DATA, APPARATUS, PRODUCT, OR PROCESS
+DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
+
+*********************************************************
+
+
+*/
+// END LICENSE BLOCK
+/** \ingroup DMRG */
+/*@{*/
+
+/*! \file LapackExtra.h
+ *
+ *  LAPACK routines that PsimagLite's diag does not wrap (the SVD, and
+ *  the steps of the eigensolver, so that the eigenvalues and then only
+ *  some of the eigenvectors can be computed from one reduction), for
+ *  real and complex double precision matrices in PsimagLite::Matrix
+ *  (which stores by columns, as LAPACK does)
+ *
+ */
+#ifndef LAPACK_EXTRA_H
+#define LAPACK_EXTRA_H
+
+#include <vector>
+#include <complex>
+#include <stdexcept>
+#include "Matrix.h" // in PsimagLite
+
+extern "C" void dgesvd_(char*,char*,int*,int*,double*,int*,double*,double*,
+                        int*,double*,int*,double*,int*,int*);
+extern "C" void zgesvd_(char*,char*,int*,int*,std::complex<double>*,int*,
+                        double*,std::complex<double>*,int*,std::complex<double>*,
+                        int*,std::complex<double>*,int*,double*,int*);
+
+extern "C" void dsytrd_(char*,int*,double*,int*,double*,double*,double*,
+                        double*,int*,int*);
+extern "C" void zhetrd_(char*,int*,std::complex<double>*,int*,double*,double*,
+                        std::complex<double>*,std::complex<double>*,int*,int*);
+extern "C" void dsterf_(int*,double*,double*,int*);
+extern "C" void dstemr_(char*,char*,int*,double*,double*,double*,double*,int*,
+                        int*,int*,double*,double*,int*,int*,int*,int*,
+                        double*,int*,int*,int*,int*);
+extern "C" void dormtr_(char*,char*,char*,int*,int*,double*,int*,double*,
+                        double*,int*,double*,int*,int*);
+extern "C" void zunmtr_(char*,char*,char*,int*,int*,std::complex<double>*,int*,
+                        std::complex<double>*,std::complex<double>*,int*,
+                        std::complex<double>*,int*,int*);
+#if defined(USE_MKL)
+extern "C" void MKL_Set_Num_Threads(int);
+extern "C" int MKL_Get_Max_Threads();
+#elif defined(USE_OPENBLAS)
+extern "C" void openblas_set_num_threads(int);
+extern "C" int openblas_get_num_threads();
+#endif
+
+namespace Dmrg {
+
+	//! Sets the number of threads of a threaded LAPACK (OpenBLAS if
+	//! compiled with -DUSE_OPENBLAS, MKL if compiled with -DUSE_MKL) for
+	//! the calls that follow; returns false, doing nothing, otherwise
+	inline bool setLapackThreads(size_t n)
+	{
+#if defined(USE_MKL)
+		MKL_Set_Num_Threads(n);
+		return true;
+#elif defined(USE_OPENBLAS)
+		openblas_set_num_threads(n);
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	//! The number of threads of a threaded LAPACK, or 0 if not
+	//! compiled for one (see setLapackThreads)
+	inline size_t lapackThreads()
+	{
+#if defined(USE_MKL)
+		return MKL_Get_Max_Threads();
+#elif defined(USE_OPENBLAS)
+		return openblas_get_num_threads();
+#else
+		return 0;
+#endif
+	}
+
+	inline void gesvd(char jobu,char jobvt,int m,int n,double* a,int lda,
+	                  double* s,double* u,int ldu,double* vt,int ldvt,int& info)
+	{
+		int lwork = -1;
+		double tmp = 0;
+		dgesvd_(&jobu,&jobvt,&m,&n,a,&lda,s,u,&ldu,vt,&ldvt,&tmp,&lwork,&info);
+		if (info!=0) return;
+		lwork = int(tmp);
+		std::vector<double> work(lwork);
+		dgesvd_(&jobu,&jobvt,&m,&n,a,&lda,s,u,&ldu,vt,&ldvt,&(work[0]),&lwork,&info);
+	}
+
+	inline void gesvd(char jobu,char jobvt,int m,int n,std::complex<double>* a,int lda,
+	                  double* s,std::complex<double>* u,int ldu,
+	                  std::complex<double>* vt,int ldvt,int& info)
+	{
+		int lwork = -1;
+		std::complex<double> tmp = 0;
+		int mn = (m<n) ? m : n;
+		std::vector<double> rwork(5*mn+1);
+		zgesvd_(&jobu,&jobvt,&m,&n,a,&lda,s,u,&ldu,vt,&ldvt,&tmp,&lwork,
+		        &(rwork[0]),&info);
+		if (info!=0) return;
+		lwork = int(std::real(tmp));
+		std::vector<std::complex<double> > work(lwork);
+		zgesvd_(&jobu,&jobvt,&m,&n,a,&lda,s,u,&ldu,vt,&ldvt,&(work[0]),&lwork,
+		        &(rwork[0]),&info);
+	}
+
+	inline void hetrd(int n,double* a,int lda,double* d,double* e,double* tau,
+	                  int& info)
+	{
+		char uplo = 'U';
+		int lwork = -1;
+		double tmp = 0;
+		dsytrd_(&uplo,&n,a,&lda,d,e,tau,&tmp,&lwork,&info);
+		if (info!=0) return;
+		lwork = int(tmp);
+		std::vector<double> work(lwork);
+		dsytrd_(&uplo,&n,a,&lda,d,e,tau,&(work[0]),&lwork,&info);
+	}
+
+	inline void hetrd(int n,std::complex<double>* a,int lda,double* d,double* e,
+	                  std::complex<double>* tau,int& info)
+	{
+		char uplo = 'U';
+		int lwork = -1;
+		std::complex<double> tmp = 0;
+		zhetrd_(&uplo,&n,a,&lda,d,e,tau,&tmp,&lwork,&info);
+		if (info!=0) return;
+		lwork = int(std::real(tmp));
+		std::vector<std::complex<double> > work(lwork);
+		zhetrd_(&uplo,&n,a,&lda,d,e,tau,&(work[0]),&lwork,&info);
+	}
+
+	//! c = q * c, q being the product of the reflectors left in a by hetrd
+	inline void applyReflectors(int n,int nc,double* a,int lda,double* tau,
+	                            double* c,int ldc,int& info)
+	{
+		char side = 'L', uplo = 'U', trans = 'N';
+		int lwork = -1;
+		double tmp = 0;
+		dormtr_(&side,&uplo,&trans,&n,&nc,a,&lda,tau,c,&ldc,&tmp,&lwork,&info);
+		if (info!=0) return;
+		lwork = int(tmp);
+		std::vector<double> work(lwork);
+		dormtr_(&side,&uplo,&trans,&n,&nc,a,&lda,tau,c,&ldc,&(work[0]),&lwork,&info);
+	}
+
+	inline void applyReflectors(int n,int nc,std::complex<double>* a,int lda,
+	                            std::complex<double>* tau,std::complex<double>* c,
+	                            int ldc,int& info)
+	{
+		char side = 'L', uplo = 'U', trans = 'N';
+		int lwork = -1;
+		std::complex<double> tmp = 0;
+		zunmtr_(&side,&uplo,&trans,&n,&nc,a,&lda,tau,c,&ldc,&tmp,&lwork,&info);
+		if (info!=0) return;
+		lwork = int(std::real(tmp));
+		std::vector<std::complex<double> > work(lwork);
+		zunmtr_(&side,&uplo,&trans,&n,&nc,a,&lda,tau,c,&ldc,&(work[0]),&lwork,&info);
+	}
+
+	//! A hermitian matrix a = q * t * q^\dagger reduced by tridiagonalise:
+	//! the diagonal d and off-diagonal e of the real tridiagonal t, and the
+	//! scalar factors of the reflectors of q, which are left in a
+	template<typename T>
+	struct TridiagonalForm {
+		std::vector<double> d;
+		std::vector<double> e;
+		std::vector<T> tau;
+	};
+
+	//! Reduces the hermitian matrix a to tridiagonal form; a is overwritten
+	//! by the reflectors, and must be kept for eigenvectorsInRange
+	template<typename T>
+	void tridiagonalise(TridiagonalForm<T>& t,PsimagLite::Matrix<T>& a)
+	{
+		int n = a.n_row();
+		t.d.resize(n);
+		t.e.resize(n);
+		t.tau.resize(n);
+		if (n==0) return;
+		int info = 0;
+		hetrd(n,&(a(0,0)),n,&(t.d[0]),&(t.e[0]),&(t.tau[0]),info);
+		if (info!=0) throw std::runtime_error(
+			"tridiagonalise(...): hetrd failed\n");
+	}
+
+	//! Eigenvalues (in increasing order) of a matrix reduced by tridiagonalise
+	template<typename T>
+	void eigenvalues(std::vector<double>& w,const TridiagonalForm<T>& t)
+	{
+		int n = t.d.size();
+		w = t.d;
+		if (n==0) return;
+		std::vector<double> e = t.e;
+		int info = 0;
+		dsterf_(&n,&(w[0]),&(e[0]),&info);
+		if (info!=0) throw std::runtime_error(
+			"eigenvalues(...): sterf failed\n");
+	}
+
+	//! Eigenvalues il to iu (counting from 1, in increasing order) of the
+	//! matrix a reduced by tridiagonalise(t,a), and their eigenvectors in
+	//! the columns of z
+	template<typename T>
+	void eigenvectorsInRange(PsimagLite::Matrix<T>& z,
+	                         std::vector<double>& w,
+	                         const TridiagonalForm<T>& t,
+	                         PsimagLite::Matrix<T>& a,
+	                         int il,
+	                         int iu)
+	{
+		int n = t.d.size();
+		int m = iu - il + 1;
+		w.resize(n);
+		z.resize(n,m);
+		if (m<=0) return;
+
+		// eigenvectors of the real tridiagonal t
+		char jobz = 'V', range = 'I';
+		double vl = 0, vu = 0;
+		std::vector<double> d = t.d;
+		std::vector<double> e = t.e;
+		std::vector<double> zt(n*m);
+		std::vector<int> isuppz(2*m);
+		int found = 0, nzc = m, tryrac = 1, info = 0;
+		int lwork = -1, liwork = -1, itmp = 0;
+		double tmp = 0;
+		dstemr_(&jobz,&range,&n,&(d[0]),&(e[0]),&vl,&vu,&il,&iu,&found,&(w[0]),
+		        &(zt[0]),&n,&nzc,&(isuppz[0]),&tryrac,&tmp,&lwork,&itmp,&liwork,&info);
+		if (info==0) {
+			lwork = int(tmp);
+			liwork = itmp;
+			std::vector<double> work(lwork);
+			std::vector<int> iwork(liwork);
+			dstemr_(&jobz,&range,&n,&(d[0]),&(e[0]),&vl,&vu,&il,&iu,&found,&(w[0]),
+			        &(zt[0]),&n,&nzc,&(isuppz[0]),&tryrac,&(work[0]),&lwork,
+			        &(iwork[0]),&liwork,&info);
+		}
+		if (info!=0 || found!=m) throw std::runtime_error(
+			"eigenvectorsInRange(...): stemr failed\n");
+
+		// and back to those of a
+		for (int j=0;j<m;j++)
+			for (int i=0;i<n;i++) z(i,j) = zt[i+j*n];
+		std::vector<T> tau = t.tau;
+		applyReflectors(n,m,&(a(0,0)),n,&(tau[0]),&(z(0,0)),n,info);
+		if (info!=0) throw std::runtime_error(
+			"eigenvectorsInRange(...): applying the reflectors failed\n");
+		w.resize(m);
+	}
+
+	//! Computes a = u * diag(s) * v^\dagger and returns the first min(m,n)
+	//! columns of u and the min(m,n) singular values s in decreasing
+	//! order; v is not computed. a is destroyed.
+	template<typename T,typename RealType>
+	void leftSingularVectors(PsimagLite::Matrix<T>& u,
+	                         std::vector<RealType>& s,
+	                         PsimagLite::Matrix<T>& a)
+	{
+		int m = a.n_row();
+		int n = a.n_col();
+		int mn = (m<n) ? m : n;
+		u.resize(m,mn);
+		s.resize(mn);
+		if (mn==0) return;
+		T vt = 0;
+		int info = 0;
+		std::vector<double> sd(mn);
+		gesvd('S','N',m,n,&(a(0,0)),m,&(sd[0]),&(u(0,0)),m,&vt,1,info);
+		if (info!=0) throw std::runtime_error(
+			"leftSingularVectors(...): gesvd failed\n");
+		for (int i=0;i<mn;i++) s[i] = sd[i];
+	}
+} // namespace Dmrg
+
+/*@}*/
+#endif // LAPACK_EXTRA_H
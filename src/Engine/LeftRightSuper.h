@@ -83,6 +83,7 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 #define LEFT_RIGHT_SUPER_H
 
 #include "ProgressIndicator.h"
+#include "CopyOnWrite.h"
 
 namespace Dmrg {
 	
@@ -102,6 +103,8 @@ namespace Dmrg {
 			typedef PsimagLite::ProgressIndicator ProgressIndicatorType;
 			typedef  LeftRightSuper<
 					BasisWithOperatorsType_,SuperBlockType> ThisType;
+			typedef CopyOnWrite<BasisWithOperatorsType> SharedBasisType;
+			typedef CopyOnWrite<SuperBlockType> SharedSuperType;
 
 			enum {GROW_TO_THE_RIGHT = BasisWithOperatorsType::GROW_RIGHT,
 				GROW_TO_THE_LEFT= BasisWithOperatorsType::GROW_LEFT};
@@ -150,7 +153,9 @@ namespace Dmrg {
 			}
 
 			LeftRightSuper(const ThisType& rls)
-			: progress_("LeftRightSuper",0),refCounter_(1)
+			: progress_("LeftRightSuper",0),refCounter_(1),
+			  leftShared_(rls.leftShared_),rightShared_(rls.rightShared_),
+			  superShared_(rls.superShared_)
 			{
 				left_=rls.left_;
 				right_=rls.right_;
@@ -170,6 +175,7 @@ namespace Dmrg {
 					BasisWithOperatorsType &pS,
 					BlockType const &X)
 			{
+				leftShared_.reset();
 				grow(*left_,model,pS,X,GROW_TO_THE_RIGHT);
 			}
 
@@ -179,78 +185,137 @@ namespace Dmrg {
 					BasisWithOperatorsType &pE,
 					BlockType const &X)
 			{
+				rightShared_.reset();
 				grow(*right_,model,pE,X,GROW_TO_THE_LEFT);
 			}
 
 			void printSizes(const std::string& label,std::ostream& os) const
 			{
 				std::ostringstream msg;
-				msg<<label<<": left-block basis="<<left_->size();
-				msg<<", right-block basis="<<right_->size();
-				msg<<" sites="<<left_->block().size()<<"+";
-				msg<<right_->block().size();
+				msg<<label<<": left-block basis="<<left().size();
+				msg<<", right-block basis="<<right().size();
+				msg<<" sites="<<left().block().size()<<"+";
+				msg<<right().block().size();
 				progress_.printline(msg,os);
 			}
 
 			size_t sites() const
 			{
-				return left_->block().size() + right_->block().size();
+				return left().block().size() + right().block().size();
 			}
 
 			void setToProduct(size_t quantumSector)
 			{
-				super_->setToProduct(*left_,*right_,quantumSector);
+				superShared_.reset();
+				super_->setToProduct(left(),right(),quantumSector);
 			}
 
 			template<typename IoOutputType>
 			void save(IoOutputType& io) const
 			{
-				super_->save(io);
-				left_->save(io);
-				right_->save(io);
+				super().save(io);
+				left().save(io);
+				right().save(io);
 			}
 
-			const BasisWithOperatorsType& left() const { return *left_; }
+			const BasisWithOperatorsType& left() const
+			{
+				return (leftShared_.empty()) ? *left_ : *leftShared_;
+			}
+
+			const BasisWithOperatorsType& right() const
+			{
+				return (rightShared_.empty()) ? *right_ : *rightShared_;
+			}
+
+			const SuperBlockType& super() const
+			{
+				return (superShared_.empty()) ? *super_ : *superShared_;
+			}
+
+			//! no copy: left() becomes the basis of the handle, and
+			//! the next growth of the left block goes into a new basis
+			SharedBasisType leftHandle()
+			{
+				if (leftShared_.empty()) {
+					if (refCounter_>0) throw std::runtime_error
+							("LeftRightSuper::leftHandle(): not the owner\n");
+					leftShared_ = SharedBasisType::adopt(left_);
+					left_ = new BasisWithOperatorsType(leftShared_->name());
+				}
+				return leftShared_;
+			}
 
-			const BasisWithOperatorsType& right() const { return *right_; }
+			//! no copy, see leftHandle()
+			SharedBasisType rightHandle()
+			{
+				if (rightShared_.empty()) {
+					if (refCounter_>0) throw std::runtime_error
+							("LeftRightSuper::rightHandle(): not the owner\n");
+					rightShared_ = SharedBasisType::adopt(right_);
+					right_ = new BasisWithOperatorsType(rightShared_->name());
+				}
+				return rightShared_;
+			}
 
-			const SuperBlockType& super() const { return *super_; }
+			//! no copy, see leftHandle()
+			SharedSuperType superHandle()
+			{
+				if (superShared_.empty()) {
+					if (refCounter_>0) throw std::runtime_error
+							("LeftRightSuper::superHandle(): not the owner\n");
+					superShared_ = SharedSuperType::adopt(super_);
+					super_ = new SuperBlockType(superShared_->name());
+				}
+				return superShared_;
+			}
 
 			void left(const BasisWithOperatorsType& left)
 			{
 				if (refCounter_>0) throw std::runtime_error
 						("LeftRightSuper::left(...): not the owner\n");
+				leftShared_.reset();
 				*left_=left; // deep copy
 			}
 
+			//! no copy: left() is now the basis of the handle
+			void left(const SharedBasisType& left)
+			{
+				if (refCounter_>0) throw std::runtime_error
+						("LeftRightSuper::left(...): not the owner\n");
+				leftShared_ = left;
+			}
+
 			void right(const BasisWithOperatorsType& right)
 			{
 				if (refCounter_>0) throw std::runtime_error
 						("LeftRightSuper::right(...): not the owner\n");
+				rightShared_.reset();
 				*right_=right; // deep copy
 			}
 
+			//! no copy: right() is now the basis of the handle
+			void right(const SharedBasisType& right)
+			{
+				if (refCounter_>0) throw std::runtime_error
+						("LeftRightSuper::right(...): not the owner\n");
+				rightShared_ = right;
+			}
+
 
 			template<typename IoInputType>
 			void load(IoInputType& io)
 			{
+				leftShared_.reset();
+				rightShared_.reset();
+				superShared_.reset();
 				super_->load(io);
 				left_->load(io);
 				right_->load(io);
 			}
 
-		private:
-			LeftRightSuper(ThisType& rls);
-
-			void deepCopy(const ThisType& rls)
-			{
-				*left_=*rls.left_;
-				*right_=*rls.right_;
-				*super_=*rls.super_;
-				if (refCounter_>0) refCounter_--;
-			}
-
-			//! add block X to basis pS and put the result in left_:
+			//! add block X to basis pS and put the result in leftOrRight, with
+			//! its Hamiltonian (dir is GROW_TO_THE_RIGHT or GROW_TO_THE_LEFT)
 			template<typename SomeModelType>
 			void grow(
 					BasisWithOperatorsType& leftOrRight,
@@ -282,11 +347,29 @@ namespace Dmrg {
 				leftOrRight.setHamiltonian(matrix);
 			}
 
+		private:
+			LeftRightSuper(ThisType& rls);
+
+			void deepCopy(const ThisType& rls)
+			{
+				leftShared_.reset();
+				rightShared_.reset();
+				superShared_.reset();
+				*left_=rls.left();
+				*right_=rls.right();
+				*super_=rls.super();
+				if (refCounter_>0) refCounter_--;
+			}
+
 			ProgressIndicatorType progress_;
 			BasisWithOperatorsType* left_;
 			BasisWithOperatorsType* right_;
 			SuperBlockType* super_;
 			size_t refCounter_;
+			// if not empty, left(), right() and super() are these instead
+			// of left_, right_ and super_, until that one changes again
+			SharedBasisType leftShared_,rightShared_;
+			SharedSuperType superShared_;
 			
 	}; // class LeftRightSuper
 
@@ -132,6 +132,12 @@ namespace Dmrg {
 				modelCommon_.matrixVectorProduct(x,y,modelHelper);
 			}
 
+			//! The columns of H_m that x+=H_m y needs for the rows of modelHelper
+			void columns(std::vector<size_t>& cols,ModelHelperType const &modelHelper) const
+			{
+				modelCommon_.columns(cols,modelHelper);
+			}
+
 			void addHamiltonianConnection(
 				SparseMatrixType &matrix,
 				const LeftRightSuperType& lrs,
@@ -83,9 +83,11 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 #ifndef MODEL_COMMON_H
 #define MODEL_COMMON_H
 
+#include <algorithm>
 #include "VerySparseMatrix.h"
 #include "IoSimple.h"
 #include "HamiltonianConnection.h"
+#include "Threads.h"
 
 namespace Dmrg {
 	//! Common functions for various models
@@ -162,9 +164,33 @@ namespace Dmrg {
 				}
 				size_t total = lps.isaved.size();
 
-				SharedMemoryType pthreads;
-				pthreads.loopCreate(total,hc);
+				// operators are made explicit only once, here in this thread,
+				// so that the threads of the product only read them
+				for (size_t ix=0;ix<total;ix++) hc.prepareOperators(ix);
 
+				Threads::loopCreate(total,hc);
+				hc.sumThreads();
+			}
+
+			//! The columns of H_m, sorted, that x+=H_m y needs for the rows
+			//! of modelHelper (see ModelHelperLocal::setHalo)
+			void columns(std::vector<size_t>& cols,const ModelHelperType& modelHelper) const
+			{
+				size_t n=modelHelper.leftRightSuper().super().block().size();
+
+				cols.clear();
+				modelHelper.hamiltonianColumns(cols);
+				sortUnique(cols);
+
+				LinkProductStructType lps;
+				HamiltonianConnectionType hc(dmrgGeometry_,modelHelper,&lps);
+				for (size_t i=0;i<n;i++)
+					for (size_t j=0;j<n;j++)
+						hc.compute(i,j,0,&lps);
+				for (size_t ix=0;ix<lps.isaved.size();ix++) {
+					hc.linkColumns(cols,ix);
+					sortUnique(cols);
+				}
 			}
 			
 			//! Return H, the hamiltonian of the model for basis1 and partition m consisting of the external product
@@ -202,6 +228,12 @@ namespace Dmrg {
 
 		private:
 
+			static void sortUnique(std::vector<size_t>& v)
+			{
+				std::sort(v.begin(),v.end());
+				v.erase(std::unique(v.begin(),v.end()),v.end());
+			}
+
 			//! Add Hamiltonian connection between basis2 and basis3 in
 			// the orderof basis1 for symmetry block m
 			template<typename SomeModelHelperType>
@@ -77,6 +77,8 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 //#include "RightLeftLocal.h"
 #include "PackIndices.h" // in PsimagLite
 #include "Link.h"
+#include "VectorKernels.h"
+#include "Threads.h"
 
 /** \ingroup DMRG */
 /*@{*/
@@ -95,6 +97,8 @@ namespace Dmrg {
 
 		typedef PsimagLite::PackIndices PackIndicesType;
 
+		enum {LEFT_PRODUCT,RIGHT_PRODUCT};
+
 	public:	
 		typedef LeftRightSuperType_ LeftRightSuperType;
 		typedef typename LeftRightSuperType::OperatorsType OperatorsType;
@@ -124,22 +128,102 @@ namespace Dmrg {
 			buffer_(lrs_.left().size()),
 			basis2tc_(lrs_.left().numberOfOperators()),
 			basis3tc_(lrs_.right().numberOfOperators()),
-			alpha_(lrs_.super().size()),
-			beta_(lrs_.super().size()),
+			basis2tcDone_(basis2tc_.size(),false),
+			basis3tcDone_(basis3tc_.size(),false),
+			alpha_(lrs_.super().partition(m+1)-lrs_.super().partition(m)),
+			beta_(alpha_.size()),
 			reflection_(useReflection),
-			numberOfOperators_(lrs_.left().numberOfOperatorsPerSite())
+			numberOfOperators_(lrs_.left().numberOfOperatorsPerSite()),
+			rows_(alpha_.size())
 			//,rightLeftLocal_(m,basis1,basis2,basis3,orbitals,useReflection)
 		{
+			for (size_t i=0;i<rows_.size();i++) rows_[i] = i;
 			createBuffer();
-			createTcOperators(basis2tc_,lrs_.left());
-			createTcOperators(basis3tc_,lrs_.right());
+			createAlphaAndBeta();
+		}
+
+		//! x+=Hy will only compute the given rows of partition m, and
+		//! x is indexed by position in rows; y is indexed as set by
+		//! setHalo, which must be called before x+=Hy
+		ModelHelperLocal(
+				size_t m,
+				const LeftRightSuperType& lrs,
+				const std::vector<size_t>& rows)
+		:
+			m_(m),
+			lrs_(lrs),
+			buffer_(lrs_.left().size()),
+			basis2tc_(lrs_.left().numberOfOperators()),
+			basis3tc_(lrs_.right().numberOfOperators()),
+			basis2tcDone_(basis2tc_.size(),false),
+			basis3tcDone_(basis3tc_.size(),false),
+			alpha_(rows.size()),
+			beta_(rows.size()),
+			reflection_(false),
+			numberOfOperators_(lrs_.left().numberOfOperatorsPerSite()),
+			rows_(rows)
+		{
 			createAlphaAndBeta();
 		}
 
 		size_t m() const { return m_; }
 
+		//! y of x+=Hy will have the rows given to the constructor followed
+		//! by those in halo, all in the numbering of partition m;
+		//! buffer_ is only made for these
+		void setHalo(const std::vector<size_t>& halo)
+		{
+			for (size_t ii=0;ii<rows_.size();ii++)
+				setBufferEntry(rows_[ii],ii);
+			for (size_t h=0;h<halo.size();h++)
+				setBufferEntry(halo[h],rows_.size()+h);
+		}
+
+		//! Appends to cols the columns of partition m that the left and
+		//! right Hamiltonians need for the rows of this object
+		void hamiltonianColumns(std::vector<size_t>& cols) const
+		{
+			const SparseMatrixType& left = lrs_.left().hamiltonian();
+			const SparseMatrixType& right = lrs_.right().hamiltonian();
+			for (size_t ii=0;ii<rows_.size();ii++) {
+				size_t alpha = alpha_[ii];
+				size_t beta = beta_[ii];
+				for (int k=left.getRowPtr(alpha);k<left.getRowPtr(alpha+1);k++)
+					addColumn(cols,left.getCol(k),beta);
+				for (int k=right.getRowPtr(beta);k<right.getRowPtr(beta+1);k++)
+					addColumn(cols,alpha,right.getCol(k));
+			}
+		}
+
+		//! Appends to cols the columns of partition m that (AB) needs
+		//! for the rows of this object, see fastOpProdInter below
+		void fastOpProdInterColumns(std::vector<size_t>& cols,
+		                            SparseMatrixType const &A,
+		                            SparseMatrixType const &B,
+		                            const LinkType& link) const
+		{
+			if (link.type==ProgramGlobals::ENVIRON_SYSTEM)  {
+				LinkType link2 = link;
+				link2.type = ProgramGlobals::SYSTEM_ENVIRON;
+				fastOpProdInterColumns(cols,B,A,link2);
+				return;
+			}
+
+			for (size_t ii=0;ii<rows_.size();ii++) {
+				size_t alpha = alpha_[ii];
+				size_t beta = beta_[ii];
+				for (int k=A.getRowPtr(alpha);k<A.getRowPtr(alpha+1);k++)
+					for (int kk=B.getRowPtr(beta);kk<B.getRowPtr(beta+1);kk++)
+						addColumn(cols,A.getCol(k),B.getCol(kk));
+			}
+		}
+
 		static bool isSu2() { return false; }
 
+		//! x+=Hy can be for some rows only, see the constructor above,
+		//! and so distributed among MPI processes (see Diagonalization)
+		enum {DISTRIBUTED = 1};
+
 //		const BasisType& basis1() const { return basis1_; }
 //
 //		const BasisWithOperatorsType& basis2() const  { return basis2_; }
@@ -180,6 +264,7 @@ namespace Dmrg {
 				const LinkType& link,
 				bool flipped = false) const
 		{
+			checkAllRows("fastOpProdInter");
 			//int const SystemEnviron=1,EnvironSystem=2;
 			RealType fermionSign =
 					(link.fermionOrBoson==ProgramGlobals::FERMION) ? -1 : 1;
@@ -250,37 +335,42 @@ namespace Dmrg {
 			}
 			
 			//! work only on partition m
-			int m = m_;
-			int offset = lrs_.super().partition(m);
-			int total = lrs_.super().partition(m+1) - offset;
+			bool useReflection = reflection_.useReflection();
 
-			for (int i=0;i<total;i++) {
+			for (size_t ii=0;ii<rows_.size();ii++) {
+				int i = rows_[ii];
 				if (reflection_.outsideReflectionBounds(i)) continue;
 				// row i of the ordered product basis
 				//utils::getCoordinates(alpha,beta,modelHelper.basis1().permutation(i+offset),ns);
-				int alpha=alpha_[i];
-				int beta=beta_[i];		
+				int alpha=alpha_[ii];
+				int beta=beta_[ii];
+				/* fermion signs note:
+				   here the environ is applied first and has to "cross"
+				   the system, hence the sign factor pSprime.fermionicSign(alpha,tmp)
+				 */
+				SparseElementType rowFactor = link.value;
+				if (link.fermionOrBoson == ProgramGlobals::FERMION)
+					rowFactor *= lrs_.left().fermionicSign(alpha,int(fermionSign));
+				// without reflection the row is summed as
+				// sum_k A_k (sum_kk B_kk y_j) and added to x[i] once
+				SparseElementType sum = 0.0;
 				for (int k=A.getRowPtr(alpha);k<A.getRowPtr(alpha+1);k++) {
-					int alphaPrime = A.getCol(k);
+					const std::vector<int>& bufferRow = buffer_[A.getCol(k)];
+					if (bufferRow.size()==0) continue;
+					SparseElementType partial = 0.0;
 					for (int kk=B.getRowPtr(beta);kk<B.getRowPtr(beta+1);kk++) {
-						int betaPrime= B.getCol(kk);
-						int j = buffer_[alphaPrime][betaPrime];
+						int j = bufferRow[B.getCol(kk)];
 						if (j<0) continue;
-						
-						/* fermion signs note:
-						   here the environ is applied first and has to "cross"
-						   the system, hence the sign factor pSprime.fermionicSign(alpha,tmp)
-						 */
-						SparseElementType tmp = A.getValue(k) * B.getValue(kk)*link.value;
-						
-						if (link.fermionOrBoson == ProgramGlobals::FERMION)
-							tmp *= lrs_.left().fermionicSign(alpha,int(fermionSign));
-						//if (tmp==static_cast<MatrixElementType>(0.0)) continue;
-						reflection_.elementMultiplication(tmp , x,y,i,j);
-						//matrixBlock.pushCol(j-offset);
-						//matrixBlock.pushValue(tmp);
+						if (useReflection) {
+							SparseElementType tmp = A.getValue(k) * B.getValue(kk)*rowFactor;
+							reflection_.elementMultiplication(tmp , x,y,i,j);
+							continue;
+						}
+						VectorKernels::multiplyAdd(partial,B.getValue(kk),y[j]);
 					}
+					VectorKernels::multiplyAdd(sum,A.getValue(k),partial);
 				}
+				if (!useReflection) VectorKernels::multiplyAdd(x[ii],rowFactor,sum);
 			}
 		}
 
@@ -291,60 +381,97 @@ namespace Dmrg {
 		//! Has been changed to accomodate for reflection symmetry
 		void hamiltonianLeftProduct(std::vector<SparseElementType> &x,std::vector<SparseElementType> const &y) const 
 		{ 
-			int m = m_;
-			int offset = lrs_.super().partition(m);
-			int i,k,alphaPrime;
-			int bs = lrs_.super().partition(m+1)-offset;
-			SparseMatrixType hamiltonian = lrs_.left().hamiltonian();
-			size_t ns = lrs_.left().size();
+			const SparseMatrixType& hamiltonian = lrs_.left().hamiltonian();
+			ParallelProduct parallelProduct(*this,LEFT_PRODUCT,x,y,hamiltonian);
+			// with reflection a row also writes to other rows
+			if (reflection_.useReflection())
+				parallelProduct.thread_function_(0,rows_.size(),0);
+			else
+				Threads::loopCreate(rows_.size(),parallelProduct);
+		}
 
-			PackIndicesType pack(ns);
-			for (i=0;i<bs;i++) {
+		//! Let  H_{alpha,beta; alpha',beta'} = basis2.hamiltonian_{beta,beta'} \delta_{alpha,alpha'}
+		//! Let H_m be  the m-th block (in the ordering of basis1) of H
+		//! Then, this function does x += H_m * y
+		//! This is a performance critical function
+		void hamiltonianRightProduct(std::vector<SparseElementType> &x,std::vector<SparseElementType> const &y) const 
+		{ 
+			const SparseMatrixType& hamiltonian = lrs_.right().hamiltonian();
+			ParallelProduct parallelProduct(*this,RIGHT_PRODUCT,x,y,hamiltonian);
+			if (reflection_.useReflection())
+				parallelProduct.thread_function_(0,rows_.size(),0);
+			else
+				Threads::loopCreate(rows_.size(),parallelProduct);
+		}
+
+		//! hamiltonianLeftProduct for rows_[start] up to rows_[end-1]
+		void hamiltonianLeftRows(std::vector<SparseElementType> &x,
+		                         std::vector<SparseElementType> const &y,
+		                         const SparseMatrixType& hamiltonian,
+		                         size_t start,
+		                         size_t end) const
+		{
+			int k,alphaPrime;
+			bool useReflection = reflection_.useReflection();
+
+			for (size_t ii=start;ii<end;ii++) {
+				int i = rows_[ii];
 				if (reflection_.outsideReflectionBounds(i)) continue;
-				size_t r,beta;
-				pack.unpack(r,beta,lrs_.super().permutation(i+offset));
+				size_t r = alpha_[ii];
+				size_t beta = beta_[ii];
 
 				// row i of the ordered product basis
+				SparseElementType sum = 0.0;
 				for (k=hamiltonian.getRowPtr(r);k<hamiltonian.getRowPtr(r+1);k++) {
 					alphaPrime = hamiltonian.getCol(k);
 					//j = basis1_.permutationInverse(alphaPrime + betaPrimeNs)-offset;
 					//if (j<0 || j>=bs) continue;
-					int j = buffer_[alphaPrime][beta];
+					const std::vector<int>& bufferRow = buffer_[alphaPrime];
+					if (bufferRow.size()==0) continue;
+					int j = bufferRow[beta];
 					if (j<0) continue;
-					reflection_.elementMultiplication(hamiltonian.getValue(k), x,y,i,j);
+					if (useReflection)
+						reflection_.elementMultiplication(hamiltonian.getValue(k), x,y,i,j);
+					else
+						VectorKernels::multiplyAdd(sum,hamiltonian.getValue(k),y[j]);
 				}
+				if (!useReflection) x[ii] += sum;
 			}
 		}
 
-		//! Let  H_{alpha,beta; alpha',beta'} = basis2.hamiltonian_{beta,beta'} \delta_{alpha,alpha'}
-		//! Let H_m be  the m-th block (in the ordering of basis1) of H
-		//! Then, this function does x += H_m * y
-		//! This is a performance critical function
-		void hamiltonianRightProduct(std::vector<SparseElementType> &x,std::vector<SparseElementType> const &y) const 
-		{ 
-			int m = m_;
-			int offset = lrs_.super().partition(m);
-			int i,k;
-			int bs = lrs_.super().partition(m+1)-offset;
-			SparseMatrixType hamiltonian = lrs_.right().hamiltonian();
-			size_t ns = lrs_.left().size();
+		//! hamiltonianRightProduct for rows_[start] up to rows_[end-1]
+		void hamiltonianRightRows(std::vector<SparseElementType> &x,
+		                          std::vector<SparseElementType> const &y,
+		                          const SparseMatrixType& hamiltonian,
+		                          size_t start,
+		                          size_t end) const
+		{
+			int k;
+			bool useReflection = reflection_.useReflection();
 
-			PackIndicesType pack(ns);
-			for (i=0;i<bs;i++) {
+			for (size_t ii=start;ii<end;ii++) {
+				int i = rows_[ii];
 				if (reflection_.outsideReflectionBounds(i)) continue;
-				size_t alpha,r;
-				pack.unpack(alpha,r,lrs_.super().permutation(i+offset));
+				size_t alpha = alpha_[ii];
+				size_t r = beta_[ii];
 
 				// row i of the ordered product basis
+				const std::vector<int>& bufferRow = buffer_[alpha];
+				if (bufferRow.size()==0) continue;
+				SparseElementType sum = 0.0;
 				for (k=hamiltonian.getRowPtr(r);k<hamiltonian.getRowPtr(r+1);k++) {
 					
 					//betaPrimeNs  = hamiltonian.getCol(k) *ns;
 					//j = basis1_.permutationInverse(alpha + betaPrimeNs)-offset;
 					//if (j<0 || j>=bs) continue;
-					int j = buffer_[alpha][hamiltonian.getCol(k)];
+					int j = bufferRow[hamiltonian.getCol(k)];
 					if (j<0) continue;
-					reflection_.elementMultiplication(hamiltonian.getValue(k) , x,y,i,j);
+					if (useReflection)
+						reflection_.elementMultiplication(hamiltonian.getValue(k) , x,y,i,j);
+					else
+						VectorKernels::multiplyAdd(sum,hamiltonian.getValue(k),y[j]);
 				}
+				if (!useReflection) x[ii] += sum;
 			}
 		}
 
@@ -354,19 +481,14 @@ namespace Dmrg {
 		//! Note: USed only for debugging
 		void calcHamiltonianPart(SparseMatrixType &matrixBlock,bool option) const 
 		{ 
+			checkAllRows("calcHamiltonianPart");
 			int m  = m_;
 			size_t offset = lrs_.super().partition(m);
 			int k,alphaPrime=0,betaPrime=0;
 			int bs = lrs_.super().partition(m+1)-offset;
 			size_t ns=lrs_.left().size();
-			SparseMatrixType hamiltonian;
-			if (option) {
-				hamiltonian = lrs_.left().hamiltonian();
-				//ns = basis2_.size();
-			} else {
-				hamiltonian = lrs_.right().hamiltonian();
-				//ns = 
-			}
+			const SparseMatrixType& hamiltonian = (option) ? lrs_.left().hamiltonian() :
+			                                                 lrs_.right().hamiltonian();
 			std::cerr<<__FILE__<<":"<<__LINE__<<":\n";
 			PsimagLite::Matrix<SparseElementType> fullm;
 			crsMatrixToFullMatrix(fullm,hamiltonian);
@@ -434,22 +556,109 @@ namespace Dmrg {
 		}
 
 	private:
+
+		//! Does rows of hamiltonianLeftProduct or hamiltonianRightProduct,
+		//! each chunk of rows can be done by a different thread
+		class ParallelProduct {
+		public:
+			ParallelProduct(const ModelHelperLocal& modelHelper,
+			                size_t kind,
+			                std::vector<SparseElementType>& x,
+			                const std::vector<SparseElementType>& y,
+			                const SparseMatrixType& hamiltonian)
+			: modelHelper_(modelHelper),kind_(kind),x_(x),y_(y),hamiltonian_(hamiltonian)
+			{}
+
+			void thread_function_(size_t threadNum,size_t blockSize,pthread_mutex_t*)
+			{
+				size_t total = modelHelper_.rows_.size();
+				size_t start = threadNum*blockSize;
+				if (start>=total) return;
+				size_t end = start + blockSize;
+				if (end>total) end = total;
+				if (kind_==LEFT_PRODUCT)
+					modelHelper_.hamiltonianLeftRows(x_,y_,hamiltonian_,start,end);
+				else
+					modelHelper_.hamiltonianRightRows(x_,y_,hamiltonian_,start,end);
+			}
+
+		private:
+			const ModelHelperLocal& modelHelper_;
+			size_t kind_;
+			std::vector<SparseElementType>& x_;
+			const std::vector<SparseElementType>& y_;
+			const SparseMatrixType& hamiltonian_;
+		}; // class ParallelProduct
+
+		//! Sets rows of buffer_, each row can be done by a different thread;
+		//! buffer_ is read by all threads, and this way its rows are
+		//! spread over the memory of all threads
+		class ParallelBuffer {
+		public:
+			ParallelBuffer(ModelHelperLocal& modelHelper)
+			: modelHelper_(modelHelper)
+			{}
+
+			void thread_function_(size_t threadNum,size_t blockSize,pthread_mutex_t*)
+			{
+				for (size_t p=0;p<blockSize;p++) {
+					size_t alphaPrime = threadNum*blockSize + p;
+					if (alphaPrime>=modelHelper_.buffer_.size()) break;
+					modelHelper_.createBufferRow(alphaPrime);
+				}
+			}
+
+		private:
+			ModelHelperLocal& modelHelper_;
+		}; // class ParallelBuffer
+
+		friend class ParallelProduct;
+		friend class ParallelBuffer;
+
 		int m_;
 		const LeftRightSuperType&  lrs_;
 		std::vector<std::vector<int> > buffer_;
-		std::vector<SparseMatrixType> basis2tc_,basis3tc_;
+		// transposes are made on first use, since only the operators
+		// in links are needed, and the others may not even be explicit
+		mutable std::vector<SparseMatrixType> basis2tc_,basis3tc_;
+		mutable std::vector<bool> basis2tcDone_,basis3tcDone_;
 		std::vector<size_t> alpha_,beta_;
 		ReflectionSymmetryType reflection_;
 		size_t numberOfOperators_;
+		std::vector<size_t> rows_;
 		//RightLeftLocalType rightLeftLocal_;
 		
+		//! The matrices of partition m are only made by an object for all
+		//! its rows: the tables of the other constructor are per owned row
+		void checkAllRows(const std::string& caller) const
+		{
+			size_t total = lrs_.super().partition(m_+1)-lrs_.super().partition(m_);
+			if (rows_.size()==total) return;
+			throw std::runtime_error("ModelHelperLocal::" + caller +
+				"(...): needs all the rows of the partition, see distributedMatvec\n");
+		}
+
 		const SparseMatrixType& getTcOperator(int i,size_t type) const
 		{
-			if (type==System) return basis2tc_[i];
-			return basis3tc_[i];
+			std::vector<SparseMatrixType>& basistc = (type==System) ? basis2tc_ : basis3tc_;
+			std::vector<bool>& done = (type==System) ? basis2tcDone_ : basis3tcDone_;
+			// the threads of the matrix vector product only read it,
+			// see ModelCommon::hamiltonianConnectionProduct
+			if (!done[i]) {
+				const BasisWithOperatorsType& basis = (type==System) ? lrs_.left() : lrs_.right();
+				transposeConjugate(basistc[i],basis.getOperatorByIndex(i).data);
+				done[i] = true;
+			}
+			return basistc[i];
 		}
 		
 		void createBuffer() 
+		{
+			ParallelBuffer parallelBuffer(*this);
+			Threads::loopCreate(buffer_.size(),parallelBuffer);
+		}
+
+		void createBufferRow(size_t alphaPrime)
 		{
 			size_t ns=lrs_.left().size();
 			size_t ne=lrs_.right().size();
@@ -457,36 +666,47 @@ namespace Dmrg {
 			int total = lrs_.super().partition(m_+1) - offset;
 
 			std::vector<int>  tmpBuffer(ne);
-			for (size_t alphaPrime=0;alphaPrime<ns;alphaPrime++) {
-				for (size_t betaPrime=0;betaPrime<ne;betaPrime++) {	
-					tmpBuffer[betaPrime] =lrs_.super().
-							permutationInverse(alphaPrime + betaPrime*ns) -
-								offset;
-					if (tmpBuffer[betaPrime]>=total) tmpBuffer[betaPrime]= -1 ;
-				}
-				buffer_[alphaPrime]=tmpBuffer;
+			for (size_t betaPrime=0;betaPrime<ne;betaPrime++) {
+				tmpBuffer[betaPrime] =lrs_.super().
+						permutationInverse(alphaPrime + betaPrime*ns) -
+							offset;
+				if (tmpBuffer[betaPrime]>=total) tmpBuffer[betaPrime]= -1 ;
 			}
+			buffer_[alphaPrime]=tmpBuffer;
 		}
 
-		void createTcOperators(std::vector<SparseMatrixType>& basistc,
-				const BasisWithOperatorsType& basis)
+		void createAlphaAndBeta()
 		{
-			for (size_t i=0;i<basistc.size();i++)
-				transposeConjugate( basistc[i],basis.getOperatorByIndex(i).data);
+			size_t ns=lrs_.left().size();
+			int offset = lrs_.super().partition(m_);
+
+			PackIndicesType pack(ns);
+			for (size_t ii=0;ii<rows_.size();ii++) {
+				// row rows_[ii] of the ordered product basis
+				pack.unpack(alpha_[ii],beta_[ii],
+						lrs_.super().permutation(rows_[ii]+offset));
+			}
 		}
 
-		void createAlphaAndBeta()
+		void addColumn(std::vector<size_t>& cols,size_t alphaPrime,size_t betaPrime) const
 		{
 			size_t ns=lrs_.left().size();
 			int offset = lrs_.super().partition(m_);
 			int total = lrs_.super().partition(m_+1) - offset;
+			int j = lrs_.super().permutationInverse(alphaPrime + betaPrime*ns) - offset;
+			if (j<0 || j>=total) return;
+			cols.push_back(j);
+		}
 
+		void setBufferEntry(size_t j,size_t index)
+		{
+			size_t ns=lrs_.left().size();
+			size_t alphaPrime,betaPrime;
 			PackIndicesType pack(ns);
-			for (int i=0;i<total;i++) {
-				// row i of the ordered product basis
-				pack.unpack(alpha_[i],beta_[i],
-						lrs_.super().permutation(i+offset));
-			}
+			pack.unpack(alphaPrime,betaPrime,lrs_.super().permutation(j+lrs_.super().partition(m_)));
+			std::vector<int>& bufferRow = buffer_[alphaPrime];
+			if (bufferRow.size()==0) bufferRow.resize(lrs_.right().size(),-1);
+			bufferRow[betaPrime] = index;
 		}
 	}; // class ModelHelperLocal
 } // namespace Dmrg
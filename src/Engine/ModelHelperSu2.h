@@ -128,6 +128,9 @@ namespace Dmrg {
 
 		static bool isSu2() { return true; }
 
+		//! x+=Hy is only for whole partitions, see ModelHelperLocal
+		enum {DISTRIBUTED = 0};
+
 //		const BasisType& basis1() const { return basis1_; }
 //
 //		const BasisWithOperatorsType& basis2() const  { return basis2_; }
@@ -107,13 +107,14 @@ namespace Dmrg {
 				bool hasTimeEvolution,
 				const ModelType& model,
 				ConcurrencyType& concurrency,
-				bool verbose)
+				bool verbose,
+				bool streaming = false)
 		: numberOfSites_(numberOfSites),
 		  hasTimeEvolution_(hasTimeEvolution),
 		  model_(model),
 		  concurrency_(concurrency),
 		  observe_(io,numberOfSites-2,hasTimeEvolution,model,
-				  concurrency,verbose),
+				  concurrency,verbose,streaming),
 				 szsz_(0,0)
 		{
 			if (hasTimeEvolution) {
@@ -129,61 +130,26 @@ namespace Dmrg {
 			// as opposed to the TimeSerializer
 			if (hasTimeEvolution_) printSites();
 
-			if (label=="cc") {
-				MatrixType opC = model_.getOperator("c",0,0); // c_{0,0} spin up
-				MatrixType opCtranspose = transposeConjugate(opC);
-				measureOne("OperatorC",opC,opCtranspose,-1,rows,cols);
-			} else if (label=="nn") {
-				MatrixType opN = model_.getOperator("n");
-				measureOne("OperatorN",opN,opN,1,rows,cols);
-			} else if (label=="szsz") {
-				MatrixType Sz = model_.getOperator("z");
-				szsz_ = observe_.correlations(Sz,Sz,1,rows,cols);
-				if (concurrency_.root()) {
-					std::cout<<"OperatorSz:\n";
-					std::cout<<szsz_;
-				}
-			} else if (label=="s+s-") {
-				// Si^+ Sj^-
-				const MatrixType& sPlus = model_.getOperator("+");
-				MatrixType sPlusT = transposeConjugate(sPlus);
-				sPlusSminus_ = observe_.correlations(sPlus,sPlusT,1,rows,cols);
+			std::string name;
+			MatrixType op1,op2;
+			int fermionSign = 1;
+			if (twoPoint(name,op1,op2,fermionSign,label)) {
+				const MatrixType& v =
+					observe_.correlations(op1,op2,fermionSign,rows,cols);
+				// the spin ones are kept for ss, and printed without the time
+				bool spin = keepSpin(name,v);
 				if (concurrency_.root()) {
-						std::cout<<"OperatorSplus:\n";
-						std::cout<<sPlusSminus_;
-					}
-			} else if (label=="s-s+") {
-				// Si^- Sj^+
-				const MatrixType& sMinus = model_.getOperator("-");
-				MatrixType sMinusT = transposeConjugate(sMinus);
-				sMinusSplus_= observe_.correlations(sMinus,sMinusT,1,rows,cols);
-				if (concurrency_.root()) {
-					std::cout<<"OperatorSminus:\n";
-					std::cout<<sMinusSplus_;
+					if (hasTimeEvolution_ && !spin)
+						std::cout<<"#Time="<<observe_.time()<<"\n";
+					std::cout<<name<<":\n";
+					std::cout<<v;
 				}
 			} else if (label=="ss") {
 				if (szsz_.n_row()==0) measure("szsz",rows,cols);
 				if (sPlusSminus_.n_row()==0)  measure("s+s-",rows,cols);
 				if (sMinusSplus_.n_row()==0)  measure("s-s+",rows,cols);
 
-				MatrixType spinTotal(szsz_.n_row(),szsz_.n_col());
-
-				for (size_t i=0;i<spinTotal.n_row();i++)
-					for (size_t j=0;j<spinTotal.n_col();j++)
-						spinTotal(i,j) = 0.5*(sPlusSminus_(i,j) +
-								sMinusSplus_(i,j)) + szsz_(i,j);
-
-				if (concurrency_.root()) {
-					std::cout<<"SpinTotal:\n";
-					std::cout<<spinTotal;
-				}
-			} else if (label=="dd") {
-
-				const MatrixType& oDelta = model_.getOperator("d");
-				MatrixType oDeltaT;
-				transposeConjugate(oDeltaT,oDelta);
-				measureOne("TWO-POINT DELTA-DELTA^DAGGER",oDelta,oDeltaT,1,
-						rows,cols);
+				printSpinTotal();
 			} else if (label=="dd4") {
 				for (size_t g=0;g<16;g++) {
 					std::vector<FieldType> fpd;
@@ -205,6 +171,43 @@ namespace Dmrg {
 			}
 		}
 
+		//! Same as measure(label,rows,cols) for each label, but
+		//! in streaming mode all of them are measured in one pass
+		void measure(const std::vector<std::string>& labels,size_t rows,size_t cols)
+		{
+			if (!observe_.streaming()) {
+				for (size_t i=0;i<labels.size();i++)
+					measure(labels[i],rows,cols);
+				return;
+			}
+
+			std::vector<std::string> names;
+			std::vector<size_t> ids;
+			bool spinTotal = false;
+			for (size_t i=0;i<labels.size();i++) {
+				if (labels[i]=="ss") {
+					addStreaming(names,ids,"szsz",rows,cols);
+					addStreaming(names,ids,"s+s-",rows,cols);
+					addStreaming(names,ids,"s-s+",rows,cols);
+					spinTotal = true;
+					continue;
+				}
+				addStreaming(names,ids,labels[i],rows,cols);
+			}
+
+			observe_.streamCorrelations();
+
+			for (size_t i=0;i<names.size();i++) {
+				const MatrixType& v = observe_.streamedCorrelations(ids[i]);
+				keepSpin(names[i],v);
+				if (concurrency_.root()) {
+					std::cout<<names[i]<<":\n";
+					std::cout<<v;
+				}
+			}
+			if (spinTotal) printSpinTotal();
+		}
+
 		void measureTime(const std::string& label)
 		{
 			SparseMatrixType A;
@@ -241,22 +244,94 @@ namespace Dmrg {
 
 	private:
 
-		void measureOne(
+		void printSpinTotal()
+		{
+			MatrixType spinTotal(szsz_.n_row(),szsz_.n_col());
+
+			for (size_t i=0;i<spinTotal.n_row();i++)
+				for (size_t j=0;j<spinTotal.n_col();j++)
+					spinTotal(i,j) = 0.5*(sPlusSminus_(i,j) +
+							sMinusSplus_(i,j)) + szsz_(i,j);
+
+			if (concurrency_.root()) {
+				std::cout<<"SpinTotal:\n";
+				std::cout<<spinTotal;
+			}
+		}
+
+		//! The correlation O1_i O2_j of a two-point label: its name in the
+		//! output, the operators and the fermion sign; false if label is
+		//! not one of them
+		bool twoPoint(std::string& name,
+		              MatrixType& op1,
+		              MatrixType& op2,
+		              int& fermionSign,
+		              const std::string& label) const
+		{
+			fermionSign = 1;
+			if (label=="cc") {
+				name = "OperatorC";
+				op1 = model_.getOperator("c",0,0); // c_{0,0} spin up
+				fermionSign = -1;
+			} else if (label=="nn") {
+				name = "OperatorN";
+				op1 = model_.getOperator("n");
+			} else if (label=="szsz") {
+				name = "OperatorSz";
+				op1 = model_.getOperator("z");
+			} else if (label=="s+s-") {
+				// Si^+ Sj^-
+				name = "OperatorSplus";
+				op1 = model_.getOperator("+");
+			} else if (label=="s-s+") {
+				// Si^- Sj^+
+				name = "OperatorSminus";
+				op1 = model_.getOperator("-");
+			} else if (label=="dd") {
+				name = "TWO-POINT DELTA-DELTA^DAGGER";
+				op1 = model_.getOperator("d");
+			} else {
+				return false;
+			}
+			// nn and szsz use the operator itself as it's hermitian
+			if (label=="nn" || label=="szsz") op2 = op1;
+			else transposeConjugate(op2,op1);
+			return true;
+		}
+
+		//! Keeps v if name is that of one of the parts of ss
+		bool keepSpin(const std::string& name,const MatrixType& v)
+		{
+			if (name=="OperatorSz") szsz_ = v;
+			else if (name=="OperatorSplus") sPlusSminus_ = v;
+			else if (name=="OperatorSminus") sMinusSplus_ = v;
+			else return false;
+			return true;
+		}
+
+		// Adds the two-point label to the streaming pass, unless already there
+		void addStreaming(
+			std::vector<std::string>& names,
+			std::vector<size_t>& ids,
 			const std::string& label,
-			const PsimagLite::Matrix<FieldType>& op1,
-			const PsimagLite::Matrix<FieldType>& op2,
-			int fermionSign,
 			size_t rows,
 			size_t cols)
 		{
-			const MatrixType& v =
-				observe_.correlations(op1,op2,fermionSign,rows,cols);;
-			if (concurrency_.root()) {
-				if (hasTimeEvolution_)
-					std::cout<<"#Time="<<observe_.time()<<"\n";
-				std::cout<<label<<":\n";
-				std::cout<<v;
+			std::string name;
+			MatrixType op1,op2;
+			int fermionSign = 1;
+			if (!twoPoint(name,op1,op2,fermionSign,label)) {
+				if (label=="dd4") throw std::runtime_error("ObservableLibrary::measure(...):"
+					" dd4 cannot be measured in streaming mode\n");
+				std::string s = "Unknown label: " + label + "\n";
+				throw std::runtime_error(s.c_str());
 			}
+
+			for (size_t i=0;i<names.size();i++)
+				if (names[i]==name) return;
+			names.push_back(name);
+			ids.push_back(observe_.addCorrelations(op1,op2,fermionSign,
+					rows,cols));
 		}
 
 		void measureTimeObsOne(
@@ -86,6 +86,7 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 #include "CorrelationsSkeleton.h"
 #include "TwoPointCorrelations.h"
 #include "FourPointCorrelations.h"
+#include "StreamingCorrelations.h"
 #include "VectorWithOffsets.h" // for operator*
 #include "VectorWithOffset.h" // for operator*
 #include "Profiling.h"
@@ -116,6 +117,8 @@ namespace Dmrg {
 			TwoPointCorrelationsType;
 		typedef FourPointCorrelations<CorrelationsSkeletonType>
 			FourPointCorrelationsType;
+		typedef StreamingCorrelations<CorrelationsSkeletonType>
+			StreamingCorrelationsType;
 		typedef PsimagLite::Profiling ProfilingType;
 
 		static size_t const GROW_RIGHT = CorrelationsSkeletonType::GROW_RIGHT;
@@ -128,20 +131,24 @@ namespace Dmrg {
 			RIGHT_BRACKET=ObserverHelperType::RIGHT_BRACKET};
 
 	public:
+		//! If streaming is true only one record is kept in memory, and
+		//! only the correlations added with addCorrelations can be measured
 		Observer(
 				IoInputType& io,
 				size_t nf,
 				bool hasTimeEvolution,
 				const ModelType& model,
 				ConcurrencyType& concurrency,
-				bool verbose=false)
-		: helper_(io,nf,hasTimeEvolution,verbose),
+				bool verbose=false,
+				bool streaming=false)
+		: helper_(io,nf,hasTimeEvolution,verbose,(streaming) ? 1 : 0),
 		  concurrency_(concurrency),
 		  verbose_(verbose),
 		  onepoint_(helper_),
 		  skeleton_(helper_,model,verbose),
 		  twopoint_(helper_,skeleton_,concurrency_),
-		  fourpoint_(helper_,skeleton_)
+		  fourpoint_(helper_,skeleton_),
+		  streaming_(helper_,skeleton_,verbose)
 		{}
 
 		size_t size() const { return helper_.size(); }
@@ -154,6 +161,8 @@ namespace Dmrg {
 
 		bool endOfData() const { return helper_.endOfData(); }
 
+		bool streaming() const { return helper_.streaming(); }
+
 		// return true if
 		// we're at site 1 or n-2
 		bool isAtCorner(size_t numberOfSites) const
@@ -180,6 +189,29 @@ namespace Dmrg {
 			return twopoint_(O1,O2,fermionicSign,rows,cols);
 		}
 
+		//! Streaming: O1_i O2_j will be measured by streamCorrelations()
+		size_t addCorrelations(
+				const MatrixType& O1,
+				const MatrixType& O2,
+				int fermionicSign,
+				size_t rows,
+				size_t cols)
+		{
+			return streaming_.add(O1,O2,fermionicSign,rows,cols);
+		}
+
+		//! Streaming: measures all added correlations reading each
+		//! record once; can be called only once
+		void streamCorrelations()
+		{
+			streaming_();
+		}
+
+		const PsimagLite::Matrix<FieldType>& streamedCorrelations(size_t id) const
+		{
+			return streaming_.result(id);
+		}
+
 		FieldType fourPoint(
 				char mod1,size_t i1,const MatrixType& O1,
 				char mod2,size_t i2,const MatrixType& O2,
@@ -256,6 +288,7 @@ namespace Dmrg {
 		CorrelationsSkeletonType skeleton_;
 		TwoPointCorrelationsType twopoint_;
 		FourPointCorrelationsType fourpoint_;
+		StreamingCorrelationsType streaming_;
 	};  //class Observer
 } // namespace Dmrg
 
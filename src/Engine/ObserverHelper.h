@@ -87,6 +87,7 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 #include "DmrgSerializer.h"
 #include "VectorWithOffsets.h" // to include norm
 #include "VectorWithOffset.h" // to include norm
+#include "TypeToString.h" // in PsimagLite
 
 namespace Dmrg {
 	template<
@@ -117,18 +118,25 @@ namespace Dmrg {
 		enum {GS_VECTOR,TIME_VECTOR};
 		enum {LEFT_BRACKET=0,RIGHT_BRACKET=1};
 
+		//! window>0 keeps only the last window records in memory,
+		//! see advance()
 		ObserverHelper(
 				IoInputType& io,
 				size_t nf,
 				bool hasTimeEvolution,
-				bool verbose)
+				bool verbose,
+				size_t window = 0)
 			:	io_(io),
 				dSerializerV_(),//(1,DmrgSerializerType(io_,true)),
 				timeSerializerV_(),//(nf),
 				currentPos_(0),
 				verbose_(verbose),
 				bracket_(2,GS_VECTOR),
-				noMoreData_(false)
+				noMoreData_(false),
+				nf_(nf),
+				hasTimeEvolution_(hasTimeEvolution),
+				window_(window),
+				firstPos_(0)
 		{
 			if (!init(hasTimeEvolution,nf)) throw std::runtime_error(
 					"No more data to construct this object\n");
@@ -145,13 +153,38 @@ namespace Dmrg {
 		
 		bool endOfData() const { return noMoreData_; }
 
+		bool streaming() const { return (window_>0); }
+
+		//! Streaming: reads the next record, drops the oldest one
+		//! if more than window records would be kept, and points to
+		//! the new record. Returns false if there are no more records
+		bool advance()
+		{
+			if (noMoreData_ || (nf_>0 && size()>=nf_)) return false;
+			if (!readRecord()) return false;
+			if (window_>0 && dSerializerV_.size()>window_) {
+				delete dSerializerV_[0];
+				dSerializerV_.erase(dSerializerV_.begin());
+				if (timeSerializerV_.size()>0)
+					timeSerializerV_.erase(timeSerializerV_.begin());
+				firstPos_++;
+			}
+			setPointer(size()-1);
+			return true;
+		}
+
 		void setPointer(size_t pos)
 		{
 			//std::cerr<<"POS="<<pos<<"\n";
-			currentPos_=pos;
+			if (window_>0 && (pos<firstPos_ || pos>=size())) {
+				std::string s = "ObserverHelper::setPointer(...): record ";
+				s += ttos(pos) + " is no longer in memory\n";
+				throw std::runtime_error(s.c_str());
+			}
+			currentPos_=pos-firstPos_;
 		}
 
-		size_t getPointer() const { return currentPos_; }
+		size_t getPointer() const { return currentPos_+firstPos_; }
 
 		void setBrackets(size_t left,size_t right)
 		{
@@ -214,7 +247,7 @@ namespace Dmrg {
 		
 		size_t size() const
 		{
-			return dSerializerV_.size(); //-1;
+			return firstPos_+dSerializerV_.size(); //-1;
 		}
 
 		const VectorWithOffsetType&
@@ -246,39 +279,43 @@ namespace Dmrg {
 		{
 
 			dSerializerV_.clear();
-			// the offset is not relevant since for performance reasons
+			// for performance reasons
 			// we need to keep the file open and search forward
 			// without ever rewinding
 			// In other words, file rewinding is left to the user
 			// of the observer/observerhelper class.
-			size_t offset = 0;
-			size_t counter=0;
 			while(true) {
 				if (nf>0 && dSerializerV_.size()==nf) break;
-				if (verbose_)
-					std::cerr<<"ObserverHelper "<<dSerializerV_.size()<<"\n";
-				try {
-					DmrgSerializerType* dSerializer = new 
-						DmrgSerializerType(io_);
-					if (counter>=offset) dSerializerV_.push_back(dSerializer);
-					if (hasTimeEvolution) {
-						TimeSerializerType ts(io_);
-						if (counter>=offset) timeSerializerV_.push_back(ts);
-					}
-					counter++;
-				} catch (std::exception& e)
-				{
-					std::cerr<<"CAUGHT: "<<e.what();
-					noMoreData_ = true;
-					std::cerr<<"Ignore prev. error, if any. It simply means there's no more data\n";
-					break;
-				}
+				if (window_>0 && dSerializerV_.size()==window_) break;
+				if (!readRecord()) break;
 			}
 			if (dSerializerV_.size()==0 && noMoreData_) return false;
 			
 			return true;
 		}
 
+		bool readRecord()
+		{
+			if (verbose_)
+				std::cerr<<"ObserverHelper "<<size()<<"\n";
+			try {
+				DmrgSerializerType* dSerializer = new
+					DmrgSerializerType(io_);
+				dSerializerV_.push_back(dSerializer);
+				if (hasTimeEvolution_) {
+					TimeSerializerType ts(io_);
+					timeSerializerV_.push_back(ts);
+				}
+			} catch (std::exception& e)
+			{
+				std::cerr<<"CAUGHT: "<<e.what();
+				noMoreData_ = true;
+				std::cerr<<"Ignore prev. error, if any. It simply means there's no more data\n";
+				return false;
+			}
+			return true;
+		}
+
 		void integrityChecks()
 		{
 			if (dSerializerV_.size()!=timeSerializerV_.size()) throw std::runtime_error("Error 1\n");
@@ -292,12 +329,6 @@ namespace Dmrg {
 			
 		}
 
-		void getTransform(MatrixType& transform,int ns)
-		{
-			io_.readMatrix(transform,"#TRANSFORM_sites",ns);
-			io_.rewind();
-		}
-
 		void getWaveFunction(VectorType& wavefunction,size_t ns)
 		{
 			VectorWithOffsetType tmpV;
@@ -325,6 +356,10 @@ namespace Dmrg {
 		bool verbose_;
 		std::vector<size_t> bracket_;
 		bool noMoreData_;
+		size_t nf_;
+		bool hasTimeEvolution_;
+		size_t window_;
+		size_t firstPos_;
 	};  //ObserverHelper
 
 	template<
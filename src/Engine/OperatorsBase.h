@@ -138,8 +138,10 @@ namespace Dmrg {
 
 		size_t numberOfOperators() const { return operatorsImpl_.size(); }
 
+		size_t memory() const { return operatorsImpl_.memory(); }
+
 		template<typename TransformElementType,typename ConcurrencyType>
-		void changeBasis(PsimagLite::Matrix<TransformElementType> const &ftransform,
+		void changeBasis(BlockDiagonalMatrix<PsimagLite::Matrix<TransformElementType> > const &ftransform,
 		                 const BasisType* thisBasis,
 		                 ConcurrencyType &concurrency)
 		{
@@ -150,7 +152,7 @@ namespace Dmrg {
 		}
 
 		template<typename TransformElementType>
-		void changeBasis(SparseMatrixType &v,PsimagLite::Matrix<TransformElementType> const &ftransform)
+		void changeBasis(SparseMatrixType &v,BlockDiagonalMatrix<PsimagLite::Matrix<TransformElementType> > const &ftransform)
 		{
 			operatorsImpl_.changeBasis(v,ftransform);
 		}
@@ -182,14 +184,13 @@ namespace Dmrg {
 		}
 
 		template<typename ApplyFactorsType>
-		void externalProduct(size_t i,
-		                     const OperatorType& m,
-		                     int x,
-		                     const std::vector<double>& fermionicSigns,
-		                     bool option,
-		                     ApplyFactorsType& apply)
+		void externalProduct(const std::vector<const OperatorType*>& src,
+		                     size_t n2,
+		                     const BasisType& basis2,
+		                     const BasisType& thisBasis,
+		                     const ApplyFactorsType& apply)
 		{
-			operatorsImpl_.externalProduct(i,m,x,fermionicSigns,option,apply);
+			operatorsImpl_.externalProduct(src,n2,basis2,thisBasis,apply);
 		}
 
 		void externalProductReduced(size_t i,
@@ -202,9 +203,12 @@ namespace Dmrg {
 		}
 
 		template<typename ApplyFactorsType>
-		void outerProductHamiltonian(const SparseMatrixType& h2,const SparseMatrixType& h3,ApplyFactorsType& apply)
+		void outerProductHamiltonian(const SparseMatrixType& h2,
+		                             const SparseMatrixType& h3,
+		                             const BasisType& thisBasis,
+		                             const ApplyFactorsType& apply)
 		{
-			operatorsImpl_.outerProductHamiltonian(h2,h3,apply);
+			operatorsImpl_.outerProductHamiltonian(h2,h3,thisBasis,apply);
 		}
 
 		void outerProductHamiltonianReduced(const BasisType& basis2,
@@ -82,7 +82,11 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 #ifndef OPERATOR_IMPL_H
 #define OPERATOR_IMPL_H
 
+#include <algorithm>
+#include <map>
 #include "ReducedOperators.h"
+#include "Threads.h"
+#include "BlockDiagonalMatrix.h"
 
 namespace Dmrg {
 	//! 
@@ -103,35 +107,51 @@ namespace Dmrg {
 			: useSu2Symmetry_(DmrgBasisType::useSu2Symmetry()),
 			  reducedOpImpl_(io,level,thisBasis,dof,orbitals) 
 		{
-			if (!useSu2Symmetry_)
+			if (!useSu2Symmetry_) {
 				io.read(operators_,"#OPERATORS");
-			//else reducedOpImpl_.load(io,level);
-
-			io.readMatrix(hamiltonian_,"#HAMILTONIAN");
+				loadSharedAndHamiltonian(io);
+			} else {
+				//reducedOpImpl_.load(io,level);
+				io.readMatrix(hamiltonian_,"#HAMILTONIAN");
+			}
 			reducedOpImpl_.setHamiltonian(hamiltonian_);
 		}
 
 		template<typename IoInputter>
 		void load(IoInputter& io)
 		{
-			if (!useSu2Symmetry_)
+			clearKroneckerFactors();
+			if (!useSu2Symmetry_) {
 				io.read(operators_,"#OPERATORS");
-			else reducedOpImpl_.load(io);
-
-			io.readMatrix(hamiltonian_,"#HAMILTONIAN");
+				loadSharedAndHamiltonian(io);
+			} else {
+				reducedOpImpl_.load(io);
+				io.readMatrix(hamiltonian_,"#HAMILTONIAN");
+			}
 			reducedOpImpl_.setHamiltonian(hamiltonian_);
 		}
 
 		void setOperators(const std::vector<OperatorType>& ops)
 		{
-			if (!useSu2Symmetry_) operators_=ops;
-			else reducedOpImpl_.setOperators(ops);
+			clearKroneckerFactors();
+			sharedWith_.clear();
+			if (!useSu2Symmetry_) {
+				operators_=ops;
+				findSharedOperators();
+			} else {
+				reducedOpImpl_.setOperators(ops);
+			}
 		}
 
+		//! Makes the operator explicit the first time, so threads may
+		//! call this at the same time only for operators already asked
+		//! for once (see ModelCommon::hamiltonianConnectionProduct)
 		const OperatorType& getOperatorByIndex(int i) const 
 		{
 			if (useSu2Symmetry_) throw std::runtime_error("EERRRRRRRRRRRRRRRORRRRRRRRRRRR\n");
-			return operators_[i];
+			size_t r = representative(i);
+			if (kroneckerFactors_.size()>0) materialise(r);
+			return operators_[r];
 		}
 
 		const OperatorType& getReducedOperatorByIndex(int i) const 
@@ -153,7 +173,7 @@ namespace Dmrg {
 		}
 
 		template<typename TransformElementType,typename ConcurrencyType>
-		void changeBasis(PsimagLite::Matrix<TransformElementType> const &ftransform,const DmrgBasisType* thisBasis,
+		void changeBasis(BlockDiagonalMatrix<PsimagLite::Matrix<TransformElementType> > const &ftransform,const DmrgBasisType* thisBasis,
 					ConcurrencyType &concurrency)
 		{
 			size_t total = size();
@@ -163,15 +183,24 @@ namespace Dmrg {
 
 			reducedOpImpl_.prepareTransform(ftransform,thisBasis);
 			size_t dof = total / thisBasis->block().size();	
+			std::vector<size_t> indices;
 			while(concurrency.loop(k)) {
 				if (isExcluded(k,thisBasis,dof)) {
+					if (kroneckerFactors_.size()>0) kroneckerFactors_[k].pending = false;
 					operators_[k].data.resize(ftransform.n_col(),ftransform.n_col());
 					continue;
 				}
-				if (!useSu2Symmetry_) changeBasis(operators_[k].data,ftransform);
-				reducedOpImpl_.changeBasis(k);
+				// shared operators are changed once, in their representative
+				if (representative(k)!=k) continue;
+				indices.push_back(k);
 			}
 
+			// the operators of this process are done by the threads:
+			ParallelChangeBasis<TransformElementType> parallelChangeBasis(*this,indices,ftransform);
+			Threads::loopCreate(indices.size(),parallelChangeBasis);
+			// operators of other processes come from the gather below
+			clearKroneckerFactors();
+
 			if (!useSu2Symmetry_) {
 				gather(operators_,concurrency);
 				broadcast(operators_,concurrency);
@@ -184,20 +213,54 @@ namespace Dmrg {
 			reducedOpImpl_.changeBasisHamiltonian();
 		}
 		
+		//! Changes the basis of operators indices[x], each x can be done
+		//! by a different thread
+		template<typename TransformElementType>
+		class ParallelChangeBasis {
+		public:
+			ParallelChangeBasis(OperatorsImplementation& ops,
+			                    const std::vector<size_t>& indices,
+			                    const BlockDiagonalMatrix<PsimagLite::Matrix<TransformElementType> >& ftransform)
+			: ops_(ops),indices_(indices),ftransform_(ftransform)
+			{}
+
+			void thread_function_(size_t threadNum,size_t blockSize,pthread_mutex_t*)
+			{
+				for (size_t p=0;p<blockSize;p++) {
+					size_t x = threadNum*blockSize + p;
+					if (x>=indices_.size()) break;
+					size_t k = indices_[x];
+					// made explicit only now, and only one per thread at a time
+					if (ops_.kroneckerFactors_.size()>0) ops_.materialise(k);
+					if (!ops_.useSu2Symmetry_)
+						ops_.changeBasis(ops_.operators_[k].data,ftransform_);
+					ops_.reducedOpImpl_.changeBasis(k);
+				}
+			}
+
+		private:
+			OperatorsImplementation& ops_;
+			const std::vector<size_t>& indices_;
+			const BlockDiagonalMatrix<PsimagLite::Matrix<TransformElementType> >& ftransform_;
+		}; // class ParallelChangeBasis
+
 		bool isExcluded(size_t k,const DmrgBasisType* thisBasis,size_t dof)
 		{
 			return false; // disabled for now
 		}
 
-		void changeBasis(SparseMatrixType &v,PsimagLite::Matrix<typename SparseMatrixType::value_type> const &ftransform)
+		void changeBasis(SparseMatrixType &v,BlockDiagonalMatrix<PsimagLite::Matrix<typename SparseMatrixType::value_type> > const &ftransform)
 		{
-			fullMatrixToCrsMatrix(v,transformFullFast(v,ftransform));
+			PsimagLite::Matrix<typename SparseMatrixType::value_type> tmp;
+			ftransform.transform(tmp,v);
+			fullMatrixToCrsMatrix(v,tmp);
 		}
 
 		void reorder(const std::vector<size_t>& permutation)
 		{
+			materialiseAll();
 			for (size_t k=0;k<size();k++) {
-				if (!useSu2Symmetry_) reorder(operators_[k].data,permutation);
+				if (!useSu2Symmetry_ && representative(k)==k) reorder(operators_[k].data,permutation);
 				reducedOpImpl_.reorder(k,permutation);
 			}
 			reorder(hamiltonian_,permutation);
@@ -206,6 +269,8 @@ namespace Dmrg {
 
 		void setToProduct(const DmrgBasisType& basis2, const DmrgBasisType& basis3,size_t x,const DmrgBasisType* thisBasis)
 		{
+			clearKroneckerFactors();
+			sharedWith_.clear();
 			if (!useSu2Symmetry_) operators_.resize(x);
 			reducedOpImpl_.setToProduct(basis2,basis3,x,thisBasis); 
 		}
@@ -215,17 +280,46 @@ namespace Dmrg {
 			reducedOpImpl_.setMomentumOfOperators(momentum);
 		}
 
+		//! Sets operator i to src[i] times the identity for all i, with
+		//! src[i] acting on basis2 for i<n2 and on basis3 otherwise, in the
+		//! order of thisBasis. The products are not formed here: only the
+		//! factors are kept, and each product is made explicit when it is
+		//! first needed, by getOperatorByIndex or by changeBasis.
+		//! Products of the same (shared) operator are shared as well
 		template<typename ApplyFactorsType>
-		void externalProduct(size_t i,const OperatorType& m,int x,const std::vector<double>& fermionicSigns,
-				     bool option,ApplyFactorsType& apply)
+		void externalProduct(const std::vector<const OperatorType*>& src,
+		                     size_t n2,
+		                     const DmrgBasisType& basis2,
+		                     const DmrgBasisType& thisBasis,
+		                     const ApplyFactorsType&)
 		{
-			if (useSu2Symmetry_) std::cerr<<"#######EEEEEEEEERRRRRRRRRRRRRROOOOOOOOOOORRRRRRRRRR\n"; 
-			PsimagLite::externalProduct(operators_[i].data,m.data,x,fermionicSigns,option);
-			// don't forget to set fermion sign and j:
-			operators_[i].fermionSign=m.fermionSign;
-			operators_[i].jm=m.jm;
-			operators_[i].angularFactor=m.angularFactor;
-			apply(operators_[i].data);
+			if (useSu2Symmetry_)
+				throw std::runtime_error("OperatorsImplementation::externalProduct(...): not for SU(2)\n");
+			electrons2_ = basis2.electronsVector();
+			permutation_ = thisBasis.permutationVector();
+			permInverse_ = thisBasis.permutationInverse();
+			kroneckerFactors_.resize(src.size());
+			sharedWith_.resize(src.size());
+			std::map<const OperatorType*,size_t> seen;
+			for (size_t i=0;i<src.size();i++) {
+				const OperatorType& m = *(src[i]);
+				KroneckerFactorType& kf = kroneckerFactors_[i];
+				kf.onBasis2 = (i<n2);
+				kf.pending = false;
+				// bases return the same object for shared operators
+				typename std::map<const OperatorType*,size_t>::iterator it = seen.find(src[i]);
+				sharedWith_[i] = (it==seen.end()) ? i : it->second;
+				if (sharedWith_[i]==i) {
+					seen[src[i]] = i;
+					kf.factor = m.data;
+					kf.pending = true;
+				}
+				// don't forget to set fermion sign and j:
+				operators_[i].data = SparseMatrixType();
+				operators_[i].fermionSign=m.fermionSign;
+				operators_[i].jm=m.jm;
+				operators_[i].angularFactor=m.angularFactor;
+			}
 		}
 
 		void externalProductReduced(size_t i,const DmrgBasisType& basis2,const DmrgBasisType& basis3,bool option,
@@ -234,18 +328,18 @@ namespace Dmrg {
 			reducedOpImpl_.externalProduct(i,basis2,basis3,option,A);
 		}
 
+		//! Sets the hamiltonian to h2 + h3 in the order of thisBasis
 		template<typename ApplyFactorsType>
-		void outerProductHamiltonian(const SparseMatrixType& h2,const SparseMatrixType& h3,ApplyFactorsType& apply)
+		void outerProductHamiltonian(const SparseMatrixType& h2,
+		                             const SparseMatrixType& h3,
+		                             const DmrgBasisType& thisBasis,
+		                             const ApplyFactorsType& apply)
 		{
-			SparseMatrixType tmpMatrix;
 			std::vector<double> ones(h2.rank(),1.0);
-			PsimagLite::externalProduct(hamiltonian_,h2,h3.rank(),ones,true);
-
-			PsimagLite::externalProduct(tmpMatrix,h3,h2.rank(),ones,false);
-
-			hamiltonian_ += tmpMatrix;
-
+			externalProductPermuted(hamiltonian_,&h2,&h3,ones,
+			                        thisBasis.permutationVector(),thisBasis.permutationInverse());
 			apply(hamiltonian_);
+			reducedOpImpl_.reorderHamiltonian(thisBasis.permutationVector());
 		}
 
 		void outerProductHamiltonianReduced(const DmrgBasisType& basis2,const DmrgBasisType& basis3,
@@ -262,31 +356,178 @@ namespace Dmrg {
 
 		const SparseMatrixType& hamiltonian() const { return hamiltonian_; }
 
+		//! approximate bytes used by the operators and the hamiltonian
+		size_t memory() const
+		{
+			typedef ReducedOperators<OperatorType,DmrgBasisType> ReducedOperatorsType;
+			size_t total = ReducedOperatorsType::memoryOf(hamiltonian_) + reducedOpImpl_.memory();
+			for (size_t i=0;i<operators_.size();i++)
+				total += ReducedOperatorsType::memoryOf(operators_[i].data);
+			for (size_t i=0;i<kroneckerFactors_.size();i++)
+				total += ReducedOperatorsType::memoryOf(kroneckerFactors_[i].factor);
+			return total;
+		}
+
 		const SparseMatrixType& reducedHamiltonian() const { return reducedOpImpl_.hamiltonian(); }
 
 		void print(int ind) const
 		{
 			if (!useSu2Symmetry_) {
-				if (ind<0) for (size_t i=0;i<operators_.size();i++) std::cerr<<operators_[i];
-				else std::cerr<<operators_[ind];
+				materialiseAll();
+				if (ind<0) for (size_t i=0;i<operators_.size();i++) std::cerr<<getOperatorByIndex(i);
+				else std::cerr<<getOperatorByIndex(ind);
 			} else {
 				reducedOpImpl_.print(ind);
 			}
 		}
 
+		//! Makes all operators explicit; afterwards the const functions
+		//! do not change this object, so that it can be read by two threads
+		void materialiseAll() const
+		{
+			for (size_t i=0;i<kroneckerFactors_.size();i++) materialise(i);
+		}
+
 		template<typename IoOutputter>
 		void save(IoOutputter& io,const std::string& s) const
 		{
-			if (!useSu2Symmetry_) io.printVector(operators_,"#OPERATORS");
-			else reducedOpImpl_.save(io,s);
+			materialiseAll();
+			if (!useSu2Symmetry_) {
+				// shared operators are saved once, in their representative
+				io.printVector(operators_,"#OPERATORS");
+				io.printline("#HAMILTONIAN_AFTER_SHAREDOPERATORS");
+				io.printVector(sharedWith_,"#SHAREDOPERATORS");
+			} else {
+				reducedOpImpl_.save(io,s);
+			}
 			io.printMatrix(hamiltonian_,"#HAMILTONIAN");
 		}
 
 	private:
+		template<typename> friend class ParallelChangeBasis;
+
+		//! An operator of the product basis that is still
+		//! factor x 1 (onBasis2) or 1 x factor, see externalProduct
+		struct KroneckerFactorType {
+			SparseMatrixType factor;
+			bool onBasis2;
+			bool pending;
+		};
+
 		bool useSu2Symmetry_;
 		ReducedOperators<OperatorType,DmrgBasisType> reducedOpImpl_;
-		std::vector<OperatorType> operators_;
+		mutable std::vector<OperatorType> operators_;
 		SparseMatrixType hamiltonian_;
+		mutable std::vector<KroneckerFactorType> kroneckerFactors_;
+		// operator i is stored in operators_[sharedWith_[i]] and
+		// operators_[i] is empty if sharedWith_[i]!=i; empty if nothing is shared
+		std::vector<size_t> sharedWith_;
+		std::vector<size_t> electrons2_;
+		std::vector<size_t> permutation_;
+		std::vector<size_t> permInverse_;
+
+		//! Makes operator i explicit if it is still in factors
+		void materialise(size_t i) const
+		{
+			KroneckerFactorType& kf = kroneckerFactors_[i];
+			if (!kf.pending) return;
+			OperatorType& op = operators_[i];
+			if (kf.onBasis2) {
+				std::vector<double> ones;
+				externalProductPermuted(op.data,&kf.factor,0,ones,permutation_,permInverse_);
+			} else {
+				std::vector<double> fermionicSigns(electrons2_.size());
+				for (size_t j=0;j<fermionicSigns.size();j++)
+					fermionicSigns[j] = (electrons2_[j]%2==0) ? 1.0 : static_cast<double>(op.fermionSign);
+				externalProductPermuted(op.data,0,&kf.factor,fermionicSigns,permutation_,permInverse_);
+			}
+			kf.factor = SparseMatrixType();
+			kf.pending = false;
+		}
+
+		//! Files written before operators were shared have neither the
+		//! marker nor #SHAREDOPERATORS; the first label that starts with
+		//! #HAMILTONIAN is then that of the Hamiltonian itself
+		template<typename IoInputter>
+		void loadSharedAndHamiltonian(IoInputter& io)
+		{
+			std::string marker;
+			io.readline(marker,"#HAMILTONIAN");
+			if (marker!="_AFTER_SHAREDOPERATORS") {
+				sharedWith_.clear();
+				io>>hamiltonian_;
+				return;
+			}
+			io.read(sharedWith_,"#SHAREDOPERATORS");
+			io.readMatrix(hamiltonian_,"#HAMILTONIAN");
+		}
+
+		size_t representative(size_t i) const
+		{
+			return (sharedWith_.size()==0) ? i : sharedWith_[i];
+		}
+
+		//! Finds operators equal to an earlier one, by hashing the structure
+		//! of their data, and keeps only the earlier one
+		void findSharedOperators()
+		{
+			std::map<size_t,std::vector<size_t> > byHash;
+			sharedWith_.resize(operators_.size());
+			bool shared = false;
+			for (size_t i=0;i<operators_.size();i++) {
+				sharedWith_[i] = i;
+				std::vector<size_t>& candidates = byHash[hashOf(operators_[i].data)];
+				for (size_t c=0;c<candidates.size();c++) {
+					if (!isSameOperator(operators_[candidates[c]],operators_[i])) continue;
+					sharedWith_[i] = candidates[c];
+					break;
+				}
+				if (sharedWith_[i]==i) {
+					candidates.push_back(i);
+					continue;
+				}
+				operators_[i].data = SparseMatrixType();
+				shared = true;
+			}
+			if (!shared) sharedWith_.clear();
+		}
+
+		static size_t hashOf(const SparseMatrixType& m)
+		{
+			size_t h = m.rank();
+			for (size_t i=0;i<m.rank();i++) {
+				h = h*31 + m.getRowPtr(i+1);
+				for (int k=m.getRowPtr(i);k<m.getRowPtr(i+1);k++)
+					h = h*31 + m.getCol(k);
+			}
+			return h;
+		}
+
+		static bool isSameOperator(const OperatorType& a,const OperatorType& b)
+		{
+			if (a.fermionSign!=b.fermionSign || a.jm!=b.jm || a.angularFactor!=b.angularFactor)
+				return false;
+			if (a.su2Related.offset!=b.su2Related.offset ||
+			    a.su2Related.source!=b.su2Related.source ||
+			    a.su2Related.transpose!=b.su2Related.transpose) return false;
+			const SparseMatrixType& ma = a.data;
+			const SparseMatrixType& mb = b.data;
+			if (ma.rank()!=mb.rank() || ma.nonZero()!=mb.nonZero()) return false;
+			if (ma.rank()==0) return true;
+			for (size_t i=0;i<=ma.rank();i++)
+				if (ma.getRowPtr(i)!=mb.getRowPtr(i)) return false;
+			for (int k=0;k<ma.nonZero();k++)
+				if (ma.getCol(k)!=mb.getCol(k) || ma.getValue(k)!=mb.getValue(k)) return false;
+			return true;
+		}
+
+		void clearKroneckerFactors()
+		{
+			kroneckerFactors_.clear();
+			electrons2_.clear();
+			permutation_.clear();
+			permInverse_.clear();
+		}
 		
 		void reorder(SparseMatrixType &v,const std::vector<size_t>& permutation)
 		{
@@ -295,6 +536,66 @@ namespace Dmrg {
 			permute(matrixTmp,v,permutation);
 			permuteInverse(v,matrixTmp,permutation);
 		}
+
+		typedef typename SparseMatrixType::value_type SparseElementType;
+		typedef std::pair<size_t,SparseElementType> ColumnValueType;
+
+		struct LessColumn {
+			bool operator()(const ColumnValueType& a,const ColumnValueType& b) const
+			{
+				return (a.first<b.first);
+			}
+		};
+
+		//! Sets B = a2 x 1 + 1 x a3 in one pass, in the permuted product
+		//! basis: B(x,y) is the unpermuted (permutation[x],permutation[y]) element.
+		//! The unpermuted state i+j*ns is state i of basis2 and j of basis3,
+		//! with ns = a2->rank() or fermionicSigns.size(); a2 or a3 may be null.
+		//! Rows of B have their columns sorted
+		static void externalProductPermuted(SparseMatrixType& B,
+		                                    const SparseMatrixType* a2,
+		                                    const SparseMatrixType* a3,
+		                                    const std::vector<double>& fermionicSigns,
+		                                    const std::vector<size_t>& permutation,
+		                                    const std::vector<size_t>& permInverse)
+		{
+			size_t n = permutation.size();
+			size_t ns = (a2) ? a2->rank() : fermionicSigns.size();
+			if (ns==0 || n%ns!=0)
+				throw std::runtime_error("OperatorsImplementation::externalProductPermuted(...): wrong sizes\n");
+
+			std::vector<ColumnValueType> row;
+			B.resize(n);
+			size_t counter = 0;
+			for (size_t x=0;x<n;x++) {
+				B.setRow(x,counter);
+				size_t r = permutation[x];
+				size_t i = r % ns;
+				size_t j = r / ns;
+				row.clear();
+				if (a2) {
+					for (int k=a2->getRowPtr(i);k<a2->getRowPtr(i+1);k++)
+						row.push_back(ColumnValueType(permInverse[a2->getCol(k)+j*ns],
+						                              a2->getValue(k)));
+				}
+				if (a3) {
+					for (int k=a3->getRowPtr(j);k<a3->getRowPtr(j+1);k++)
+						row.push_back(ColumnValueType(permInverse[i+a3->getCol(k)*ns],
+						                              a3->getValue(k)*fermionicSigns[i]));
+				}
+				std::sort(row.begin(),row.end(),LessColumn());
+				for (size_t k=0;k<row.size();) {
+					size_t col = row[k].first;
+					SparseElementType value = row[k].second;
+					for (k++;k<row.size() && row[k].first==col;k++) value += row[k].second;
+					B.pushCol(col);
+					B.pushValue(value);
+					counter++;
+				}
+			}
+			B.setRow(n,counter);
+			B.checkValidity();
+		}
 	}; //class OperatorsImplementation
 
 } // namespace Dmrg
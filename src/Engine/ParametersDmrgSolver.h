@@ -172,6 +172,8 @@ namespace Dmrg {
 	struct DmrgCheckPoint {
 		bool enabled;
 		std::string filename;
+		size_t every; // finite steps between incremental checkpoints, 0 means none
+		size_t position; // generation of the kept checkpoint to resume from, 0 means the last one
 	};
 
 	std::istream &operator>>(std::istream& is,DmrgCheckPoint& c)
@@ -193,6 +195,8 @@ namespace Dmrg {
 		FieldType tolerance;
 		DmrgCheckPoint checkpoint;
 		size_t nthreads;
+		size_t stackMemory; // in MB, for the bases in the stacks; 0 means no limit
+		std::string scratchDirectory; // for the files of the Lanczos vectors; empty means in memory
 		
 		//! Read Dmrg parameters from inp file
 		template<typename IoInputType>
@@ -214,9 +218,20 @@ namespace Dmrg {
 				io.readline(tolerance,"TruncationTolerance=");
 			if (options.find("checkpoint")!=std::string::npos)
 				io.readline(checkpoint.filename,"CheckpointFilename=");
+			checkpoint.every=0;
+			if (options.find("hasCheckpointEvery")!=std::string::npos)
+				io.readline(checkpoint.every,"CheckpointEvery=");
+			checkpoint.position=0;
+			if (options.find("hasCheckpointPosition")!=std::string::npos)
+				io.readline(checkpoint.position,"CheckpointPosition=");
 			nthreads=1; // provide a default value
 			if (options.find("hasThreads")!=std::string::npos)
 				io.readline(nthreads,"Threads=");
+			stackMemory=0;
+			if (options.find("hasStackMemory")!=std::string::npos)
+				io.readline(stackMemory,"StackMemory=");
+			if (options.find("hasScratchDirectory")!=std::string::npos)
+				io.readline(scratchDirectory,"ScratchDirectory=");
 		} 
 
 	};
@@ -242,6 +257,14 @@ namespace Dmrg {
 		if (parameters.options.find("hasTolerance")!=std::string::npos)
 			os<<"parameters.tolerance="<<parameters.tolerance<<"\n";
 		os<<"parameters.nthreads="<<parameters.nthreads<<"\n";
+		if (parameters.options.find("hasCheckpointEvery")!=std::string::npos)
+			os<<"parameters.checkpoint.every="<<parameters.checkpoint.every<<"\n";
+		if (parameters.options.find("hasCheckpointPosition")!=std::string::npos)
+			os<<"parameters.checkpoint.position="<<parameters.checkpoint.position<<"\n";
+		if (parameters.options.find("hasStackMemory")!=std::string::npos)
+			os<<"parameters.stackMemory="<<parameters.stackMemory<<"\n";
+		if (parameters.options.find("hasScratchDirectory")!=std::string::npos)
+			os<<"parameters.scratchDirectory="<<parameters.scratchDirectory<<"\n";
 		return os;
 	}
 } // namespace Dmrg
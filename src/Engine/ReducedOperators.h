@@ -84,6 +84,7 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 
 #include "Su2SymmetryGlobals.h"
 #include "Operator.h"
+#include "BlockDiagonalMatrix.h"
 
 namespace Dmrg {
 	template<typename OperatorType,typename DmrgBasisType>
@@ -232,7 +233,7 @@ namespace Dmrg {
 			calcFastBasis(fastBasisRight_,basis2,basis3,false,thisBasis_->reducedSize());
 		}
 
-		void prepareTransform(const DenseMatrixType& ftransform,const DmrgBasisType* thisBasis)
+		void prepareTransform(const BlockDiagonalMatrix<DenseMatrixType>& ftransform,const DmrgBasisType* thisBasis)
 		{
 			if (!useSu2Symmetry_) return;
 			size_t nr=thisBasis->reducedSize();
@@ -334,6 +335,20 @@ namespace Dmrg {
 
 		size_t size() const { return reducedOperators_.size(); }
 
+		//! approximate bytes used by the reduced operators and hamiltonian
+		size_t memory() const
+		{
+			size_t total = memoryOf(reducedHamiltonian_);
+			for (size_t i=0;i<reducedOperators_.size();i++)
+				total += memoryOf(reducedOperators_[i].data);
+			return total;
+		}
+
+		static size_t memoryOf(const SparseMatrixType& m)
+		{
+			return (m.rank()+1)*sizeof(int) + m.nonZero()*(sizeof(int)+sizeof(SparseElementType));
+		}
+
 		template<typename ConcurrencyType>
 		void gather(ConcurrencyType& concurrency)
 		{
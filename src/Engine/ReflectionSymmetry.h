@@ -174,6 +174,8 @@ namespace Dmrg {
                 }	
 		
 		// reflection functions below
+		bool useReflection() const { return useReflection_; }
+
 		bool outsideReflectionBounds(int i) const
 		{
 			if (!useReflection_) return false;
@@ -93,6 +93,8 @@ namespace Dmrg {
 
 		bool outsideReflectionBounds(int i) const { return false; }
 
+		bool useReflection() const { return false; }
+
 		void elementMultiplication(SparseElementType value, std::vector<SparseElementType>& x,
 				const std::vector<SparseElementType>& y, int i,int j) const
 		{
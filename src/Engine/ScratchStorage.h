@@ -0,0 +1,315 @@
+// BEGIN LICENSE BLOCK
+/*
+Copyright (c) 2009, UT-Battelle, LLC
+All rights reserved
+
+[DMRG++, Version 2.0.0]
+[by G.A., Oak Ridge National Laboratory]
+
+UT Battelle Open Source Software License 11242008
+
+OPEN SOURCE LICENSE
+
+Subject to the conditions of this License, each
+contributor to this software hereby grants, free of
+charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"), a
+perpetual, worldwide, non-exclusive, no-charge,
+royalty-free, irrevocable copyright license to use, copy,
+modify, merge, publish, distribute, and/or sublicense
+copies of the Software.
+
+1. Redistributions of Software must retain the above
+copyright and license notices, this list of conditions,
+and the following disclaimer.  Changes or modifications
+to, or derivative works of, the Software should be noted
+with comments and the contributor and organization's
+name.
+
+2. Neither the names of UT-Battelle, LLC or the
+Department of Energy nor the names of the Software
+contributors may be used to endorse or promote products
+derived from this software without specific prior written
+permission of UT-Battelle.
+
+3. The software and the end-user documentation included
+with the redistribution, with or without modification,
+must include the following acknowledgment:
+
+"This product includes software produced by UT-Battelle,
+LLC under Contract No. DE-AC05-00OR22725  with the
+Department of Energy."
+ 
+*********************************************************
+DISCLAIMER
+
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT OWNER, CONTRIBUTORS, UNITED STATES GOVERNMENT,
+OR THE UNITED STATES DEPARTMENT OF ENERGY BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+
+NEITHER THE UNITED STATES GOVERNMENT, NOR THE UNITED
+STATES DEPARTMENT OF ENERGY, NOR THE COPYRIGHT OWNER, NOR
+ANY OF THEIR EMPLOYEES, REPRESENTS THAT THE USE OF ANY
+INFORMATION, DATA, APPARATUS, PRODUCT, OR PROCESS
+DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
+
+*********************************************************
+
+
+*/
+// END LICENSE BLOCK
+/** \ingroup DMRG */
+/*@{*/
+
+
+/*! \file ScratchStorage.h
+ *
+ *  Storage for large arrays of numbers, such as the Lanczos (Krylov)
+ *  vectors, that can be larger than the memory. By default an array is
+ *  in memory. If a scratch directory is set (see setDirectory), arrays
+ *  of MINIMUM_BYTES or more are memory-mapped files in it instead, so
+ *  that the system writes their pages to the file, and reads them back,
+ *  as needed. Each file is removed as soon as it is created, so it is
+ *  gone once unmapped, even if the program is killed. These arrays are
+ *  best used in order; the advise functions tell the system so.
+ *
+ *  The element type must be one for which all bits zero is T(), such
+ *  as the real and complex numbers, because new files read as zeros.
+ */
+#ifndef SCRATCH_STORAGE_H
+#define SCRATCH_STORAGE_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "TypeToString.h" // in PsimagLite
+
+namespace Dmrg {
+
+	class ScratchStorage {
+	public:
+
+		enum {NORMAL,SEQUENTIAL,WILL_NEED,DONT_NEED};
+
+		enum {MINIMUM_BYTES = 1048576}; // smaller arrays are always in memory
+
+		//! The directory for the files of large arrays; empty (the
+		//! default) means that all arrays are in memory
+		static void setDirectory(const std::string& dir) { directory_() = dir; }
+
+		static const std::string& directory() { return directory_(); }
+
+		//! A mapping of a new file of bytes bytes, all zeros
+		static void* map(size_t bytes)
+		{
+			std::string name = directory_() + "/dmrgScratchXXXXXX";
+			std::vector<char> tmpl(name.begin(),name.end());
+			tmpl.push_back(0);
+			int fd = mkstemp(&(tmpl[0]));
+			if (fd<0) throw std::runtime_error("ScratchStorage::map(...): cannot create a file in " +
+			                                   directory_() + "\n");
+			unlink(&(tmpl[0]));
+#ifdef __linux__
+			// fails now, and not with SIGBUS later, if the disk is full
+			int ret = posix_fallocate(fd,0,bytes);
+#else
+			int ret = ftruncate(fd,bytes);
+#endif
+			if (ret!=0) {
+				close(fd);
+				throw std::runtime_error("ScratchStorage::map(...): cannot reserve " + ttos(bytes) +
+				                         " bytes in " + directory_() + "\n");
+			}
+			void* p = mmap(0,bytes,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+			close(fd);
+			if (p==MAP_FAILED) throw std::runtime_error("ScratchStorage::map(...): mmap failed\n");
+			return p;
+		}
+
+		static void unmap(void* p,size_t bytes) { munmap(p,bytes); }
+
+		//! Tells the system how the bytes at p, in a mapping, will be used
+		static void advise(void* p,size_t bytes,int how)
+		{
+			if (bytes==0) return;
+			size_t pageSize = sysconf(_SC_PAGESIZE);
+			char* start = static_cast<char*>(p);
+			size_t offset = reinterpret_cast<size_t>(start) % pageSize;
+			start -= offset;
+			if (how==DONT_NEED) {
+				// posix_madvise ignores POSIX_MADV_DONTNEED in glibc;
+				// madvise drops the pages, and since the mapping is a
+				// MAP_SHARED one of a file they are read back when used
+				madvise(start,bytes+offset,MADV_DONTNEED);
+				return;
+			}
+			int advice = POSIX_MADV_NORMAL;
+			if (how==SEQUENTIAL) advice = POSIX_MADV_SEQUENTIAL;
+			else if (how==WILL_NEED) advice = POSIX_MADV_WILLNEED;
+			posix_madvise(start,bytes+offset,advice);
+		}
+
+	private:
+
+		static std::string& directory_()
+		{
+			static std::string dir;
+			return dir;
+		}
+	}; // class ScratchStorage
+
+	//! An array of n elements of T, in memory or in a mapped file,
+	//! see ScratchStorage
+	template<typename T>
+	class ScratchArray {
+	public:
+		typedef T value_type;
+
+		ScratchArray() : data_(0),size_(0),capacity_(0),mapped_(false) {}
+
+		explicit ScratchArray(size_t n) : data_(0),size_(0),capacity_(0),mapped_(false)
+		{
+			resize(n);
+		}
+
+		ScratchArray(const ScratchArray& other)
+		: data_(0),size_(0),capacity_(0),mapped_(false)
+		{
+			resize(other.size_);
+			std::copy(other.data_,other.data_+other.size_,data_);
+		}
+
+		~ScratchArray() { release(); }
+
+		ScratchArray& operator=(const ScratchArray& other)
+		{
+			if (this==&other) return *this;
+			ScratchArray tmp(other);
+			swap(tmp);
+			return *this;
+		}
+
+		void swap(ScratchArray& other)
+		{
+			std::swap(data_,other.data_);
+			std::swap(size_,other.size_);
+			std::swap(capacity_,other.capacity_);
+			std::swap(mapped_,other.mapped_);
+		}
+
+		//! The first min(n,size()) elements keep their values, and
+		//! new ones are zero
+		void resize(size_t n)
+		{
+			if (n<=capacity_) {
+				if (n>size_) std::fill(data_+size_,data_+n,T());
+				size_ = n;
+				return;
+			}
+			ScratchArray tmp;
+			tmp.allocate(n);
+			std::copy(data_,data_+size_,tmp.data_);
+			swap(tmp);
+		}
+
+		size_t size() const { return size_; }
+
+		T& operator[](size_t i) { return data_[i]; }
+
+		const T& operator[](size_t i) const { return data_[i]; }
+
+		bool mapped() const { return mapped_; }
+
+		//! Tells the system how elements first to first+count-1 will be
+		//! used, if in a file; how is one of ScratchStorage's enum
+		void advise(size_t first,size_t count,int how) const
+		{
+			if (!mapped_ || count==0) return;
+			ScratchStorage::advise(data_+first,count*sizeof(T),how);
+		}
+
+	private:
+
+		void allocate(size_t n)
+		{
+			size_t bytes = n*sizeof(T);
+			mapped_ = (ScratchStorage::directory()!="" && bytes>=ScratchStorage::MINIMUM_BYTES);
+			if (mapped_) data_ = static_cast<T*>(ScratchStorage::map(bytes));
+			else data_ = new T[n]();
+			size_ = capacity_ = n;
+		}
+
+		void release()
+		{
+			if (!data_) return;
+			if (mapped_) ScratchStorage::unmap(data_,capacity_*sizeof(T));
+			else delete [] data_;
+			data_ = 0;
+		}
+
+		T* data_;
+		size_t size_;
+		size_t capacity_;
+		bool mapped_;
+	}; // class ScratchArray
+
+	//! A dense matrix by columns, as PsimagLite::Matrix, in a ScratchArray,
+	//! for the Lanczos vectors, one per column
+	template<typename T>
+	class ScratchMatrix {
+	public:
+		typedef T value_type;
+
+		ScratchMatrix() : nrow_(0),ncol_(0) {}
+
+		ScratchMatrix(size_t nrow,size_t ncol) : nrow_(0),ncol_(0) { reset(nrow,ncol); }
+
+		size_t n_row() const { return nrow_; }
+
+		size_t n_col() const { return ncol_; }
+
+		T& operator()(size_t i,size_t j) { return data_[i+j*nrow_]; }
+
+		const T& operator()(size_t i,size_t j) const { return data_[i+j*nrow_]; }
+
+		//! As for PsimagLite::Matrix, with the same number of rows the
+		//! columns that remain keep their values
+		void reset(size_t nrow,size_t ncol)
+		{
+			nrow_ = nrow;
+			ncol_ = ncol;
+			data_.resize(nrow*ncol);
+		}
+
+		void resize(size_t nrow,size_t ncol) { reset(nrow,ncol); }
+
+		void advise(int how) const { data_.advise(0,data_.size(),how); }
+
+		void adviseColumn(size_t j,int how) const { data_.advise(j*nrow_,nrow_,how); }
+
+	private:
+		size_t nrow_,ncol_;
+		ScratchArray<T> data_;
+	}; // class ScratchMatrix
+} // namespace Dmrg
+
+/*@}*/
+#endif // SCRATCH_STORAGE_H
@@ -0,0 +1,293 @@
+// BEGIN LICENSE BLOCK
+/*
+Copyright (c) 2009, UT-Battelle, LLC
+All rights reserved
+
+[DMRG++, Version 2.0.0]
+[by G.A., Oak Ridge National Laboratory]
+
+UT Battelle Open Source Software License 11242008
+
+OPEN SOURCE LICENSE
+
+Subject to the conditions of this License, each
+contributor to this software hereby grants, free of
+charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"), a
+perpetual, worldwide, non-exclusive, no-charge,
+royalty-free, irrevocable copyright license to use, copy,
+modify, merge, publish, distribute, and/or sublicense
+copies of the Software.
+
+1. Redistributions of Software must retain the above
+copyright and license notices, this list of conditions,
+and the following disclaimer.  Changes or modifications
+to, or derivative works of, the Software should be noted
+with comments and the contributor and organization's
+name.
+
+2. Neither the names of UT-Battelle, LLC or the
+Department of Energy nor the names of the Software
+contributors may be used to endorse or promote products
+derived from this software without specific prior written
+permission of UT-Battelle.
+
+3. The software and the end-user documentation included
+with the redistribution, with or without modification,
+must include the following acknowledgment:
+
+"This product includes software produced by UT-Battelle,
+LLC under Contract No. DE-AC05-00OR22725  with the
+Department of Energy."
+ 
+*********************************************************
+DISCLAIMER
+
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT OWNER, CONTRIBUTORS, UNITED STATES GOVERNMENT,
+OR THE UNITED STATES DEPARTMENT OF ENERGY BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+
+NEITHER THE UNITED STATES GOVERNMENT, NOR THE UNITED
+STATES DEPARTMENT OF ENERGY, NOR THE COPYRIGHT OWNER, NOR
+ANY OF THEIR EMPLOYEES, REPRESENTS THAT THE USE OF ANY
+INFORMATION, DATA, APPARATUS, PRODUCT, OR PROCESS
+DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
+
+*********************************************************
+
+
+*/
+// END LICENSE BLOCK
+/** \ingroup DMRG */
+/*@{*/
+
+/*! \file SpillingStack.h
+ *
+ *  A stack of bases with a memory budget: the entries near the top
+ *  stay in memory, and when the entries in memory use more than the
+ *  budget the deepest of them are written to disk, one file per entry,
+ *  and read back when they become the top. Entries are held by
+ *  CopyOnWrite handles, so the top can be shared without copying it.
+ *  DataType must have save(io), a constructor from (io,name,counter)
+ *  and memory(), the approximate number of bytes it uses.
+ *
+ */
+#ifndef SPILLING_STACK_H
+#define SPILLING_STACK_H
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <stdexcept>
+#include <pthread.h>
+#include "IoSimple.h" // in PsimagLite
+#include "TypeToString.h" // in PsimagLite
+#include "CopyOnWrite.h"
+
+namespace Dmrg {
+
+	template<typename DataType,typename IoType=PsimagLite::IoSimple>
+	class SpillingStack {
+
+		typedef typename IoType::In IoInType;
+		typedef typename IoType::Out IoOutType;
+
+	public:
+		typedef CopyOnWrite<DataType> SharedType;
+
+		//! budget is in bytes, 0 means no limit;
+		//! spilled entries go to files named prefix followed by a number
+		SpillingStack(const std::string& prefix,size_t budget)
+		: prefix_(prefix),budget_(budget),bytes_(0),counter_(0),prefetching_(false)
+		{}
+
+		~SpillingStack()
+		{
+			if (prefetching_) pthread_join(thread_,0);
+			for (size_t i=0;i<spilled_.size();i++) std::remove(spilled_[i].c_str());
+		}
+
+		void push(const SharedType& x)
+		{
+			if (prefetching_) finishPrefetch();
+			size_t b = x->memory();
+			resident_.push_back(x);
+			residentBytes_.push_back(b);
+			bytes_ += b;
+			// the top always stays in memory
+			while (budget_>0 && bytes_>budget_ && resident_.size()>1) spill();
+		}
+
+		void pop()
+		{
+			if (resident_.size()==0)
+				throw std::runtime_error("SpillingStack::pop(): empty stack\n");
+			bytes_ -= residentBytes_.back();
+			resident_.pop_back();
+			residentBytes_.pop_back();
+			if (resident_.size()>0 || spilled_.size()==0) return;
+			if (prefetching_) finishPrefetch();
+			else unspill();
+		}
+
+		//! If the next pop() would need to read from disk then
+		//! the read starts now in another thread, and pop() waits for it.
+		//! Does nothing without USE_PTHREADS
+		void prefetch()
+		{
+#ifdef USE_PTHREADS
+			if (prefetching_ || resident_.size()!=1 || spilled_.size()==0) return;
+			prefetchError_ = "";
+			int ret = pthread_create(&thread_,0,prefetchThread,this);
+			if (ret!=0) return; // pop() will read it then
+			prefetching_ = true;
+#endif
+		}
+
+		const SharedType& top() const
+		{
+			if (resident_.size()==0)
+				throw std::runtime_error("SpillingStack::top(): empty stack\n");
+			return resident_.back();
+		}
+
+		size_t size() const { return resident_.size() + spilled_.size(); }
+
+		//! The entry i counting from the bottom; if spilled it is read
+		//! from its file, and stays spilled
+		SharedType entry(size_t i) const
+		{
+			if (i<spilled_.size()) return load(spilled_[i]);
+			i -= spilled_.size();
+			if (i>=resident_.size())
+				throw std::runtime_error("SpillingStack::entry(): out of range\n");
+			return resident_[i];
+		}
+
+		//! Replaces the entry i counting from the bottom by x; if spilled
+		//! x is written to its file instead, and stays spilled
+		void replace(size_t i,const SharedType& x)
+		{
+			if (prefetching_) finishPrefetch();
+			if (i<spilled_.size()) {
+				IoOutType io;
+				io.open(spilled_[i],std::ios_base::trunc,0);
+				x->save(io);
+				io.close();
+				return;
+			}
+			i -= spilled_.size();
+			if (i>=resident_.size())
+				throw std::runtime_error("SpillingStack::replace(): out of range\n");
+			size_t b = x->memory();
+			bytes_ = bytes_ - residentBytes_[i] + b;
+			resident_[i] = x;
+			residentBytes_[i] = b;
+		}
+
+		size_t spilled() const { return spilled_.size(); }
+
+	private:
+
+		SpillingStack(const SpillingStack&);
+
+		SpillingStack& operator=(const SpillingStack&);
+
+		//! writes the deepest entry in memory to disk
+		void spill()
+		{
+			std::string file = prefix_ + ttos(counter_++);
+			IoOutType io;
+			io.open(file,std::ios_base::trunc,0);
+			resident_.front()->save(io);
+			io.close();
+			spilled_.push_back(file);
+			bytes_ -= residentBytes_.front();
+			resident_.pop_front();
+			residentBytes_.pop_front();
+		}
+
+		//! reads the highest entry on disk back as the deepest in memory
+		void unspill()
+		{
+			SharedType x = load(spilled_.back());
+			addUnspilled(x);
+		}
+
+		//! waits for the prefetch thread, and uses what it read
+		//! as the deepest entry in memory
+		void finishPrefetch()
+		{
+			pthread_join(thread_,0);
+			prefetching_ = false;
+			if (prefetchError_!="") {
+				std::string s = "SpillingStack::finishPrefetch(): " + prefetchError_;
+				throw std::runtime_error(s);
+			}
+			SharedType x = prefetched_;
+			prefetched_.reset();
+			addUnspilled(x);
+		}
+
+		void addUnspilled(const SharedType& x)
+		{
+			std::remove(spilled_.back().c_str());
+			spilled_.pop_back();
+			size_t b = x->memory();
+			resident_.push_front(x);
+			residentBytes_.push_front(b);
+			bytes_ += b;
+		}
+
+		static SharedType load(const std::string& file)
+		{
+			IoInType io;
+			io.open(file);
+			SharedType x = SharedType::adopt(new DataType(io,"",0));
+			io.close();
+			return x;
+		}
+
+		//! runs in its own thread; touches only prefetched_ and prefetchError_
+		//! until finishPrefetch() joins it
+		static void* prefetchThread(void* arg)
+		{
+			SpillingStack* s = static_cast<SpillingStack*>(arg);
+			try {
+				s->prefetched_ = load(s->spilled_.back());
+			} catch (std::exception& e) {
+				s->prefetchError_ = e.what();
+			}
+			return 0;
+		}
+
+		std::string prefix_;
+		size_t budget_;
+		size_t bytes_;
+		size_t counter_;
+		std::deque<SharedType> resident_; // deepest first
+		std::deque<size_t> residentBytes_;
+		std::vector<std::string> spilled_; // deepest first
+		bool prefetching_;
+		pthread_t thread_;
+		SharedType prefetched_;
+		std::string prefetchError_;
+	}; // class SpillingStack
+} // namespace Dmrg
+
+/*@}*/
+#endif // SPILLING_STACK_H
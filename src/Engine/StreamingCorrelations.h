@@ -0,0 +1,247 @@
+// BEGIN LICENSE BLOCK
+/*
+Copyright (c) 2009, UT-Battelle, LLC
+All rights reserved
+
+[DMRG++, Version 2.0.0]
+[by G.A., Oak Ridge National Laboratory]
+
+UT Battelle Open Source Software License 11242008
+
+OPEN SOURCE LICENSE
+
+Subject to the conditions of this License, each
+contributor to this software hereby grants, free of
+charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"), a
+perpetual, worldwide, non-exclusive, no-charge,
+royalty-free, irrevocable copyright license to use, copy,
+modify, merge, publish, distribute, and/or sublicense
+copies of the Software.
+
+1. Redistributions of Software must retain the above
+copyright and license notices, this list of conditions,
+and the following disclaimer.  Changes or modifications
+to, or derivative works of, the Software should be noted
+with comments and the contributor and organization's
+name.
+
+2. Neither the names of UT-Battelle, LLC or the
+Department of Energy nor the names of the Software
+contributors may be used to endorse or promote products
+derived from this software without specific prior written
+permission of UT-Battelle.
+
+3. The software and the end-user documentation included
+with the redistribution, with or without modification,
+must include the following acknowledgment:
+
+"This product includes software produced by UT-Battelle,
+LLC under Contract No. DE-AC05-00OR22725  with the
+Department of Energy."
+ 
+*********************************************************
+DISCLAIMER
+
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT OWNER, CONTRIBUTORS, UNITED STATES GOVERNMENT,
+OR THE UNITED STATES DEPARTMENT OF ENERGY BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+
+NEITHER THE UNITED STATES GOVERNMENT, NOR THE UNITED
+STATES DEPARTMENT OF ENERGY, NOR THE COPYRIGHT OWNER, NOR
+ANY OF THEIR EMPLOYEES, REPRESENTS THAT THE USE OF ANY
+INFORMATION, DATA, APPARATUS, PRODUCT, OR PROCESS
+DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
+
+*********************************************************
+
+
+*/
+// END LICENSE BLOCK
+/** \ingroup DMRG */
+/*@{*/
+
+/*! \file StreamingCorrelations.h
+ *
+ *  Two-point correlations <state1 | A_i B_j |state2> for many
+ *  pairs of operators at once, in a single pass over the data file
+ *
+ *  TwoPointCorrelations grows A_i again for each j, going back
+ *  and forth over the records; here the records are read in order,
+ *  and each record is used to finish the (i,j) that need it and
+ *  to grow all the A_i by one step. Only the current record needs
+ *  to be in memory, see ObserverHelper::advance()
+ */
+#ifndef STREAMING_CORRELATIONS_H
+#define STREAMING_CORRELATIONS_H
+#include <algorithm>
+#include "Matrix.h" // in PsimagLite
+
+namespace Dmrg {
+
+	template<typename CorrelationsSkeletonType>
+	class StreamingCorrelations {
+		typedef typename CorrelationsSkeletonType::ObserverHelperType
+			ObserverHelperType;
+		typedef typename ObserverHelperType::MatrixType MatrixType;
+		typedef typename ObserverHelperType::VectorType VectorType;
+		typedef typename VectorType::value_type FieldType;
+
+		struct Request {
+			MatrixType O1,O2,O1O2;
+			int fermionicSign;
+			size_t rows,cols;
+			// grown[i] is O1 at site i grown up to the current record
+			std::vector<MatrixType> grown;
+			PsimagLite::Matrix<FieldType> result;
+		};
+
+	public:
+		StreamingCorrelations(
+				ObserverHelperType& helper,
+				CorrelationsSkeletonType& skeleton,
+				bool verbose=false)
+		: helper_(helper),
+		  skeleton_(skeleton),
+		  verbose_(verbose)
+		{}
+
+		//! Requests O1_i O2_j for i<rows and i<=j<cols,
+		//! returns the id for result()
+		size_t add(
+				const MatrixType& O1,
+				const MatrixType& O2,
+				int fermionicSign,
+				size_t rows,
+				size_t cols)
+		{
+			if (requests_.size()>0 && O1.n_row()!=identity_.n_row())
+				throw std::runtime_error("StreamingCorrelations::add(...):"
+					" all operators must act on the same one-site basis\n");
+			if (requests_.size()==0) identity_ = skeleton_.identity(O1.n_row());
+
+			Request r;
+			requests_.push_back(r);
+			Request& req = requests_.back();
+			req.O1 = O1;
+			req.O2 = O2;
+			req.O1O2 = skeleton_.multiplyTranspose(O1,O2);
+			req.fermionicSign = fermionicSign;
+			req.rows = rows;
+			req.cols = cols;
+			req.grown.resize(rows,O1);
+			req.result.resize(rows,cols);
+			return requests_.size()-1;
+		}
+
+		//! Reads all records, starting at the current one (the first)
+		void operator()()
+		{
+			size_t s = helper_.getPointer();
+			if (s!=0) throw std::runtime_error(
+				"StreamingCorrelations::operator()(): must start at record 0\n");
+			size_t n = skeleton_.numberOfSites();
+			MatrixType identityGrown = identity_;
+			while (true) {
+				helper_.setPointer(s);
+				if (verbose_) std::cerr<<"StreamingCorrelations record "<<s<<"\n";
+				for (size_t x=0;x<requests_.size();x++)
+					step(requests_[x],identityGrown,s,n);
+				if (s+3>=n) break;
+				// the diagonal i=s+2 needs the identity at s+1
+				identityGrown = identity_;
+				skeleton_.growStep(identityGrown,s+1,1,s);
+				if (!helper_.advance()) break;
+				s++;
+			}
+
+			for (size_t x=0;x<requests_.size();x++)
+				requests_[x].grown.clear();
+		}
+
+		const PsimagLite::Matrix<FieldType>& result(size_t id) const
+		{
+			return requests_[id].result;
+		}
+
+	private:
+
+		// Same as TwoPointCorrelations::calcCorrelation_, but the records
+		// up to s-1 have already been used to grow the operators
+		void step(Request& req,const MatrixType& identityGrown,size_t s,size_t n)
+		{
+			bool corner = (s+3==n);
+			int sign = req.fermionicSign;
+			size_t j = s+1;
+			size_t imax = std::min(s+1,req.rows);
+			for (size_t i=0;i<imax;i++) {
+				if (j<req.cols)
+					req.result(i,j) = multiplyAndBracket(req.grown[i],
+						req.O2,sign,s);
+				if (corner && n-1<req.cols)
+					req.result(i,n-1) = skeleton_.bracketRightCorner(
+						req.grown[i],req.O2,sign);
+			}
+
+			// diagonal: the identity at i-1 times O1^\dagger O2 at i
+			if (s==0 && req.rows>0 && req.cols>0)
+				req.result(0,0) = multiplyAndBracket(req.O1O2,
+					identity_,1,0);
+			if (j<req.rows && j<req.cols)
+				req.result(j,j) = multiplyAndBracket(identityGrown,
+					req.O1O2,1,s);
+
+			if (corner) {
+				size_t ni = helper_.leftRightSuper().left().size()/
+						helper_.leftRightSuper().right().size();
+				MatrixType O1g = skeleton_.identity(ni);
+				if (n-2<req.rows && n-1<req.cols)
+					req.result(n-2,n-1) = skeleton_.bracketRightCorner(
+						O1g,req.O1,req.O2,sign);
+				if (n-1<req.rows && n-1<req.cols)
+					req.result(n-1,n-1) = skeleton_.bracketRightCorner(
+						O1g,identity_,req.O1O2,1);
+				return;
+			}
+
+			// grow the O1 that will be needed again
+			if (s+2>=req.cols) return;
+			imax = std::min(s+2,req.rows);
+			for (size_t i=0;i<imax;i++)
+				skeleton_.growStep(req.grown[i],i,sign,s);
+		}
+
+		FieldType multiplyAndBracket(
+				const MatrixType& O1g,
+				const MatrixType& O2,
+				int fermionicSign,
+				size_t s)
+		{
+			MatrixType O2g;
+			skeleton_.dmrgMultiply(O2g,O1g,O2,fermionicSign,s);
+			return skeleton_.bracket(O2g,fermionicSign);
+		}
+
+		ObserverHelperType& helper_;
+		CorrelationsSkeletonType& skeleton_;
+		bool verbose_;
+		std::vector<Request> requests_;
+		MatrixType identity_;
+	};  //class StreamingCorrelations
+} // namespace Dmrg
+
+/*@}*/
+#endif // STREAMING_CORRELATIONS_H
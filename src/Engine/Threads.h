@@ -0,0 +1,474 @@
+// BEGIN LICENSE BLOCK
+/*
+Copyright (c) 2009, UT-Battelle, LLC
+All rights reserved
+
+[DMRG++, Version 2.0.0]
+[by G.A., Oak Ridge National Laboratory]
+
+UT Battelle Open Source Software License 11242008
+
+OPEN SOURCE LICENSE
+
+Subject to the conditions of this License, each
+contributor to this software hereby grants, free of
+charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"), a
+perpetual, worldwide, non-exclusive, no-charge,
+royalty-free, irrevocable copyright license to use, copy,
+modify, merge, publish, distribute, and/or sublicense
+copies of the Software.
+
+1. Redistributions of Software must retain the above
+copyright and license notices, this list of conditions,
+and the following disclaimer.  Changes or modifications
+to, or derivative works of, the Software should be noted
+with comments and the contributor and organization's
+name.
+
+2. Neither the names of UT-Battelle, LLC or the
+Department of Energy nor the names of the Software
+contributors may be used to endorse or promote products
+derived from this software without specific prior written
+permission of UT-Battelle.
+
+3. The software and the end-user documentation included
+with the redistribution, with or without modification,
+must include the following acknowledgment:
+
+"This product includes software produced by UT-Battelle,
+LLC under Contract No. DE-AC05-00OR22725  with the
+Department of Energy."
+ 
+*********************************************************
+DISCLAIMER
+
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT OWNER, CONTRIBUTORS, UNITED STATES GOVERNMENT,
+OR THE UNITED STATES DEPARTMENT OF ENERGY BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+
+NEITHER THE UNITED STATES GOVERNMENT, NOR THE UNITED
+STATES DEPARTMENT OF ENERGY, NOR THE COPYRIGHT OWNER, NOR
+ANY OF THEIR EMPLOYEES, REPRESENTS THAT THE USE OF ANY
+INFORMATION, DATA, APPARATUS, PRODUCT, OR PROCESS
+DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
+
+*********************************************************
+
+
+*/
+// END LICENSE BLOCK
+/** \ingroup DMRG */
+/*@{*/
+
+/*! \file Threads.h
+ *
+ *  A pool of pthreads, created once and used by all loops of the engine.
+ *  The loop is given as a class that implements
+ *  thread_function_(threadNum,blockSize,mutex), as for PsimagLite's
+ *  Pthreads, and must do the indices threadNum*blockSize up to
+ *  (threadNum+1)*blockSize, locking the mutex (if not null) before
+ *  writing shared data.
+ *
+ *  Here threadNum is not a thread but a chunk of the loop: the loop is
+ *  cut into a few chunks per thread, and each thread owns a contiguous
+ *  range of chunks. A thread that is done with its own chunks takes
+ *  (steals) chunks from the end of the range of another thread, so that
+ *  uneven chunks do not leave threads idle. Without stealing, a loop of
+ *  a given size gives the same indices to the same thread each time,
+ *  so that memory first written in a loop (see firstTouch) is local to
+ *  the thread that uses it later. For this to hold on multi-socket
+ *  machines the threads must not move, see setThreads.
+ *
+ *  Threads are only used if compiled with -DUSE_PTHREADS; they can be
+ *  combined with MPI, since only the calling thread does MPI calls.
+ *  A loop started from within a loop runs serially in its thread.
+ *  A loop that sums into shared data can keep one accumulator per
+ *  thread (see thread()) instead of locking the mutex.
+ *
+ */
+#ifndef DMRG_THREADS_H
+#define DMRG_THREADS_H
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <pthread.h>
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+namespace Dmrg {
+
+	class Threads {
+
+		enum {CHUNKS_PER_THREAD = 4};
+
+		typedef void (*RunnerType)(void*,size_t,size_t,pthread_mutex_t*);
+
+		struct Pool;
+
+		struct WorkerArgs {
+			Pool* pool;
+			size_t threadNum;
+		};
+
+		// The state of the pool; the workers wait on work until
+		// generation changes, and the caller waits on done until
+		// all workers are done with that generation
+		struct Pool {
+
+			Pool()
+			: generation(0),startGeneration(0),pending(0),busy(false),shutdown(false),
+			  runner(0),functor(0),chunkSize(0),inOrder(false)
+			{
+				pthread_mutex_init(&mutex,0);
+				pthread_mutex_init(&userMutex,0);
+				pthread_cond_init(&work,0);
+				pthread_cond_init(&done,0);
+				pthread_key_create(&threadKey,0);
+			}
+
+			~Pool()
+			{
+				stopWorkers();
+				pthread_key_delete(threadKey);
+				pthread_cond_destroy(&done);
+				pthread_cond_destroy(&work);
+				pthread_mutex_destroy(&userMutex);
+				pthread_mutex_destroy(&mutex);
+			}
+
+			void stopWorkers()
+			{
+				pthread_mutex_lock(&mutex);
+				shutdown = true;
+				pthread_cond_broadcast(&work);
+				pthread_mutex_unlock(&mutex);
+				for (size_t j=0;j<workers.size();j++) pthread_join(workers[j],0);
+				workers.clear();
+				shutdown = false;
+			}
+
+			pthread_mutex_t mutex;
+			pthread_mutex_t userMutex;
+			pthread_cond_t work;
+			pthread_cond_t done;
+			// holds the number of each worker thread, see thread()
+			pthread_key_t threadKey;
+			std::vector<pthread_t> workers;
+			std::vector<WorkerArgs> args;
+			size_t generation;
+			size_t startGeneration;
+			size_t pending;
+			bool busy;
+			bool shutdown;
+			RunnerType runner;
+			void* functor;
+			size_t chunkSize;
+			// if true all threads take the next index, see loopCreateInOrder
+			bool inOrder;
+			// chunks not yet taken of thread t are nextChunk[t] up to endChunk[t]
+			std::vector<size_t> nextChunk;
+			std::vector<size_t> endChunk;
+			std::string error;
+		}; // struct Pool
+
+		// Writes zeros to rows i of the columns at v, for the indices i
+		// of a loop of size n
+		template<typename T>
+		class FirstTouch {
+		public:
+			FirstTouch(T* v,size_t n,size_t ncol) : v_(v),n_(n),ncol_(ncol) {}
+
+			void thread_function_(size_t threadNum,size_t blockSize,pthread_mutex_t*)
+			{
+				size_t start = threadNum*blockSize;
+				if (start>=n_) return;
+				size_t end = start + blockSize;
+				if (end>n_) end = n_;
+				for (size_t j=0;j<ncol_;j++)
+					for (size_t i=start;i<end;i++) v_[i+j*n_] = 0;
+			}
+
+		private:
+			T* v_;
+			size_t n_;
+			size_t ncol_;
+		}; // class FirstTouch
+
+	public:
+
+		//! Sets the number of threads, including the calling one;
+		//! the other threads are created here and stay until the end.
+		//! If pinned then thread t runs only on the t-th processor
+		//! that this process may use (so that with MPI each process
+		//! should be bound to its own set of processors)
+		static void setThreads(size_t n,bool pinned = false)
+		{
+			if (n==0) throw std::runtime_error("Threads::setThreads(...): n==0\n");
+			if (n==threads_() && pinned==pinned_()) return;
+			threads_() = n;
+			pinned_() = pinned;
+#ifdef USE_PTHREADS
+			Pool& p = pool();
+			p.stopWorkers();
+			std::vector<int> cpus;
+			if (pinned) allowedCpus(cpus);
+			if (cpus.size()>0) pin(pthread_self(),cpus[0]);
+			p.nextChunk.resize(n);
+			p.endChunk.resize(n);
+			p.workers.resize(n-1);
+			p.args.resize(n-1);
+			p.startGeneration = p.generation;
+			for (size_t j=0;j<p.workers.size();j++) {
+				p.args[j].pool = &p;
+				p.args[j].threadNum = j+1;
+				int ret = pthread_create(&p.workers[j],0,workerFunction,&p.args[j]);
+				if (ret!=0) throw std::runtime_error(
+					"Threads::setThreads(...): pthread_create failed\n");
+				if (cpus.size()>0) pin(p.workers[j],cpus[(j+1) % cpus.size()]);
+			}
+#endif
+		}
+
+		static size_t threads() { return threads_(); }
+
+		//! The thread that calls this, from 0 (the calling thread of
+		//! loops) up to threads()-1
+		static size_t thread()
+		{
+#ifdef USE_PTHREADS
+			if (threads_()<=1) return 0;
+			return reinterpret_cast<size_t>(pthread_getspecific(pool().threadKey));
+#else
+			return 0;
+#endif
+		}
+
+		template<typename FunctorType>
+		static void loopCreate(size_t total,FunctorType& functor)
+		{
+			run(total,functor,false);
+		}
+
+		//! Same as loopCreate, but the chunks are single indices, and
+		//! each thread takes the lowest index not yet taken; use it for
+		//! few indices of very different cost, sorted by decreasing cost
+		template<typename FunctorType>
+		static void loopCreateInOrder(size_t total,FunctorType& functor)
+		{
+			run(total,functor,true);
+		}
+
+		//! Places the pages of v, which must be newly allocated (all zeros),
+		//! in the memory of the threads that will do each index of a loop
+		//! of size v.size(). std::vector writes the zeros from the
+		//! allocating thread, so the whole pages in v are given back to the
+		//! system first, and then written again by the loop.
+		template<typename T>
+		static void firstTouch(std::vector<T>& v)
+		{
+			if (v.size()==0) return;
+			firstTouch(&(v[0]),v.size(),1);
+		}
+
+		//! Same as above for the ncol columns, of n elements each, of a
+		//! matrix stored by columns at v: row i of every column goes to
+		//! the thread that does index i of a loop of size n
+		template<typename T>
+		static void firstTouch(T* v,size_t n,size_t ncol)
+		{
+#if defined(USE_PTHREADS) && defined(__linux__)
+			if (threads_()<=1 || n*ncol==0) return;
+			size_t pageSize = sysconf(_SC_PAGESIZE);
+			char* start = reinterpret_cast<char*>(v);
+			char* end = reinterpret_cast<char*>(v+n*ncol);
+			size_t offset = reinterpret_cast<size_t>(start) % pageSize;
+			if (offset>0) start += pageSize - offset;
+			end -= reinterpret_cast<size_t>(end) % pageSize;
+			if (end<=start) return;
+			madvise(start,end-start,MADV_DONTNEED);
+			FirstTouch<T> firstTouch(v,n,ncol);
+			loopCreate(n,firstTouch);
+#endif
+		}
+
+	private:
+
+		static size_t& threads_()
+		{
+			static size_t nthreads = 1;
+			return nthreads;
+		}
+
+		static bool& pinned_()
+		{
+			static bool pinned = false;
+			return pinned;
+		}
+
+		static Pool& pool()
+		{
+			static Pool p;
+			return p;
+		}
+
+		static void allowedCpus(std::vector<int>& cpus)
+		{
+#ifdef __linux__
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			if (sched_getaffinity(0,sizeof(set),&set)!=0) return;
+			for (int i=0;i<CPU_SETSIZE;i++)
+				if (CPU_ISSET(i,&set)) cpus.push_back(i);
+#endif
+		}
+
+		static void pin(pthread_t thread,int cpu)
+		{
+#ifdef __linux__
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(cpu,&set);
+			pthread_setaffinity_np(thread,sizeof(set),&set);
+#endif
+		}
+
+		template<typename FunctorType>
+		static void run(size_t total,FunctorType& functor,bool inOrder)
+		{
+			size_t nthreads = threads_();
+			if (nthreads<=1 || total<=1) {
+				functor.thread_function_(0,total,0);
+				return;
+			}
+#ifdef USE_PTHREADS
+			Pool& p = pool();
+			pthread_mutex_lock(&p.mutex);
+			if (p.busy) {
+				pthread_mutex_unlock(&p.mutex);
+				functor.thread_function_(0,total,0);
+				return;
+			}
+			if (inOrder) {
+				p.chunkSize = 1;
+				for (size_t t=0;t<nthreads;t++) {
+					p.nextChunk[t] = 0;
+					p.endChunk[t] = (t==0) ? total : 0;
+				}
+			} else {
+				size_t chunks = nthreads*CHUNKS_PER_THREAD;
+				if (chunks>total) chunks = total;
+				p.chunkSize = total/chunks;
+				if (total % chunks != 0) p.chunkSize++;
+				chunks = total/p.chunkSize;
+				if (total % p.chunkSize != 0) chunks++;
+				for (size_t t=0;t<nthreads;t++) {
+					p.nextChunk[t] = (t*chunks)/nthreads;
+					p.endChunk[t] = ((t+1)*chunks)/nthreads;
+				}
+			}
+			p.inOrder = inOrder;
+			p.runner = runChunk<FunctorType>;
+			p.functor = &functor;
+			p.error = "";
+			p.busy = true;
+			p.pending = p.workers.size();
+			p.generation++;
+			pthread_cond_broadcast(&p.work);
+			pthread_mutex_unlock(&p.mutex);
+
+			runChunks(p,0);
+
+			pthread_mutex_lock(&p.mutex);
+			while (p.pending>0) pthread_cond_wait(&p.done,&p.mutex);
+			p.busy = false;
+			std::string error = p.error;
+			pthread_mutex_unlock(&p.mutex);
+			if (error!="") throw std::runtime_error(error);
+#else
+			functor.thread_function_(0,total,0);
+#endif
+		}
+
+		template<typename FunctorType>
+		static void runChunk(void* functor,size_t chunk,size_t chunkSize,
+		                     pthread_mutex_t* mutex)
+		{
+			static_cast<FunctorType*>(functor)->thread_function_(chunk,chunkSize,mutex);
+		}
+
+		// Returns false if there are no chunks left
+		static bool takeChunk(Pool& p,size_t threadNum,size_t& chunk)
+		{
+			pthread_mutex_lock(&p.mutex);
+			size_t nthreads = p.nextChunk.size();
+			for (size_t s=0;s<nthreads;s++) {
+				size_t t = (threadNum+s) % nthreads;
+				if (p.nextChunk[t]>=p.endChunk[t]) continue;
+				// its own chunks from the front, others' from the end
+				chunk = (s==0 || p.inOrder) ? p.nextChunk[t]++ : --p.endChunk[t];
+				pthread_mutex_unlock(&p.mutex);
+				return true;
+			}
+			pthread_mutex_unlock(&p.mutex);
+			return false;
+		}
+
+		static void runChunks(Pool& p,size_t threadNum)
+		{
+			size_t chunk = 0;
+			while (takeChunk(p,threadNum,chunk)) {
+				try {
+					p.runner(p.functor,chunk,p.chunkSize,&p.userMutex);
+				} catch (std::exception& e) {
+					pthread_mutex_lock(&p.mutex);
+					p.error = e.what();
+					for (size_t t=0;t<p.nextChunk.size();t++)
+						p.nextChunk[t] = p.endChunk[t];
+					pthread_mutex_unlock(&p.mutex);
+				}
+			}
+		}
+
+		static void* workerFunction(void* vargs)
+		{
+			WorkerArgs* args = static_cast<WorkerArgs*>(vargs);
+			Pool& p = *(args->pool);
+			pthread_setspecific(p.threadKey,reinterpret_cast<void*>(args->threadNum));
+			pthread_mutex_lock(&p.mutex);
+			size_t seen = p.startGeneration;
+			while (true) {
+				while (!p.shutdown && p.generation==seen)
+					pthread_cond_wait(&p.work,&p.mutex);
+				if (p.shutdown) break;
+				seen = p.generation;
+				pthread_mutex_unlock(&p.mutex);
+				runChunks(p,args->threadNum);
+				pthread_mutex_lock(&p.mutex);
+				if (--p.pending==0) pthread_cond_signal(&p.done);
+			}
+			pthread_mutex_unlock(&p.mutex);
+			return 0;
+		}
+	}; // class Threads
+} // namespace Dmrg
+
+/*@}*/
+#endif // DMRG_THREADS_H
@@ -103,7 +103,8 @@ namespace Dmrg {
 			  targetVectors_(targetVectors)
 			{}
 			
-			TimeSerializer(typename PsimagLite::IoSimple::In& io,size_t lastInstance = 0)
+			template<typename IoInputType>
+			TimeSerializer(IoInputType& io,size_t lastInstance = 0)
 			{
 				RealType x=0;
 				std::string s = "#TIME=";
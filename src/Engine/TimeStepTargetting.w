@@ -41,6 +41,7 @@ Eqs. (55) to (60)  on page 26.
 #include "ApplyOperatorLocal.h"
 #include "TimeSerializer.h"
 #include "TimeStepParams.h"
+#include "VectorKernels.h"
 @}
 
 This class is templated on 7 templates, which are:
@@ -101,6 +102,7 @@ A long series of typedefs follow. Need to explain these maybe (FIXME).
 			typedef std::vector<RealType> VectorType;
 			//typedef typename BasisWithOperatorsType::SparseMatrixType SparseMatrixType;
 			typedef PsimagLite::Matrix<ComplexType> ComplexMatrixType;
+			typedef typename LanczosSolverType::LanczosVectorsType LanczosVectorsType;
 			typedef typename LanczosSolverType::TridiagonalMatrixType TridiagonalMatrixType;
 			typedef typename BasisWithOperatorsType::OperatorType OperatorType;
 			typedef typename BasisWithOperatorsType::BasisType BasisType;
@@ -576,10 +578,19 @@ We'll visit one function at a time. %'
 @{
 void load(const std::string& f)
 {
-	for (size_t i=0;i<stage_.size();i++) stage_[i] = WFT_NOADVANCE;
-
 	typename IoType::In io(f);
 
+	// a ground state checkpoint has no time vectors yet: time
+	// evolution starts at this point as in a new run
+	if (io.count("#TIME=")==0) {
+		int site=0;
+		io.readline(site,"#TCENTRALSITE=",IoType::In::LAST_INSTANCE);
+		psi_.load(io,"PSI");
+		return;
+	}
+
+	for (size_t i=0;i<stage_.size();i++) stage_[i] = WFT_NOADVANCE;
+
 	TimeSerializerType ts(io,IoType::In::LAST_INSTANCE);
 	for (size_t i=0;i<targetVectors_.size();i++) targetVectors_[i] = ts.vector(i);
 	currentTime_ = ts.time();
@@ -697,7 +708,7 @@ Finally we are ready to $V^\dagger T^dagger \exp(i\epsilon t) TV$ in function \v
       						const VectorWithOffsetType& phi,
 						size_t systemOrEnviron)
 			{
-				std::vector<ComplexMatrixType> V(phi.sectors());
+				std::vector<LanczosVectorsType> V(phi.sectors());
 				std::vector<ComplexMatrixType> T(phi.sectors());
 				
 				std::vector<size_t> steps(phi.sectors());
@@ -721,7 +732,7 @@ index $i$.
 			void calcTargetVectors(
 						const VectorWithOffsetType& phi,
 						const std::vector<ComplexMatrixType>& T,
-						const std::vector<ComplexMatrixType>& V,
+						const std::vector<LanczosVectorsType>& V,
 						RealType Eg,
       						const std::vector<VectorType>& eigs,
 	    					std::vector<size_t> steps,
@@ -745,7 +756,7 @@ vector with offsets \verb|v|.
 						VectorWithOffsetType& v,
       						const VectorWithOffsetType& phi,
 						const std::vector<ComplexMatrixType>& T,
-						const std::vector<ComplexMatrixType>& V,
+						const std::vector<LanczosVectorsType>& V,
 						RealType Eg,
       						const std::vector<VectorType>& eigs,
 	    					RealType t,
@@ -771,7 +782,7 @@ It is the vector calculated by \verb|calcR| as explained below.
 						ComplexVectorType& r,
       						const VectorWithOffsetType& phi,
 						const ComplexMatrixType& T,
-						const ComplexMatrixType& V,
+						const LanczosVectorsType& V,
 						RealType Eg,
       						const VectorType& eigs,
 	    					RealType t,
@@ -804,7 +815,7 @@ to substract the ground state energy \verb|Eg|. This returns the vector $exp(iDt
 			void calcR(
 				ComplexVectorType& r,
     				const ComplexMatrixType& T,
-				const ComplexMatrixType& V,
+				const LanczosVectorsType& V,
     				const VectorWithOffsetType& phi,
     				RealType Eg,
 				const VectorType& eigs,
@@ -812,12 +823,13 @@ to substract the ground state energy \verb|Eg|. This returns the vector $exp(iDt
 				size_t n2,
 				size_t i0)
 			{
+				// V^\dagger phi does not depend on k, compute it only once
+				ComplexVectorType vTimesPhi(n2);
+				for (size_t kprime=0;kprime<n2;kprime++)
+					vTimesPhi[kprime] = calcVTimesPhi(kprime,V,phi,i0);
+
 				for (size_t k=0;k<n2;k++) {
-					ComplexType sum = 0.0;
-					for (size_t kprime=0;kprime<n2;kprime++) {
-						ComplexType tmpV = calcVTimesPhi(kprime,V,phi,i0);
-						sum += conj(T(kprime,k))*tmpV;
-					}
+					ComplexType sum = VectorKernels::dotConj(&(T(0,k)),&(vTimesPhi[0]),n2);
 					RealType tmp = (eigs[k]-Eg)*t;
 					ComplexType c(cos(tmp),sin(tmp));
 					r[k] = c * sum;
@@ -828,15 +840,12 @@ to substract the ground state energy \verb|Eg|. This returns the vector $exp(iDt
 This function does $\sum_x V_{k',x} phi_{x}$, that is $V\phi$%'
 @o TimeStepTargetting.h -t
 @{
-			ComplexType calcVTimesPhi(size_t kprime,const ComplexMatrixType& V,const VectorWithOffsetType& phi,
+			ComplexType calcVTimesPhi(size_t kprime,const LanczosVectorsType& V,const VectorWithOffsetType& phi,
 						 size_t i0)
 			{
-				ComplexType ret = 0;
 				size_t total = phi.effectiveSize(i0);
-				
-				for (size_t j=0;j<total;j++)
-					ret += conj(V(j,kprime))*phi.fastAccess(i0,j);
-				return ret;
+				if (total==0) return 0.0;
+				return VectorKernels::dotConj(&(V(0,kprime)),&(phi.fastAccess(i0,0)),total);
 			}
 @}
 
@@ -846,7 +855,7 @@ Here is tridiag, we loop over (non-zero) symmetry sectors:
 			void triDiag(
 					const VectorWithOffsetType& phi,
 					std::vector<ComplexMatrixType>& T,
-	 				std::vector<ComplexMatrixType>& V,
+	 				std::vector<LanczosVectorsType>& V,
 					std::vector<size_t>& steps)
 			{
 				for (size_t ii=0;ii<phi.sectors();ii++) {
@@ -859,7 +868,7 @@ Here is tridiag, we loop over (non-zero) symmetry sectors:
 And now for each symmetry sector:
 @o TimeStepTargetting.h -t
 @{
-			size_t triDiag(const VectorWithOffsetType& phi,ComplexMatrixType& T,ComplexMatrixType& V,size_t i0)
+			size_t triDiag(const VectorWithOffsetType& phi,ComplexMatrixType& T,LanczosVectorsType& V,size_t i0)
 			{
 				size_t p = lrs_.super().findPartitionNumber(phi.offset(i0));
 				typename ModelType::ModelHelperType modelHelper(p,lrs_,model_.orbitals());
@@ -890,7 +899,7 @@ A validity check
 @o TimeStepTargetting.h -t
 @{
 			//! This check is invalid if there are more than one sector
-			void check1(const ComplexMatrixType& V,const TargetVectorType& phi2)
+			void check1(const LanczosVectorsType& V,const TargetVectorType& phi2)
 			{
 				if (V.n_col()>V.n_row()) throw std::runtime_error("cols > rows\n");
 				TargetVectorType r(V.n_col());
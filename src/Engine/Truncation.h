@@ -82,6 +82,7 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 #define DMRG_TRUNCATION_H
 
 #include "DensityMatrix.h"
+#include "BlockDiagonalMatrix.h"
 
 namespace Dmrg {
 	
@@ -102,7 +103,7 @@ namespace Dmrg {
 		
 	public:
 
-		typedef typename DensityMatrixType::BuildingBlockType TransformType;
+		typedef BlockDiagonalMatrix<typename DensityMatrixType::BuildingBlockType> TransformType;
 
 		Truncation(LeftRightSuperType& lrs,
 		           WaveFunctionTransfType& waveFunctionTransformation,
@@ -177,7 +178,9 @@ namespace Dmrg {
 		                            BasisWithOperatorsType const &pBasisSummed,
 		                            size_t direction)
 		{
-			DensityMatrixType dmS(target,pBasis,pBasisSummed,lrs_.super(),direction);
+			bool useSvd = (parameters_.options.find("truncationSvd")!=std::string::npos);
+			DensityMatrixType dmS(target,pBasis,pBasisSummed,lrs_.super(),direction,
+			                      false,false,useSvd);
 			dmS.check(direction);
 			
 			if (verbose_ && concurrency_.root()) {
@@ -185,7 +188,7 @@ namespace Dmrg {
 				std::cerr<<dmS.rank()<<"\n";
 			}
 			std::vector<RealType> eigs;
-			dmS.diag(eigs,'V',concurrency_);
+			dmS.diag(eigs,'V',keptStates_,concurrency_);
 			dmS.check2(direction);
 			
 			updateKeptStates(eigs);
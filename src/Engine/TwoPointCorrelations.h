@@ -183,19 +183,6 @@ namespace Dmrg {
 			return c;
 		}
 
-		MatrixType multiplyTranspose(
-				const MatrixType& O1,
-				const MatrixType& O2)
-		{
-			size_t n=O1.n_row();
-			MatrixType ret(n,n);
-			for (size_t s=0;s<n;s++) 
-				for (size_t t=0;t<n;t++) 
-					for (size_t w=0;w<n;w++) 
-						ret(s,t) += std::conj(O1(s,w))*O2(w,t);
-			return ret;
-		}
-
 		MatrixType add(const MatrixType& O1,const MatrixType& O2)
 		{
 			size_t n=O1.n_row();
@@ -212,9 +199,9 @@ namespace Dmrg {
 					int fermionicSign)
 		{
 			size_t n = O1.n_row();
-			MatrixType O1new=identity(n);
+			MatrixType O1new=skeleton_.identity(n);
 
-			MatrixType O2new=multiplyTranspose(O1,O2);
+			MatrixType O2new=skeleton_.multiplyTranspose(O1,O2);
 			if (i==0) return calcCorrelation_(0,1,O2new,O1new,1);
 			return calcCorrelation_(i-1,i,O1new,O2new,1);
 		}
@@ -255,13 +242,6 @@ namespace Dmrg {
 			return skeleton_.bracket(O2g,fermionicSign);
 		}
 
-		MatrixType identity(size_t n)
-		{
-			MatrixType ret(n,n);
-			for (size_t s=0;s<n;s++)  ret(s,s)=static_cast<RealType>(1.0);
-			return ret;
-		}
-		
 		void clearCache(size_t  ns,size_t nf)
 		{
 			growCached_.clear();
@@ -0,0 +1,305 @@
+// BEGIN LICENSE BLOCK
+/*
+Copyright (c) 2009, UT-Battelle, LLC
+All rights reserved
+
+[DMRG++, Version 2.0.0]
+[by G.A., Oak Ridge National Laboratory]
+
+UT Battelle Open Source Software License 11242008
+
+OPEN SOURCE LICENSE
+
+Subject to the conditions of this License, each
+contributor to this software hereby grants, free of
+charge, to any person obtaining a copy of this software
+and associated documentation files (the "Software"), a
+perpetual, worldwide, non-exclusive, no-charge,
+royalty-free, irrevocable copyright license to use, copy,
+modify, merge, publish, distribute, and/or sublicense
+copies of the Software.
+
+1. Redistributions of Software must retain the above
+copyright and license notices, this list of conditions,
+and the following disclaimer.  Changes or modifications
+to, or derivative works of, the Software should be noted
+with comments and the contributor and organization's
+name.
+
+2. Neither the names of UT-Battelle, LLC or the
+Department of Energy nor the names of the Software
+contributors may be used to endorse or promote products
+derived from this software without specific prior written
+permission of UT-Battelle.
+
+3. The software and the end-user documentation included
+with the redistribution, with or without modification,
+must include the following acknowledgment:
+
+"This product includes software produced by UT-Battelle,
+LLC under Contract No. DE-AC05-00OR22725  with the
+Department of Energy."
+ 
+*********************************************************
+DISCLAIMER
+
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT OWNER, CONTRIBUTORS, UNITED STATES GOVERNMENT,
+OR THE UNITED STATES DEPARTMENT OF ENERGY BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+DAMAGE.
+
+NEITHER THE UNITED STATES GOVERNMENT, NOR THE UNITED
+STATES DEPARTMENT OF ENERGY, NOR THE COPYRIGHT OWNER, NOR
+ANY OF THEIR EMPLOYEES, REPRESENTS THAT THE USE OF ANY
+INFORMATION, DATA, APPARATUS, PRODUCT, OR PROCESS
+DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
+
+*********************************************************
+
+
+*/
+// END LICENSE BLOCK
+
+/** \ingroup DMRG */
+/*@{*/
+
+/*! \file VectorKernels.h
+ *
+ *  Multiply-add and reduction kernels for the inner loops of x+=Hy
+ *  and of the Krylov updates.
+ *
+ *  std::complex<double> products go through __muldc3 unless the
+ *  compiler is allowed to ignore the C99 inf/nan rules, and the
+ *  reductions are never vectorized without -ffast-math.
+ *  Here complex products are written out explicitly, with SSE2/SSE3
+ *  or AVX intrinsics when the compiler enables them (e.g. -march=native),
+ *  and with plain scalar code otherwise.
+ *
+ *  Real reductions over complex vectors (Re <v1,v2>, norms, and
+ *  x+=a*y with real a) are done on the interleaved real array of
+ *  length 2n, since std::complex<T> is laid out as T[2]
+ *
+ */
+#ifndef VECTOR_KERNELS_H
+#define VECTOR_KERNELS_H
+
+#include <complex>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __SSE3__
+#include <pmmintrin.h>
+#endif
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+namespace Dmrg {
+	namespace VectorKernels {
+
+		//! x += a*b
+		template<typename FieldType>
+		inline void multiplyAdd(FieldType& x,const FieldType& a,const FieldType& b)
+		{
+			x += a*b;
+		}
+
+		template<typename RealType>
+		inline void multiplyAdd(std::complex<RealType>& x,
+		                        const std::complex<RealType>& a,
+		                        const std::complex<RealType>& b)
+		{
+			RealType ar = std::real(a), ai = std::imag(a);
+			RealType br = std::real(b), bi = std::imag(b);
+			x = std::complex<RealType>(std::real(x) + ar*br - ai*bi,
+			                           std::imag(x) + ar*bi + ai*br);
+		}
+
+#ifdef __SSE2__
+		inline __m128d complexProduct(__m128d a,__m128d b)
+		{
+			__m128d ar = _mm_unpacklo_pd(a,a);
+			__m128d ai = _mm_unpackhi_pd(a,a);
+			__m128d bSwapped = _mm_shuffle_pd(b,b,1);
+#ifdef __SSE3__
+			return _mm_addsub_pd(_mm_mul_pd(ar,b),_mm_mul_pd(ai,bSwapped));
+#else
+			const __m128d signLow = _mm_set_pd(0.0,-0.0);
+			return _mm_add_pd(_mm_mul_pd(ar,b),
+			                  _mm_xor_pd(_mm_mul_pd(ai,bSwapped),signLow));
+#endif
+		}
+
+		inline void multiplyAdd(std::complex<double>& x,
+		                        const std::complex<double>& a,
+		                        const std::complex<double>& b)
+		{
+			double* px = reinterpret_cast<double*>(&x);
+			__m128d va = _mm_loadu_pd(reinterpret_cast<const double*>(&a));
+			__m128d vb = _mm_loadu_pd(reinterpret_cast<const double*>(&b));
+			_mm_storeu_pd(px,_mm_add_pd(_mm_loadu_pd(px),complexProduct(va,vb)));
+		}
+#endif
+
+		//! returns sum_i v1[i]*v2[i]
+		template<typename RealType>
+		inline RealType realProduct(const RealType* v1,const RealType* v2,size_t n)
+		{
+			RealType sum0 = 0, sum1 = 0;
+			size_t i = 0;
+			for (;i+1<n;i+=2) {
+				sum0 += v1[i]*v2[i];
+				sum1 += v1[i+1]*v2[i+1];
+			}
+			if (i<n) sum0 += v1[i]*v2[i];
+			return sum0 + sum1;
+		}
+
+#ifdef __SSE2__
+		inline double realProduct(const double* v1,const double* v2,size_t n)
+		{
+			size_t i = 0;
+			double sum = 0;
+#ifdef __AVX__
+			__m256d acc0 = _mm256_setzero_pd();
+			__m256d acc1 = _mm256_setzero_pd();
+			for (;i+8<=n;i+=8) {
+				acc0 = _mm256_add_pd(acc0,_mm256_mul_pd(_mm256_loadu_pd(v1+i),
+				                                        _mm256_loadu_pd(v2+i)));
+				acc1 = _mm256_add_pd(acc1,_mm256_mul_pd(_mm256_loadu_pd(v1+i+4),
+				                                        _mm256_loadu_pd(v2+i+4)));
+			}
+			acc0 = _mm256_add_pd(acc0,acc1);
+			__m128d acc = _mm_add_pd(_mm256_castpd256_pd128(acc0),
+			                         _mm256_extractf128_pd(acc0,1));
+#else
+			__m128d acc = _mm_setzero_pd();
+			__m128d acc1 = _mm_setzero_pd();
+			for (;i+4<=n;i+=4) {
+				acc = _mm_add_pd(acc,_mm_mul_pd(_mm_loadu_pd(v1+i),_mm_loadu_pd(v2+i)));
+				acc1 = _mm_add_pd(acc1,_mm_mul_pd(_mm_loadu_pd(v1+i+2),
+				                                  _mm_loadu_pd(v2+i+2)));
+			}
+			acc = _mm_add_pd(acc,acc1);
+#endif
+			double tmp[2];
+			_mm_storeu_pd(tmp,acc);
+			sum = tmp[0] + tmp[1];
+			for (;i<n;i++) sum += v1[i]*v2[i];
+			return sum;
+		}
+#endif
+
+		//! returns Re sum_i v1[i]*conj(v2[i])
+		template<typename RealType>
+		inline RealType realProduct(const std::complex<RealType>* v1,
+		                            const std::complex<RealType>* v2,
+		                            size_t n)
+		{
+			return realProduct(reinterpret_cast<const RealType*>(v1),
+			                   reinterpret_cast<const RealType*>(v2),
+			                   2*n);
+		}
+
+		//! x[i] += a*y[i] for real a
+		template<typename RealType>
+		inline void realAxpy(RealType* x,const RealType& a,const RealType* y,size_t n)
+		{
+			for (size_t i=0;i<n;i++) x[i] += a*y[i];
+		}
+
+		template<typename RealType>
+		inline void realAxpy(std::complex<RealType>* x,
+		                     const RealType& a,
+		                     const std::complex<RealType>* y,
+		                     size_t n)
+		{
+			realAxpy(reinterpret_cast<RealType*>(x),a,
+			         reinterpret_cast<const RealType*>(y),2*n);
+		}
+
+		//! returns sum_i conj(v1[i])*v2[i]
+		template<typename FieldType>
+		inline FieldType dotConj(const FieldType* v1,const FieldType* v2,size_t n)
+		{
+			return realProduct(v1,v2,n);
+		}
+
+		template<typename RealType>
+		inline std::complex<RealType> dotConj(const std::complex<RealType>* v1,
+		                                      const std::complex<RealType>* v2,
+		                                      size_t n)
+		{
+			RealType sumr = 0, sumi = 0;
+			for (size_t i=0;i<n;i++) {
+				RealType ar = std::real(v1[i]), ai = std::imag(v1[i]);
+				RealType br = std::real(v2[i]), bi = std::imag(v2[i]);
+				sumr += ar*br + ai*bi;
+				sumi += ar*bi - ai*br;
+			}
+			return std::complex<RealType>(sumr,sumi);
+		}
+
+#ifdef __SSE2__
+		inline std::complex<double> dotConj(const std::complex<double>* v1,
+		                                    const std::complex<double>* v2,
+		                                    size_t n)
+		{
+			const double* a = reinterpret_cast<const double*>(v1);
+			const double* b = reinterpret_cast<const double*>(v2);
+			size_t i = 0;
+			double re = 0, im = 0;
+#ifdef __AVX__
+			// accRe holds ar*br,ai*bi and accIm holds ar*bi,ai*br pairwise
+			__m256d accRe = _mm256_setzero_pd();
+			__m256d accIm = _mm256_setzero_pd();
+			for (;i+2<=n;i+=2) {
+				__m256d va = _mm256_loadu_pd(a+2*i);
+				__m256d vb = _mm256_loadu_pd(b+2*i);
+				accRe = _mm256_add_pd(accRe,_mm256_mul_pd(va,vb));
+				accIm = _mm256_add_pd(accIm,
+				        _mm256_mul_pd(va,_mm256_permute_pd(vb,5)));
+			}
+			double tmpRe[4], tmpIm[4];
+			_mm256_storeu_pd(tmpRe,accRe);
+			_mm256_storeu_pd(tmpIm,accIm);
+			re = tmpRe[0] + tmpRe[1] + tmpRe[2] + tmpRe[3];
+			im = tmpIm[0] - tmpIm[1] + tmpIm[2] - tmpIm[3];
+#else
+			__m128d accRe = _mm_setzero_pd();
+			__m128d accIm = _mm_setzero_pd();
+			for (;i<n;i++) {
+				__m128d va = _mm_loadu_pd(a+2*i);
+				__m128d vb = _mm_loadu_pd(b+2*i);
+				accRe = _mm_add_pd(accRe,_mm_mul_pd(va,vb));
+				accIm = _mm_add_pd(accIm,_mm_mul_pd(va,_mm_shuffle_pd(vb,vb,1)));
+			}
+			double tmpRe[2], tmpIm[2];
+			_mm_storeu_pd(tmpRe,accRe);
+			_mm_storeu_pd(tmpIm,accIm);
+			re = tmpRe[0] + tmpRe[1];
+			im = tmpIm[0] - tmpIm[1];
+#endif
+			for (;i<n;i++) {
+				re += a[2*i]*b[2*i] + a[2*i+1]*b[2*i+1];
+				im += a[2*i]*b[2*i+1] - a[2*i+1]*b[2*i];
+			}
+			return std::complex<double>(re,im);
+		}
+#endif
+	} // namespace VectorKernels
+} // namespace Dmrg
+/*@}*/
+#endif // VECTOR_KERNELS_H
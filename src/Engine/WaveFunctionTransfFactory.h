@@ -83,12 +83,14 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 
 #ifndef WFT_FACTORY_H
 #define WFT_FACTORY_H
+#include <algorithm>
 #include "Utils.h"
 #include "ProgressIndicator.h"
 #include "WaveFunctionTransfLocal.h"
 #include "WaveFunctionTransfSu2.h"
 #include "DmrgWaveStruct.h"
 #include "IoSimple.h"
+#include "CheckpointManifest.h"
 
 namespace Dmrg {
 	
@@ -109,6 +111,7 @@ namespace Dmrg {
 		typedef typename BasisWithOperatorsType::RealType RealType;
 		typedef typename BasisType::FactorsType FactorsType;
 		typedef DmrgWaveStruct<LeftRightSuperType> DmrgWaveStructType;
+		typedef typename DmrgWaveStructType::TransformType TransformType;
 
 		typedef WaveFunctionTransfBase<DmrgWaveStructType,VectorWithOffsetType>
 					WaveFunctionTransfBaseType;
@@ -132,11 +135,24 @@ namespace Dmrg {
 		  filenameIn_(parameters.checkpoint.filename),
 		  filenameOut_(parameters.filename),
 		  WFT_STRING("Wft"),
-		  wftImpl_(0)
+		  wftImpl_(0),
+		  stored_(0)
 		{
 			if (!isEnabled_) return;
-			if (parameters.options.find("checkpoint")!=std::string::npos)
-				load();
+			if (parameters.options.find("checkpoint")!=std::string::npos) {
+				CheckpointManifest manifest;
+				// a run that stopped during a finite loop left the Wft
+				// of its last incremental checkpoint, and one with
+				// keepCheckpoints the Wft of each
+				if (!manifest.load(filenameIn_,parameters.checkpoint.position)) {
+					load(WFT_STRING + filenameIn_);
+				} else if (manifest.hasWft) {
+					loadIncremental(CheckpointManifest::wftFile(filenameIn_,manifest.generation),
+					                CheckpointManifest::transformFile(filenameIn_,manifest.store));
+				} else {
+					throw std::runtime_error("WFT: the checkpoint has no Wft (run with nowft?)\n");
+				}
+			}
 			if (BasisType::useSu2Symmetry()) {
 				wftImpl_=new WaveFunctionTransfSu2Type(hilbertSpaceOneSite_,
 						stage_,firstCall_,counter_,dmrgWaveStruct_);
@@ -284,10 +300,12 @@ namespace Dmrg {
 			switch (stage_) {
 				case INFINITE:
 					if (direction==EXPAND_SYSTEM) {
-						wsStack_.push(transform);
+						wsStack_.push_back(transform);
+						wsRecords_.push_back(-1);
 						dmrgWaveStruct_.ws=transform;
 					} else {
-						weStack_.push(transform);
+						weStack_.push_back(transform);
+						weRecords_.push_back(-1);
 						dmrgWaveStruct_.we=transform;
 						//std::cerr<<"CHANGED dmrgWaveStruct_.we to transform\n";
 						//std::cerr<<"PUSHING "<<transform.n_row()<<"x"<<transform.n_col()<<"\n";
@@ -298,7 +316,8 @@ namespace Dmrg {
 					dmrgWaveStruct_.we=transform;
 					dmrgWaveStruct_.ws=transform;
 					//vectorConvert(dmrgWaveStruct_.psi,psi);
-					weStack_.push(transform);
+					weStack_.push_back(transform);
+					weRecords_.push_back(-1);
 					//std::cerr<<"PUSHING (POPPING) We "<<weStack_.size()<<"\n";
 					break;
 				case EXPAND_SYSTEM:
@@ -306,7 +325,8 @@ namespace Dmrg {
 					dmrgWaveStruct_.ws=transform;
 					dmrgWaveStruct_.we=transform;
 					//vectorConvert(dmrgWaveStruct_.psi,psi);
-					wsStack_.push(transform);
+					wsStack_.push_back(transform);
+					wsRecords_.push_back(-1);
 					break;
 			}
 
@@ -326,15 +346,89 @@ namespace Dmrg {
 //		void disable() { isEnabled_=false; }
 //
 		bool isEnabled() const { return isEnabled_; }
-		
+
+		//! Number of transforms kept for the system (EXPAND_SYSTEM)
+		//! or the environment stack
+		size_t transforms(size_t what) const
+		{
+			return (what==EXPAND_SYSTEM) ? wsStack_.size() : weStack_.size();
+		}
+
+		//! The transform i, counting from the bottom, kept for the
+		//! system (EXPAND_SYSTEM) or the environment stack
+		const TransformType& transform(size_t what,size_t i) const
+		{
+			const std::vector<TransformType>& st = (what==EXPAND_SYSTEM) ? wsStack_ : weStack_;
+			if (i>=st.size()) throw std::runtime_error("WFT::transform(...): out of range\n");
+			return st[i];
+		}
+
+		//! Writes to a temporary file that is then renamed, so
+		//! that file is either the previous one or complete
+		void save(const std::string& file) const
+		{
+			if (!isEnabled_) throw std::runtime_error(
+					"WFT::save(...) called but wft is disabled\n");
+
+			std::string tmp = file + ".tmp";
+			typename IoType::Out io(tmp,0);
+			std::string s="isEnabled="+ttos(isEnabled_);
+			io.printline(s);
+			s="stage="+ttos(stage_);
+			io.printline(s);
+			s="counter="+ttos(counter_);
+			io.printline(s);
+			io.printline("dmrgWaveStruct");
+			dmrgWaveStruct_.save(io);
+			saveStack(io,wsStack_,"wsStack");
+			saveStack(io,weStack_,"weStack");
+			io.close();
+			if (std::rename(tmp.c_str(),file.c_str())!=0)
+				throw std::runtime_error("WFT::save(...): cannot rename "+tmp+"\n");
+		}
+
+		//! Writes what save(file) writes, except that the transforms
+		//! are appended to store, and only those not there yet; file
+		//! has their records. A new store starts from no records
+		void saveIncremental(const std::string& file,const std::string& store)
+		{
+			if (!isEnabled_) throw std::runtime_error(
+					"WFT::saveIncremental(...) called but wft is disabled\n");
+
+			if (store!=store_) {
+				store_ = store;
+				stored_ = 0;
+				wsRecords_.assign(wsStack_.size(),-1);
+				weRecords_.assign(weStack_.size(),-1);
+				typename IoType::Out io(store_,0);
+				io.close();
+			}
+			appendToStore(wsStack_,wsRecords_);
+			appendToStore(weStack_,weRecords_);
+
+			std::string tmp = file + ".tmp";
+			typename IoType::Out io(tmp,0);
+			io.printline("isEnabled="+ttos(isEnabled_));
+			io.printline("stage="+ttos(stage_));
+			io.printline("counter="+ttos(counter_));
+			io.printline("dmrgWaveStruct");
+			dmrgWaveStruct_.save(io);
+			io.printVector(wsRecords_,"#wsRecords");
+			io.printVector(weRecords_,"#weRecords");
+			io.close();
+			if (std::rename(tmp.c_str(),file.c_str())!=0)
+				throw std::runtime_error("WFT::saveIncremental(...): cannot rename "+tmp+"\n");
+		}
+
 	private:
-		
+
 		void beforeWft(const LeftRightSuperType& lrs)
 		{
 			if (stage_==EXPAND_ENVIRON) {
 				if (wsStack_.size()>=1) {
-					dmrgWaveStruct_.ws=wsStack_.top();
-					wsStack_.pop();
+					dmrgWaveStruct_.ws=wsStack_.back();
+					wsStack_.pop_back();
+					wsRecords_.pop_back();
 				} else {
 					//std::cerr<<"PUSHING STACK ERROR S\n";
 					throw std::runtime_error("System Stack is empty\n");
@@ -343,8 +437,9 @@ namespace Dmrg {
 			
 			if (stage_==EXPAND_SYSTEM) {
 				if (weStack_.size()>=1) { 
-					dmrgWaveStruct_.we=weStack_.top();
-					weStack_.pop();
+					dmrgWaveStruct_.we=weStack_.back();
+					weStack_.pop_back();
+					weRecords_.pop_back();
 					//std::cerr<<"CHANGED We taken from stack\n";
 				} else {
 					//std::cerr<<"PUSHING STACK ERROR E\n";
@@ -362,8 +457,8 @@ namespace Dmrg {
 				//throw std::runtime_error("WFT::beforeWft(): Can't apply WFT\n");
 				//return;
 				if (weStack_.size()>=1) { 
-					dmrgWaveStruct_.we=weStack_.top();
-					//weStack_.pop();
+					dmrgWaveStruct_.we=weStack_.back();
+					//weStack_.pop_back();
 					//std::cerr<<"CHANGED-COUNTER0 We taken from stack\n";
 				} else {
 //					std::cerr<<"PUSHING-COUNTER0 STACK ERROR E\n";
@@ -382,8 +477,8 @@ namespace Dmrg {
 				//throw std::runtime_error("WFT::beforeWft(): Can't apply WFT\n");
 				//return;
 				if (wsStack_.size()>=1) {
-					dmrgWaveStruct_.ws=wsStack_.top();
-					//weStack_.pop();
+					dmrgWaveStruct_.ws=wsStack_.back();
+					//weStack_.pop_back();
 					//std::cerr<<"CHANGED-COUNTER0 We taken from stack\n";
 				} else {
 //					std::cerr<<"PUSHING-COUNTER0 STACK ERROR E\n";
@@ -426,36 +521,105 @@ namespace Dmrg {
 
 		void save() const
 		{
-			if (!isEnabled_) throw std::runtime_error(
-					"WFT::save(...) called but wft is disabled\n");
+			save(WFT_STRING + filenameOut_);
+		}
 
-			typename IoType::Out io(WFT_STRING + filenameOut_,0);
-			std::string s="isEnabled="+ttos(isEnabled_);
-			io.printline(s);
-			s="stage="+ttos(stage_);
-			io.printline(s);
-			s="counter="+ttos(counter_);
+		//! The top of the stack is saved first
+		template<typename IoOutputter>
+		void saveStack(IoOutputter& io,
+		               const std::vector<TransformType>& st,
+		               const std::string& label) const
+		{
+			std::string s = label + "=" + ttos(st.size());
 			io.printline(s);
-			io.printline("dmrgWaveStruct");
-			dmrgWaveStruct_.save(io);
-			io.printMatrix(wsStack_,"wsStack");
-			io.printMatrix(weStack_,"weStack");
+			for (size_t i=st.size();i>0;i--)
+				st[i-1].save(io,"#" + label + "Item");
 		}
 
-		void load()
+		void load(const std::string& file)
 		{
 			if (!isEnabled_) throw std::runtime_error(
 					"WFT::load(...) called but wft is disabled\n");
 
-			typename IoType::In io(WFT_STRING + filenameIn_);
+			typename IoType::In io(file);
 			io.readline(isEnabled_,"isEnabled=");
 			io.readline(stage_,"stage=");
 			io.readline(counter_,"counter=");
 			firstCall_=false;
 			io.advance("dmrgWaveStruct");
 			dmrgWaveStruct_.load(io);
-			io.readMatrix(wsStack_,"wsStack");
-			io.readMatrix(weStack_,"weStack");
+			loadStack(io,wsStack_,"wsStack");
+			loadStack(io,weStack_,"weStack");
+			wsRecords_.assign(wsStack_.size(),-1);
+			weRecords_.assign(weStack_.size(),-1);
+		}
+
+		//! Reads what saveIncremental wrote; the transforms are
+		//! not in the store of this run, so their records are -1
+		void loadIncremental(const std::string& file,const std::string& store)
+		{
+			typename IoType::In io(file);
+			io.readline(isEnabled_,"isEnabled=");
+			io.readline(stage_,"stage=");
+			io.readline(counter_,"counter=");
+			firstCall_=false;
+			io.advance("dmrgWaveStruct");
+			dmrgWaveStruct_.load(io);
+			std::vector<int> ws,we;
+			io.read(ws,"#wsRecords");
+			io.read(we,"#weRecords");
+			io.close();
+
+			// the store is read once, in the order of the records
+			std::vector<std::pair<int,TransformType*> > order;
+			wsStack_.resize(ws.size());
+			weStack_.resize(we.size());
+			for (size_t i=0;i<ws.size();i++)
+				order.push_back(std::pair<int,TransformType*>(ws[i],&wsStack_[i]));
+			for (size_t i=0;i<we.size();i++)
+				order.push_back(std::pair<int,TransformType*>(we[i],&weStack_[i]));
+			std::sort(order.begin(),order.end());
+			typename IoType::In ioStore(store);
+			int next = 0;
+			for (size_t i=0;i<order.size();i++) {
+				int r = order[i].first;
+				if (r<next) throw std::runtime_error("WFT::loadIncremental(...): bad record\n");
+				order[i].second->load(ioStore,"#TransformItem",r-next);
+				next = r+1;
+			}
+			wsRecords_.assign(wsStack_.size(),-1);
+			weRecords_.assign(weStack_.size(),-1);
+		}
+
+		//! appends the transforms that are not in store_ yet
+		void appendToStore(const std::vector<TransformType>& st,std::vector<int>& records)
+		{
+			typename IoType::Out io;
+			bool opened = false;
+			for (size_t i=0;i<records.size();i++) {
+				if (records[i]>=0) continue;
+				if (!opened) io.open(store_,std::ios_base::app,0);
+				opened = true;
+				st[i].save(io,"#TransformItem");
+				records[i] = stored_++;
+			}
+			if (opened) io.close();
+		}
+
+		template<typename IoInputter>
+		void loadStack(IoInputter& io,
+		               std::vector<TransformType>& st,
+		               const std::string& label)
+		{
+			int x = 0;
+			io.readline(x,label + "=");
+			if (x<0) throw std::runtime_error(
+				"WFT::loadStack(...): size<0\n");
+			std::vector<TransformType> items(x);
+			for (size_t i=0;i<items.size();i++)
+				items[i].load(io,"#" + label + "Item");
+			st.clear();
+			for (size_t i=items.size();i>0;i--) st.push_back(items[i-1]);
 		}
 
 		size_t hilbertSpaceOneSite_;
@@ -467,8 +631,12 @@ namespace Dmrg {
 		std::string filenameIn_,filenameOut_;
 		const std::string WFT_STRING;
 		DmrgWaveStructType dmrgWaveStruct_;
-		std::stack<PsimagLite::Matrix<SparseElementType> > wsStack_,weStack_;
+		std::vector<TransformType> wsStack_,weStack_; // stacks, the top is the back
 		WaveFunctionTransfBaseType* wftImpl_;
+		// record of each transform in store_, see saveIncremental, or -1
+		std::vector<int> wsRecords_,weRecords_;
+		std::string store_;
+		int stored_;
 	}; // class WaveFunctionTransformation
 } // namespace Dmrg
 
@@ -88,6 +88,7 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 #include "VectorWithOffsets.h" // so that std::norm() becomes visible here
 #include "VectorWithOffset.h" // so that std::norm() becomes visible here
 #include "WaveFunctionTransfBase.h"
+#include "Threads.h"
 
 namespace Dmrg {
 	
@@ -151,7 +152,84 @@ namespace Dmrg {
 		}
 
 	private:
-		
+
+		enum {VECTOR1,VECTOR2,VECTOR2_FROM_INFINITE};
+
+		//! Computes psiDest[x] for x in [start,final), each x can be done
+		//! by a different thread
+		template<typename SomeVectorType>
+		class ParallelWft {
+		public:
+			ParallelWft(const WaveFunctionTransfLocal& wft,
+			            size_t kind,
+			            SomeVectorType& psiDest,
+			            const SomeVectorType& psiSrc,
+			            const LeftRightSuperType& lrs,
+			            size_t start,
+			            size_t final,
+			            size_t n1,
+			            size_t n2,
+			            const SparseMatrixType& m1,
+			            const SparseMatrixType& m2)
+			: wft_(wft),kind_(kind),psiDest_(psiDest),psiSrc_(psiSrc),lrs_(lrs),
+			  start_(start),final_(final),n1_(n1),n2_(n2),m1_(m1),m2_(m2)
+			{}
+
+			void thread_function_(size_t threadNum,size_t blockSize,pthread_mutex_t*)
+			{
+				PackIndicesType pack1(n1_);
+				PackIndicesType pack2(n2_);
+				for (size_t p=0;p<blockSize;p++) {
+					size_t x = start_ + threadNum*blockSize + p;
+					if (x>=final_) break;
+					psiDest_[x] = wft_.transformOne(kind_,x,pack1,pack2,
+							psiSrc_,lrs_,m1_,m2_);
+				}
+			}
+
+		private:
+			const WaveFunctionTransfLocal& wft_;
+			size_t kind_;
+			SomeVectorType& psiDest_;
+			const SomeVectorType& psiSrc_;
+			const LeftRightSuperType& lrs_;
+			size_t start_,final_,n1_,n2_;
+			const SparseMatrixType& m1_;
+			const SparseMatrixType& m2_;
+		}; // class ParallelWft
+
+		template<typename SomeVectorType>
+		SparseElementType transformOne(
+				size_t kind,
+				size_t x,
+				PackIndicesType& pack1,
+				PackIndicesType& pack2,
+				const SomeVectorType& psiSrc,
+				const LeftRightSuperType& lrs,
+				const SparseMatrixType& m1,
+				const SparseMatrixType& m2) const
+		{
+			if (kind==VECTOR1) {
+				size_t ip,beta,kp,jp;
+				pack1.unpack(ip,beta,(size_t)lrs.super().permutation(x));
+				pack2.unpack(kp,jp,(size_t)lrs.right().permutation(beta));
+				return createAux1b(psiSrc,ip,kp,jp,m1,m2);
+			}
+			if (kind==VECTOR2) {
+				size_t ip,alpha,kp,jp;
+				pack1.unpack(alpha,jp,(size_t)lrs.super().permutation(x));
+				pack2.unpack(ip,kp,(size_t)lrs.left().permutation(alpha));
+				return createAux2b(psiSrc,ip,kp,jp,m1,m2);
+			}
+			size_t isn,jen;
+			pack1.unpack(isn,jen,(size_t)lrs.super().permutation(x));
+			size_t is,jpl;
+			pack2.unpack(is,jpl,(size_t)lrs.left().permutation(isn));
+			//size_t jk,je;
+			//utils::getCoordinates(jk,je,(size_t)lrs.right().permutation(jen),npk);
+			return createAux2bFromInfinite(psiSrc,is,jpl,jen,m1,m2);
+		}
+
 		template<typename SomeVectorType>
 		void transformVector1(
 				SomeVectorType& psiDest,
@@ -196,19 +274,16 @@ namespace Dmrg {
 			size_t start = psiDest.offset(i0);
 			size_t final = psiDest.effectiveSize(i0)+start;
 			
-			SparseMatrixType ws(dmrgWaveStruct_.ws);
-			SparseMatrixType we(dmrgWaveStruct_.we);
+			SparseMatrixType ws;
+			dmrgWaveStruct_.ws.toSparse(ws);
+			SparseMatrixType we;
+			dmrgWaveStruct_.we.toSparse(we);
 			SparseMatrixType weT;
 			transposeConjugate(weT,we);
 			
-			PackIndicesType pack1(nip);
-			PackIndicesType pack2(nk);
-			for (size_t x=start;x<final;x++) {
-				size_t ip,beta,kp,jp;
-				pack1.unpack(ip,beta,(size_t)lrs.super().permutation(x));
-				pack2.unpack(kp,jp,(size_t)lrs.right().permutation(beta));
-				psiDest[x]=createAux1b(psiSrc,ip,kp,jp,ws,weT);
-			}
+			ParallelWft<SomeVectorType> parallelWft(*this,VECTOR1,psiDest,psiSrc,lrs,
+					start,final,nip,nk,ws,weT);
+			Threads::loopCreate(final-start,parallelWft);
 		}
 
 		template<typename SomeVectorType>
@@ -287,20 +362,16 @@ namespace Dmrg {
 			size_t start = psiDest.offset(i0);
 			size_t final = psiDest.effectiveSize(i0)+start;
 			
-			SparseMatrixType we(dmrgWaveStruct_.we);
-			SparseMatrixType ws(dmrgWaveStruct_.ws);
+			SparseMatrixType we;
+			dmrgWaveStruct_.we.toSparse(we);
+			SparseMatrixType ws;
+			dmrgWaveStruct_.ws.toSparse(ws);
 			SparseMatrixType wsT;
 			transposeConjugate(wsT,ws);
 			
-			PackIndicesType pack1(nalpha);
-			PackIndicesType pack2(nip);
-			for (size_t x=start;x<final;x++) {
-				size_t ip,alpha,kp,jp;
-				pack1.unpack(alpha,jp,(size_t)lrs.super().permutation(x));
-				pack2.unpack(ip,kp,(size_t)lrs.left().permutation(alpha));
-				psiDest[x]=createAux2b(psiSrc,ip,kp,jp,wsT,we);
-			}
-			
+			ParallelWft<SomeVectorType> parallelWft(*this,VECTOR2,psiDest,psiSrc,lrs,
+					start,final,nalpha,nip,wsT,we);
+			Threads::loopCreate(final-start,parallelWft);
 		}
 
 		template<typename SomeVectorType>
@@ -379,23 +450,16 @@ namespace Dmrg {
 			size_t start = psiDest.offset(i0);
 			size_t final = psiDest.effectiveSize(i0)+start;
 			
-			SparseMatrixType we(dmrgWaveStruct_.we);
-			SparseMatrixType ws(dmrgWaveStruct_.ws);
+			SparseMatrixType we;
+			dmrgWaveStruct_.we.toSparse(we);
+			SparseMatrixType ws;
+			dmrgWaveStruct_.ws.toSparse(ws);
 			SparseMatrixType wsT;
 			transposeConjugate(wsT,ws);
 			
-			PackIndicesType pack1(nalpha);
-			PackIndicesType pack2(nip);
-			for (size_t x=start;x<final;x++) {
-				size_t isn,jen;
-				pack1.unpack(isn,jen,(size_t)lrs.super().permutation(x));
-				size_t is,jpl;
-				pack2.unpack(is,jpl,(size_t)lrs.left().permutation(isn));
-				//size_t jk,je;
-				//utils::getCoordinates(jk,je,(size_t)lrs.right().permutation(jen),npk);
-				psiDest[x]=createAux2bFromInfinite(psiSrc,is,jpl,jen,wsT,we);
-			}
-			
+			ParallelWft<SomeVectorType> parallelWft(*this,VECTOR2_FROM_INFINITE,psiDest,
+					psiSrc,lrs,start,final,nalpha,nip,wsT,we);
+			Threads::loopCreate(final-start,parallelWft);
 		}
 		
 		
@@ -201,7 +201,9 @@ namespace Dmrg {
 			//transposeConjugate(factorsInverseSEOld,factorsSEOld);
 			transposeConjugate(factorsInverseE,factorsE);
 			
-			SparseMatrixType ws(dmrgWaveStruct_.ws),we(dmrgWaveStruct_.we),weT;
+			SparseMatrixType ws,we,weT;
+			dmrgWaveStruct_.ws.toSparse(ws);
+			dmrgWaveStruct_.we.toSparse(we);
 			transposeConjugate(weT,we);
 			
 			PackIndicesType pack1(nip);
@@ -315,7 +317,9 @@ namespace Dmrg {
 			transposeConjugate(factorsInverseSE,factorsSE);
 			//transposeConjugate(factorsInverseSEOld,factorsSEOld);
 			transposeConjugate(factorsInverseS,factorsS);
-			SparseMatrixType ws(dmrgWaveStruct_.ws),we(dmrgWaveStruct_.we),wsT;
+			SparseMatrixType ws,we,wsT;
+			dmrgWaveStruct_.ws.toSparse(ws);
+			dmrgWaveStruct_.we.toSparse(we);
 			transposeConjugate(wsT,ws);
 			
 			PackIndicesType pack1(nalpha);
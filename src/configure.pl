@@ -37,6 +37,7 @@ my ($model,$linSize,$modelLocation,$modelFullName);
 my ($geometryArgs);
 my ($electrons,$momentumJ,$su2Symmetry);
 my ($pthreads,$pthreadsLib)=(0,"");
+my $binaryIo=0;
 my $brand= "v2.0";
 my ($connectorsArgs,$connectorsArgs2,$dof,$connectors2,$connectorValue2);
 
@@ -99,7 +100,7 @@ sub askQuestions
 	
 	$pthreads=0;
 	$pthreadsLib="";
-	if ($mpi!=1 && !($platform=~/Darwin/i)) { # cannot use both mpi and pthreads
+	if (!($platform=~/Darwin/i)) { # with mpi too: each process runs threads
 		print "Do you want to compile with pthreads enabled?\n";
 		print "Available: y or n\n";
 		print "Default is: y (press ENTER): ";
@@ -156,6 +157,17 @@ sub askQuestions
 		$_=" $lapack ";
 	}
 	$lapack = $_;
+
+	print "Do you want the data file, the checkpoints and the stacks written in binary?\n";
+	print "(say y for faster observe and restarts)\n";
+	print "Available: y or n\n";
+	print "Default is: n (press ENTER): ";
+	$_=<STDIN>;
+	chomp;
+	if ($_ eq "" or $_ eq "\n") {
+		$_="n";
+	}
+	$binaryIo=1 if ($_=~/^y/i);
 }
 
 
@@ -163,6 +175,11 @@ sub createMakefile
 {
 	system("cp Makefile Makefile.bak") if (-r "Makefile");
 	my $compiler = compilerName();
+	my $pthreadsDefine = ($pthreads) ? "-DUSE_PTHREADS" : "";
+	# a threaded LAPACK can be told how many threads to use
+	my $lapackDefine = "";
+	$lapackDefine = "-DUSE_OPENBLAS" if ($lapack=~/openblas/i);
+	$lapackDefine = "-DUSE_MKL" if ($lapack=~/mkl/i);
 	open(FOUT,">Makefile") or die "Cannot open Makefile for writing: $!\n";
 print FOUT<<EOF;
 # DO NOT EDIT!!! Changes will be lost. Modify configure.pl instead
@@ -170,12 +187,13 @@ print FOUT<<EOF;
 # DMRG++ ($brand) by G.A.
 # Platform: $platform
 # MPI: $mpi
+# Pthreads: $pthreads
 
 LDFLAGS =    $lapack  $gslLibs $pthreadsLib
-CPPFLAGS = -Werror -Wall  -IEngine $modelLocation -IGeometries -I$PsimagLite
+CPPFLAGS = -Werror -Wall $pthreadsDefine $lapackDefine -IEngine $modelLocation -IGeometries -I$PsimagLite
 EOF
 if ($mpi) {
-	print FOUT "CXX = mpicxx -O3 -DNDEBUG \n";
+	print FOUT "CXX = mpicxx -O3 -DNDEBUG -DUSE_MPI \n";
 } else {
 	print FOUT "CXX = $compiler -pg -O3 -DNDEBUG\n";
 	print FOUT "#Comment out line below for debugging: \n";
@@ -243,6 +261,7 @@ sub createDriver
 	my $concurrencyName = getConcurrencyName();
 	my $parametersName = getParametersName();
 	my $pthreadsName = getPthreadsName();
+	my $ioName = getIoName();
 	my $modelName = getModelName();
 	my $operatorsName = getOperatorsName();
 	
@@ -255,6 +274,7 @@ print FOUT<<EOF;
 #include "BlockMatrix.h"
 #include "DmrgSolver.h"
 #include "IoSimple.h"
+#include "IoBinary.h"
 #include "Operator.h"
 #include "$concurrencyName.h"
 #include "$modelName.h"
@@ -276,6 +296,7 @@ print FOUT<<EOF;
 #include "VectorWithOffsets.h"
 #include "BasisWithOperators.h"
 #include "LeftRightSuper.h"
+#include "CompressedFile.h"
 
 typedef double MatrixElementType;
 typedef std::complex<MatrixElementType> ComplexType;
@@ -291,7 +312,7 @@ typedef double Field;
 typedef PsimagLite::$concurrencyName<MatrixElementType> MyConcurrency;
 typedef $parametersName<MatrixElementType> ParametersModelType;
 typedef Geometry<MatrixElementType> GeometryType;;
-typedef  PsimagLite::IoSimple MyIo;
+typedef  $ioName MyIo;
 
 template<
 	typename ParametersModelType,
@@ -364,6 +385,12 @@ int main(int argc,char *argv[])
 	ParametersModelType mp(io);
 	ParametersDmrgSolver<MatrixElementType> dmrgSolverParams(io);
 
+	// IoBinary writes through CompressedFile if this is set
+	bool compressed = (dmrgSolverParams.options.find("compressedFiles")!=std::string::npos);
+	if (compressed && !$binaryIo) throw std::runtime_error("compressedFiles needs"
+		" the binary format, see configure.pl\\n");
+	CompressedFile::enable(compressed);
+
 	bool su2=false;
 	if (dmrgSolverParams.options.find("useSu2Symmetry")!=std::string::npos) su2=true;
 	std::string targetting="GroundStateTargetting";
@@ -374,6 +401,13 @@ int main(int argc,char *argv[])
 	if (dmrgSolverParams.options.find("CorrectionTargetting")!=std::string::npos) targetting="CorrectionTargetting";
 	if (targetting!="GroundStateTargetting" && su2) throw std::runtime_error("SU(2)"
  		" supports only GroundStateTargetting for now (sorry!)\\n");
+	// the distributed x+=Hy is only compiled for ModelHelperLocal, and
+	// never builds the matrix of a whole partition (see Diagonalization)
+	bool distributed = (dmrgSolverParams.options.find("distributedMatvec")!=std::string::npos);
+	if (distributed && su2) throw std::runtime_error("distributedMatvec is"
+		" unsupported with SU(2)\\n");
+	if (distributed && dmrgSolverParams.options.find("debugmatrix")!=std::string::npos)
+		throw std::runtime_error("distributedMatvec is unsupported with debugmatrix\\n");
 	if (su2) {
 		if (dmrgSolverParams.targetQuantumNumbers[2]>0) { 
 			mainLoop<ParametersModelType,GeometryType,ParametersDmrgSolver<MatrixElementType>,MyConcurrency,
@@ -469,6 +503,7 @@ sub createObserverDriver
 	my $concurrencyName = getConcurrencyName();
 	my $parametersName = getParametersName();
 	my $pthreadsName = getPthreadsName();
+	my $ioName = getIoName();
 	my $modelName = getModelName();
 	my $operatorsName = getOperatorsName();
 	#my $chooseRealOrComplexForObservables = "typedef RealType FieldType;\n";
@@ -486,6 +521,7 @@ print OBSOUT<<EOF;
 #include "Observer.h"
 #include "ObservableLibrary.h"
 #include "IoSimple.h"
+#include "IoBinary.h"
 #include "$modelName.h" 
 #include "$operatorsName.h" 
 #include "$concurrencyName.h" 
@@ -506,6 +542,7 @@ print OBSOUT<<EOF;
 #include "CorrectionTargetting.h" 
 #include "BasisWithOperators.h"
 #include "LeftRightSuper.h"
+#include "CompressedFile.h"
 
 using namespace Dmrg;
 
@@ -517,11 +554,12 @@ typedef  PsimagLite::CrsMatrix<RealType> MySparseMatrixReal;
 
 typedef PsimagLite::$concurrencyName<RealType> MyConcurrency;
 typedef PsimagLite::IoSimple::In IoInputType;
+typedef $ioName MyIo;
 
 template<typename ConcurrencyType,typename VectorWithOffsetType,typename ModelType,typename SparseMatrixType,
 typename OperatorType,typename TargettingType,typename GeometryType>
 bool observeOneFullSweep(
-	IoInputType& io,
+	MyIo::In& io,
 	const GeometryType& geometry,
 	const ModelType& model,
 	const std::string& obsOptions,
@@ -530,7 +568,7 @@ bool observeOneFullSweep(
 {
 	bool verbose = false;
 	typedef typename SparseMatrixType::value_type FieldType;
-	typedef Observer<FieldType,VectorWithOffsetType,ModelType,IoInputType> 
+	typedef Observer<FieldType,VectorWithOffsetType,ModelType,MyIo::In> 
 		ObserverType;
 	typedef ObservableLibrary<ObserverType,TargettingType> ObservableLibraryType;
 	size_t n  = geometry.numberOfSites();
@@ -541,7 +579,14 @@ bool observeOneFullSweep(
 		//std::cout<<"sTmp="<<sTmp<<"\\n";
 		n = atoi(sTmp.c_str());
 	}
-	ObservableLibraryType observerLib(io,n,hasTimeEvolution,model,concurrency,verbose);
+	// streamObserver measures all correlations reading each record once,
+	// with only one record in memory
+	bool streaming = false;
+	if (obsOptions.find("streamObserver")!=std::string::npos) {
+		if (hasTimeEvolution) std::cerr<<"streamObserver ignored: time evolution needs all records\\n";
+		else streaming = true;
+	}
+	ObservableLibraryType observerLib(io,n,hasTimeEvolution,model,concurrency,verbose,streaming);
 	
 	bool ot = false;
 	if (obsOptions.find("ot") || obsOptions.find("time")) ot = true;
@@ -552,54 +597,58 @@ bool observeOneFullSweep(
 	}
 
 	if (hasTimeEvolution) observerLib.setBrackets("time","time");
+
+	std::vector<std::string> labels;
 EOF
 	if  ($modelName=~/heisenberg/i) {
 	} else {
 print OBSOUT<<EOF; 
 
 	if (obsOptions.find("cc")!=std::string::npos) {
-		observerLib.measure("cc",n/2,n);
+		labels.push_back("cc");
 	}
 	
 	if (obsOptions.find("nn")!=std::string::npos) {
-		observerLib.measure("nn",n/2,n);
+		labels.push_back("nn");
 	}
 EOF
 	}
 print OBSOUT<<EOF;
 	if (obsOptions.find("szsz")!=std::string::npos) {
-		observerLib.measure("szsz",n/2,n);
+		labels.push_back("szsz");
 	}
 EOF
 	if  ($modelName=~/febasedsc/i or $modelName=~/feasbasedscextended/i) {
 print print OBSOUT<<EOF;
 	if (obsOptions.find("dd")!=std::string::npos && 
 			geometry.label(0).find("ladder")==std::string::npos) {
-		observerLib.measure("dd",n/2,n);
+		labels.push_back("dd");
 	}
 	
 
 	// FOUR-POINT DELTA-DELTA^DAGGER:
 	if (obsOptions.find("dd4")!=std::string::npos &&
 		geometry.label(0).find("ladder")!=std::string::npos) {
-		observerLib.measure("dd4",n/2,n);
+		labels.push_back("dd4");
 	} // if dd4
 EOF
 	}
 	if  ($modelName=~/heisenberg/i) {
 	print print OBSOUT<<EOF;
 		if (obsOptions.find("s+s-")!=std::string::npos) {
-			observerLib.measure("s+s-",n/2,n);
+			labels.push_back("s+s-");
 		}
 		if (obsOptions.find("s-s+")!=std::string::npos) {
-			observerLib.measure("s-s+",n/2,n);
+			labels.push_back("s-s+");
 		}
 		if (obsOptions.find("ss")!=std::string::npos) {
-			observerLib.measure("ss",n/2,n);
+			labels.push_back("ss");
 		}
 EOF
 	}
 	print OBSOUT<<EOF;
+	// all at once so that streamObserver can measure them in one pass
+	observerLib.measure(labels,n/2,n);
 	return observerLib.endOfData();
 }
 
@@ -642,7 +691,7 @@ void mainLoop(
                         InternalProductTemplate,
 			ModelHelperTemplate,
                         ModelType,
-                        PsimagLite::IoSimple,
+                        MyIo,
                         TargettingTemplate,
                         VectorWithOffsetTemplate
                 > SolverType; // only used for types
@@ -658,7 +707,7 @@ void mainLoop(
 	TargettingParamsType tsp(io,model);
 	
 	bool moreData = true;
-	IoInputType dataIo(datafile);
+	MyIo::In dataIo(datafile);
 	bool hasTimeEvolution = (targetting == "TimeStepTargetting") ? true : false;
 	while (moreData) {
 		try {
@@ -800,6 +849,11 @@ sub getParametersName
 	return $parametersName;
 }
 
+sub getIoName
+{
+	return ($binaryIo) ? "Dmrg::IoBinary" : "PsimagLite::IoSimple";
+}
+
 sub getPthreadsName
 {
 	my $pthreadsName = "UNKNOWN";